@@ -48,6 +48,8 @@
 
 /* Include directives: */
 #include "cpu.hpp"
+#include "mdu.hpp"
+#include "bitops.hpp"
 
 /********************************************************************************
 * alu: Namespace containing ALU functions.
@@ -56,12 +58,352 @@ namespace alu
 {
    using namespace cpu; /* Brings all content of the cpu namespace into current scope. */
 
+   /********************************************************************************
+   * add_saturated_unsigned: Returns the unsigned sum of a and b clamped to 255.
+   *                         Bit 8 of the return value is set if the sum was
+   *                         clamped. The calculation is branch-free.
+   ********************************************************************************/
+   static std::uint16_t add_saturated_unsigned(const std::uint8_t a,
+                                               const std::uint8_t b)
+   {
+      const auto sum = static_cast<std::uint16_t>(a + b);
+      const auto saturated = static_cast<std::uint16_t>(sum >> 8);
+      return static_cast<std::uint16_t>((static_cast<std::uint8_t>(sum | (0 - saturated))) | (saturated << 8));
+   }
+
+   /********************************************************************************
+   * sub_saturated_unsigned: Returns the unsigned difference of a and b clamped
+   *                         to 0. Bit 8 of the return value is set if the
+   *                         difference was clamped. The calculation is
+   *                         branch-free.
+   ********************************************************************************/
+   static std::uint16_t sub_saturated_unsigned(const std::uint8_t a,
+                                               const std::uint8_t b)
+   {
+      const auto difference = static_cast<std::uint16_t>(a - b);
+      const auto saturated = static_cast<std::uint16_t>((difference >> 8) & 1);
+      return static_cast<std::uint16_t>((difference & (saturated - 1) & 0xFF) | (saturated << 8));
+   }
+
+   /********************************************************************************
+   * add_saturated_signed: Returns the signed sum of a and b clamped to the
+   *                       range [-128, 127]. Bit 8 of the return value is set
+   *                       if the sum was clamped. The calculation is branch-free.
+   ********************************************************************************/
+   static std::uint16_t add_saturated_signed(const std::uint8_t a,
+                                             const std::uint8_t b)
+   {
+      const auto sum = static_cast<std::int8_t>(a) + static_cast<std::int8_t>(b);
+      const auto limit = 0x7F ^ ((a >> 7) * 0xFF);
+      const auto saturated = static_cast<int>(sum != static_cast<std::int8_t>(sum));
+      const auto mask = -saturated;
+      return static_cast<std::uint16_t>((((limit & mask) | (sum & ~mask)) & 0xFF) | (saturated << 8));
+   }
+
+   /********************************************************************************
+   * sub_saturated_signed: Returns the signed difference of a and b clamped to
+   *                       the range [-128, 127]. Bit 8 of the return value is
+   *                       set if the difference was clamped. The calculation
+   *                       is branch-free.
+   ********************************************************************************/
+   static std::uint16_t sub_saturated_signed(const std::uint8_t a,
+                                             const std::uint8_t b)
+   {
+      const auto difference = static_cast<std::int8_t>(a) - static_cast<std::int8_t>(b);
+      const auto limit = 0x7F ^ ((a >> 7) * 0xFF);
+      const auto saturated = static_cast<int>(difference != static_cast<std::int8_t>(difference));
+      const auto mask = -saturated;
+      return static_cast<std::uint16_t>((((limit & mask) | (difference & ~mask)) & 0xFF) | (saturated << 8));
+   }
+
+   /********************************************************************************
+   * add_packed: Adds the lanes of a and b independently, where each lane wraps
+   *             around on overflow. Bit 8 of the return value is set if any
+   *             lane produced a carry. The calculation is branch-free.
+   *
+   *             - a   : First operand.
+   *             - b   : Second operand.
+   *             - msbs: Mask of the most significant bit of each lane, i.e.
+   *                     0x88 for 2 x 4-bit lanes and 0xAA for 4 x 2-bit lanes.
+   ********************************************************************************/
+   static std::uint16_t add_packed(const std::uint8_t a,
+                                   const std::uint8_t b,
+                                   const std::uint8_t msbs)
+   {
+      const auto sum = static_cast<std::uint8_t>(((a & ~msbs) + (b & ~msbs)) ^ ((a ^ b) & msbs));
+      const auto carries = (a & b) | ((a | b) & ~sum);
+      return static_cast<std::uint16_t>(sum | (static_cast<int>((carries & msbs) != 0) << 8));
+   }
+
+   /********************************************************************************
+   * sub_packed: Subtracts the lanes of b from a independently, where each lane
+   *             wraps around on underflow. Bit 8 of the return value is set if
+   *             any lane produced a borrow. The calculation is branch-free.
+   *
+   *             - a   : First operand.
+   *             - b   : Second operand.
+   *             - msbs: Mask of the most significant bit of each lane, i.e.
+   *                     0x88 for 2 x 4-bit lanes and 0xAA for 4 x 2-bit lanes.
+   ********************************************************************************/
+   static std::uint16_t sub_packed(const std::uint8_t a,
+                                   const std::uint8_t b,
+                                   const std::uint8_t msbs)
+   {
+      const auto difference = static_cast<std::uint8_t>(((a | msbs) - (b & ~msbs)) ^ ((a ^ ~b) & msbs));
+      const auto borrows = (~a & b) | (~(a ^ b) & difference);
+      return static_cast<std::uint16_t>(difference | (static_cast<int>((borrows & msbs) != 0) << 8));
+   }
+
+   /********************************************************************************
+   * Kernel output format: Each kernel returns the 8-bit result in bits 0 - 7
+   *                       together with the carry flag and the overflow flag.
+   *                       The remaining flags N, Z and S are derived from the
+   *                       result by alu::finish. If the unaffected bit is set,
+   *                       the status register is left unchanged.
+   ********************************************************************************/
+   static constexpr std::uint8_t carry_bit = 8;       /* Carry flag of kernel output. */
+   static constexpr std::uint8_t overflow_bit = 9;    /* Overflow flag of kernel output. */
+   static constexpr std::uint8_t unaffected_bit = 10; /* Status register unaffected. */
+
+   /********************************************************************************
+   * kernel: Performs the operation with specified OP code and returns the
+   *         kernel output described above. There is one specialization per
+   *         instruction in CPU_ALU_INSTRUCTIONS. The kernels of OR, AND, XOR,
+   *         ADD and SUB are constexpr, so that constant expressions can be
+   *         folded at compile time (see expr::fold).
+   *
+   *         - a    : First operand.
+   *         - b    : Second operand.
+   *         - carry: The carry flag before the operation (0 or 1).
+   ********************************************************************************/
+   template<std::uint8_t operation>
+   static std::uint16_t kernel(const std::uint8_t a,
+                               const std::uint8_t b,
+                               const std::uint16_t carry);
+
+   /********************************************************************************
+   * shifted: Returns kernel output for a shift, where bit 8 of specified result
+   *          is the last bit shifted out. The overflow flag is set to N ^ C.
+   *          Zero steps leave the status register unaffected.
+   ********************************************************************************/
+   static std::uint16_t shifted(const std::uint16_t result,
+                                const std::uint8_t steps)
+   {
+      const auto overflow = ((result >> 7) ^ (result >> 8)) & 1;
+      const auto unaffected = static_cast<int>(steps == 0);
+      return static_cast<std::uint16_t>(result | (overflow << overflow_bit) | (unaffected << unaffected_bit));
+   }
+
+   template<> constexpr std::uint16_t kernel<OR>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return a | b;
+   }
+
+   template<> constexpr std::uint16_t kernel<AND>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return a & b;
+   }
+
+   template<> constexpr std::uint16_t kernel<XOR>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return a ^ b;
+   }
+
+   template<> constexpr std::uint16_t kernel<ADD>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      const auto result = a + b;
+      const auto overflow = ((~(a ^ b) & (a ^ result)) >> 7) & 1;
+      return static_cast<std::uint16_t>(result | (overflow << overflow_bit));
+   }
+
+   template<> constexpr std::uint16_t kernel<SUB>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      const auto negated = (256 - b) & 0xFF;
+      const auto result = a + (256 - b);
+      const auto overflow = ((~(a ^ negated) & (a ^ result)) >> 7) & 1;
+      return static_cast<std::uint16_t>(result | (overflow << overflow_bit));
+   }
+
+   template<> std::uint16_t kernel<LSL>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return shifted(static_cast<std::uint16_t>(b > 8 ? 0 : (a << b) & 0x1FF), b);
+   }
+
+   template<> std::uint16_t kernel<LSR>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      if (b == 0) return shifted(a, b);
+      return shifted(static_cast<std::uint16_t>(b > 8 ? 0 : (a >> b) | (((a >> (b - 1)) & 1) << 8)), b);
+   }
+
+   template<> std::uint16_t kernel<ASR>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      if (b == 0) return shifted(a, b);
+      const auto sa = static_cast<std::int8_t>(a);
+      return shifted(static_cast<std::uint16_t>(static_cast<std::uint8_t>(sa >> (b > 7 ? 7 : b)) |
+                     (((sa >> (b > 8 ? 7 : b - 1)) & 1) << 8)), b);
+   }
+
+   template<> std::uint16_t kernel<ROL>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t carry)
+   {
+      const auto steps = b % 9;
+      const auto x = static_cast<std::uint16_t>((carry << 8) | a);
+      return shifted(static_cast<std::uint16_t>(((x << steps) | (x >> (9 - steps))) & 0x1FF), b);
+   }
+
+   template<> std::uint16_t kernel<ROR>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t carry)
+   {
+      const auto steps = b % 9;
+      const auto x = static_cast<std::uint16_t>((carry << 8) | a);
+      return shifted(static_cast<std::uint16_t>(((x >> steps) | (x << (9 - steps))) & 0x1FF), b);
+   }
+
+   template<> std::uint16_t kernel<SWAP>(const std::uint8_t a, const std::uint8_t, const std::uint16_t)
+   {
+      return static_cast<std::uint16_t>((((a << 4) | (a >> 4)) & 0xFF) | (1 << unaffected_bit));
+   }
+
+   template<> std::uint16_t kernel<ADDUS>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return add_saturated_unsigned(a, b);
+   }
+
+   template<> std::uint16_t kernel<SUBUS>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return sub_saturated_unsigned(a, b);
+   }
+
+   template<> std::uint16_t kernel<ADDSS>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return add_saturated_signed(a, b);
+   }
+
+   template<> std::uint16_t kernel<SUBSS>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return sub_saturated_signed(a, b);
+   }
+
+   template<> std::uint16_t kernel<ADD4>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return add_packed(a, b, 0x88);
+   }
+
+   template<> std::uint16_t kernel<SUB4>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return sub_packed(a, b, 0x88);
+   }
+
+   template<> std::uint16_t kernel<ADD2>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return add_packed(a, b, 0xAA);
+   }
+
+   template<> std::uint16_t kernel<SUB2>(const std::uint8_t a, const std::uint8_t b, const std::uint16_t)
+   {
+      return sub_packed(a, b, 0xAA);
+   }
+
+   template<> std::uint16_t kernel<POPCNT>(const std::uint8_t a, const std::uint8_t, const std::uint16_t)
+   {
+      return bitops::popcount(a);
+   }
+
+   template<> std::uint16_t kernel<CLZ>(const std::uint8_t a, const std::uint8_t, const std::uint16_t)
+   {
+      return bitops::clz8(a);
+   }
+
+   template<> std::uint16_t kernel<CTZ>(const std::uint8_t a, const std::uint8_t, const std::uint16_t)
+   {
+      return bitops::ctz8(a);
+   }
+
+   template<> std::uint16_t kernel<BREV>(const std::uint8_t a, const std::uint8_t, const std::uint16_t)
+   {
+      return bitops::reverse(a);
+   }
+
+   template<> std::uint16_t kernel<PARITY>(const std::uint8_t a, const std::uint8_t, const std::uint16_t)
+   {
+      return bitops::parity(a);
+   }
+
+   /********************************************************************************
+   * execute: Returns the kernel output of specified operation. Operations that
+   *          aren't ALU instructions return 0.
+   *
+   *          - operation: The operation to perform.
+   *          - a        : First operand.
+   *          - b        : Second operand.
+   *          - carry    : The carry flag before the operation (0 or 1).
+   ********************************************************************************/
+   static std::uint16_t execute(const std::uint8_t operation,
+                                const std::uint8_t a,
+                                const std::uint8_t b,
+                                const std::uint16_t carry)
+   {
+      switch (operation)
+      {
+#define ALU_KERNEL(name, code, symbol, form, comment) case name: return kernel<name>(a, b, carry);
+      CPU_ALU_INSTRUCTIONS(ALU_KERNEL)
+#undef ALU_KERNEL
+      default: return 0;
+      }
+   }
+
+   /********************************************************************************
+   * finish: Updates the status flags SNZVC of the referenced status register
+   *         from specified kernel output and returns the 8-bit result.
+   *
+   *         - output: The kernel output.
+   *         - sr    : Reference to status register containing SNZVC flags.
+   ********************************************************************************/
+   static constexpr std::uint8_t finish(const std::uint16_t output,
+                                        std::uint8_t& sr)
+   {
+      if (read(output, unaffected_bit)) return static_cast<std::uint8_t>(output);
+      sr &= ~((1 << S) | (1 << N) | (1 << Z) | (1 << V) | (1 << C));
+
+      if (read(output, carry_bit))                set(sr, C);
+      if (read(output, overflow_bit))             set(sr, V);
+      if (read(output, 7))                        set(sr, N);
+      if (static_cast<std::uint8_t>(output) == 0) set(sr, Z);
+      if (read(sr, N) != read(sr, V))             set(sr, S);
+
+      return static_cast<std::uint8_t>(output);
+   }
+
    /********************************************************************************
    * calculate: Performs calculation with specified operands and returns the 
    *            result. The status flags SNZVC of the referenced status register 
    *            are updated in accordance with the result.
    *
-   *            - operation: The operation to perform (OR, AND, XOR, ADD or SUB).
+   *            The shift and rotate operations LSL, LSR, ASR, ROL and ROR
+   *            shift the first operand the number of steps specified by the
+   *            second operand in one go. The status flags are the ones the last
+   *            single step would leave, i.e. C is the last bit shifted out
+   *            (or through, for the rotations, which shift through the carry
+   *            flag as a 9-bit register) and V = N ^ C. Zero steps leave the
+   *            operand and status register unchanged. SWAP swaps the nibbles
+   *            of the first operand without affecting the status flags.
+   *
+   *            The saturating operations ADDUS, SUBUS, ADDSS and SUBSS clamp
+   *            the result to the unsigned or signed range instead of wrapping
+   *            around. C is set if the result was clamped and V is cleared,
+   *            since the clamped result always has the correct sign. The
+   *            packed operations ADD4, SUB4 (2 x 4-bit lanes), ADD2 and SUB2
+   *            (4 x 2-bit lanes) wrap around within each lane. C is set if
+   *            any lane produced a carry (or borrow) and V is cleared.
+   *
+   *            The bit manipulation operations POPCNT, CLZ, CTZ, BREV and
+   *            PARITY only use the first operand. Z and N are set in accordance
+   *            with the result, while C and V are cleared.
+   *
+   *            The calculation is performed by the kernel of the operation
+   *            (see alu::kernel), selected by a dispatch generated from
+   *            CPU_ALU_INSTRUCTIONS.
+   *
+   *            - operation: The operation to perform (any instruction in
+   *                         CPU_ALU_INSTRUCTIONS, e.g. OR, AND, XOR, ADD or SUB).
    *            - a        : First operand.
    *            - b        : Second operand.
    *            - sr       : Reference to status register containing SNZVC flags.
@@ -71,56 +413,7 @@ namespace alu
                                  const std::uint8_t b,
                                  std::uint8_t& sr)
    {
-      std::uint16_t result = 0x00;
-      sr &= ~((1 << S) | (1 << N) | (1 << Z) | (1 << V) | (1 << C));
-
-      switch (operation)
-      {
-      case OR:
-      {
-         result = a | b;
-         break;
-      }
-      case AND:
-      {
-         result = a & b;
-         break;
-      }
-      case XOR:
-      {
-         result = a ^ b;
-         break;
-      }
-      case ADD:
-      {
-         result = a + b;
-
-         if ((read(a, 7) == read(b, 7)) && (read(a, 7) != read(result, 7)))
-         {
-            set(sr, V);
-         }
-
-         break;
-      }
-      case SUB: 
-      {
-         result = a + (256 - b);
-
-         if ((read(a, 7) == read(256 - b, 7)) && (read(a, 7) != read(result, 7)))
-         {
-            set(sr, V);
-         }
-
-         break;
-      }
-      }
-
-      if (read(result, 8))                        set(sr, C);
-      if (read(result, 7))                        set(sr, N);
-      if (static_cast<std::uint8_t>(result) == 0) set(sr, Z);
-      if (read(sr, N) != read(sr, V))             set(sr, S);
-
-      return static_cast<std::uint8_t>(result);
+      return finish(execute(operation, a, b, read(sr, C) ? 1 : 0), sr);
    }
 
    /********************************************************************************
@@ -128,24 +421,69 @@ namespace alu
    *        and corresponding status flags. The output is printed to the standard
    *        output, i.e. the terminal, as default.
    *
-   *        - operation: The operation to perform (OR, AND, XOR, ADD or SUB).
+   *        - operation: The operation to perform (OR, AND, XOR, ADD, SUB or
+   *                     one of the multiply and divide operations in mdu.hpp).
    *        - a        : First operand.
-   *        - b        : Second operand.
+   *        - b        : Second operand (number of steps for shifts and
+   *                     rotations, printed unsigned).
    *        - ostream  : Reference to output stream (default = std::cout).
    ********************************************************************************/
-   static void print(const std::uint8_t operation,
-                     const std::uint8_t a,
-                     const std::uint8_t b,
-                     std::ostream& ostream = std::cout)
+   static inline void print(const std::uint8_t operation,
+                            const std::uint8_t a,
+                            const std::uint8_t b,
+                            std::ostream& ostream = std::cout)
    {
       std::uint8_t sr = 0x00;
+
+      if (is_wide(operation))
+      {
+         const auto result = mdu::calculate(operation, a, b, sr);
+         const auto signed_a = operation == MULS || operation == MULSU || operation == FMULS || operation == FMULSU;
+         const auto signed_b = operation == MULS || operation == FMULS;
+         ostream << "--------------------------------------------------------------------------------\n";
+         ostream << "Instruction: " << get_instruction_name(operation) << "\n";
+         ostream << "Decimal\t   : " << (signed_a ? get_signed(a) : a) << get_operator(operation)
+            << (signed_b ? get_signed(b) : b) << " = ";
+
+         if (operation == DIV || operation == MOD)
+         {
+            ostream << (result & 0xFF) << " (R1 = " << (result >> 8) << ")\n";
+         }
+         else
+         {
+            ostream << (signed_a ? static_cast<std::int16_t>(result) : result) << "\n";
+         }
+         ostream << "Binary\t   : " << std::bitset<8>(a) << get_operator(operation)
+            << std::bitset<8>(b) << " = " << std::bitset<16>(result) << "\n";
+         ostream << "Status bits: SNZVC = " << std::bitset<5>(sr) << "\n";
+         ostream << "--------------------------------------------------------------------------------\n\n";
+         return;
+      }
+
       const auto result = calculate(operation, a, b, sr);
       ostream << "--------------------------------------------------------------------------------\n";
       ostream << "Instruction: " << get_instruction_name(operation) << "\n";
+
+      if (is_unary(operation))
+      {
+         ostream << "Decimal\t   : " << get_instruction_name(operation) << "(" << static_cast<int>(a)
+            << ") = " << static_cast<int>(result) << "\n";
+         ostream << "Binary\t   : " << get_instruction_name(operation) << "(" << std::bitset<8>(a)
+            << ") = " << std::bitset<8>(result) << "\n";
+         ostream << "Status bits: SNZVC = " << std::bitset<5>(sr) << "\n";
+         ostream << "--------------------------------------------------------------------------------\n\n";
+         return;
+      }
+
       ostream << "Decimal\t   : " << get_signed(a) << get_operator(operation)
-         << get_signed(b) << " = " << get_signed(result, sr) << "\n";
+         << (is_shift(operation) ? static_cast<int>(b) : get_signed(b)) << " = " << get_signed(result, sr) << "\n";
 
-      if (operation == SUB)
+      if (is_shift(operation))
+      {
+         ostream << "Binary\t   : " << std::bitset<8>(a) << get_operator(operation)
+            << static_cast<int>(b) << " = " << std::bitset<8>(result) << "\n";
+      }
+      else if (operation == SUB)
       {
          ostream << "Binary\t   : " << std::bitset<8>(a) << " + " 
             << std::bitset<8>(256 - b) << " = " << std::bitset<8>(result) << "\n";
@@ -159,26 +497,6 @@ namespace alu
       ostream << "--------------------------------------------------------------------------------\n\n";
       return;
    }
-
-   /********************************************************************************
-   * calculate_by_input: Reads an operation and two operands to calculate with
-   *                     the ALU. The result is printed in the terminal along
-   *                     with status bits SNZVC.
-   ********************************************************************************/
-   void calculate_by_input(void)
-   {
-      std::cout << "Enter an operation to perform (OR, AND, XOR, ADD och SUB):\n";
-      const auto op_code = read_op_code();
-
-      std::cout << "Enter the first operand (0 - 255):\n";
-      const auto op1 = read_byte();
-
-      std::cout << "Enter the second operand (0 - 255):\n";
-      const auto op2 = read_byte();
-
-      print(op_code, op1, op2);
-      return;
-   }
 }
 
 #endif /* ALU_HPP_ */
\ No newline at end of file
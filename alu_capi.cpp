@@ -0,0 +1,208 @@
+/********************************************************************************
+* alu_capi.cpp: Implementation of the C interface in alu_capi.h on top of the
+*               header-only ALU and emulator. Every function calling C++ code
+*               that can throw catches all exceptions, since they must not
+*               cross the interface.
+********************************************************************************/
+#include "alu_capi.h"
+#include <new>
+#include "alu.hpp"
+#include "batch.hpp"
+#include "assembler.hpp"
+#include "idle.hpp"
+
+/********************************************************************************
+* alu_context: Emulated CPU with the message of the last failed load.
+********************************************************************************/
+struct alu_context
+{
+   emulator::machine machine;
+   std::string error;
+};
+
+/********************************************************************************
+* own_pages: Makes every page of the data memory of specified machine
+*            writable, so that writes during the run don't allocate pages.
+********************************************************************************/
+static void own_pages(emulator::machine& m)
+{
+   for (std::size_t index = 0; index < emulator::page_count; ++index)
+   {
+      m.own(index);
+   }
+   return;
+}
+
+/********************************************************************************
+* is_range: Returns true if n bytes from specified address fit in data memory.
+********************************************************************************/
+static bool is_range(const std::uint16_t address,
+                     const std::size_t n)
+{
+   return n <= emulator::data_size - address;
+}
+
+uint32_t alu_version(void)
+{
+   return ALU_CAPI_VERSION;
+}
+
+uint8_t alu_calculate(const uint8_t operation,
+                      const uint8_t a,
+                      const uint8_t b,
+                      uint8_t* sr)
+{
+   std::uint8_t unused = 0;
+   return alu::calculate(operation, a, b, sr ? *sr : unused);
+}
+
+int alu_calculate_n(const uint8_t operation,
+                    const uint8_t* a,
+                    const uint8_t* b,
+                    uint8_t* result,
+                    uint8_t* sr,
+                    const size_t n)
+{
+   if (n && (!a || !b || !result || !sr)) return ALU_INVALID_ARGUMENT;
+   batch::calculate(operation, a, b, result, sr, n);
+   return ALU_OK;
+}
+
+alu_context* alu_context_create(void)
+{
+   try
+   {
+      auto context = new alu_context{};
+      own_pages(context->machine);
+      return context;
+   }
+   catch (...)
+   {
+      return nullptr;
+   }
+}
+
+void alu_context_destroy(alu_context* context)
+{
+   delete context;
+   return;
+}
+
+int alu_context_load(alu_context* context,
+                     const char* source)
+{
+   if (!context || !source) return ALU_INVALID_ARGUMENT;
+
+   try
+   {
+      context->error.clear();
+      const auto image = assembler::assemble(source);
+      context->machine.load(image);
+      idle::optimize(context->machine);
+      own_pages(context->machine);
+      return ALU_OK;
+   }
+   catch (std::bad_alloc&)
+   {
+      return ALU_OUT_OF_MEMORY;
+   }
+   catch (std::exception& e)
+   {
+      context->error = e.what();
+      return ALU_INVALID_PROGRAM;
+   }
+   catch (...)
+   {
+      context->error = "Unknown error!";
+      return ALU_INVALID_PROGRAM;
+   }
+}
+
+int alu_context_reset(alu_context* context)
+{
+   if (!context) return ALU_INVALID_ARGUMENT;
+   context->machine.reset();
+   return ALU_OK;
+}
+
+uint64_t alu_context_run(alu_context* context,
+                         const uint64_t limit)
+{
+   if (!context) return 0;
+   const auto start = context->machine.instructions;
+
+   try
+   {
+      context->machine.run(limit);
+      return context->machine.instructions - start;
+   }
+   catch (...)
+   {
+      return context->machine.instructions - start;
+   }
+}
+
+int alu_context_state(const alu_context* context,
+                      alu_state* state)
+{
+   if (!context || !state) return ALU_INVALID_ARGUMENT;
+   const auto& m = context->machine;
+
+   state->cycles = m.cycles;
+   state->instructions = m.instructions;
+   state->pc = m.pc;
+   state->sp = m.sp;
+   state->sreg = m.sreg;
+   state->halted = m.halted ? 1 : 0;
+   std::copy(m.r.begin(), m.r.end(), state->r);
+   return ALU_OK;
+}
+
+int alu_context_set_register(alu_context* context,
+                             const uint8_t index,
+                             const uint8_t value)
+{
+   if (!context || index >= context->machine.r.size()) return ALU_INVALID_ARGUMENT;
+   context->machine.r[index] = value;
+   return ALU_OK;
+}
+
+int alu_context_read(alu_context* context,
+                     const uint16_t address,
+                     uint8_t* buffer,
+                     const size_t n)
+{
+   if (!context || (n && !buffer) || !is_range(address, n)) return ALU_INVALID_ARGUMENT;
+
+   for (std::size_t i = 0; i < n; ++i)
+   {
+      buffer[i] = context->machine.read(static_cast<std::uint16_t>(address + i));
+   }
+   return ALU_OK;
+}
+
+int alu_context_write(alu_context* context,
+                      const uint16_t address,
+                      const uint8_t* buffer,
+                      const size_t n)
+{
+   if (!context || (n && !buffer) || !is_range(address, n)) return ALU_INVALID_ARGUMENT;
+
+   try
+   {
+      for (std::size_t i = 0; i < n; ++i)
+      {
+         context->machine.write(static_cast<std::uint16_t>(address + i), buffer[i]);
+      }
+      return ALU_OK;
+   }
+   catch (...)
+   {
+      return ALU_OUT_OF_MEMORY;
+   }
+}
+
+const char* alu_context_error(const alu_context* context)
+{
+   return context ? context->error.c_str() : "";
+}
\ No newline at end of file
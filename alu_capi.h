@@ -0,0 +1,210 @@
+/********************************************************************************
+* alu_capi.h: C interface of the ALU and the emulated CPU, built as a shared
+*             library (alu_capi.dll on Windows, see alu_capi.vcxproj) from
+*             alu_capi.cpp. Only C types cross the interface, exceptions are
+*             caught inside the library and reported by status codes, and
+*             structures are only extended at the end, so that programs built
+*             against an older version keep working (see ALU_CAPI_VERSION).
+*
+*             - alu_calculate performs one operation as alu::calculate.
+*             - alu_calculate_n performs one operation on caller-owned
+*               buffers as batch::calculate, without copying or allocating.
+*             - A context holds an emulated CPU (see emulator.hpp), which
+*               assembles and runs programs. Only loading allocates memory,
+*               so that running and accessing the memory never do.
+*
+*             The functions of a context must not be called concurrently for
+*             the same context, while different contexts are independent.
+********************************************************************************/
+#ifndef ALU_CAPI_H_
+#define ALU_CAPI_H_
+
+/* Include directives: */
+#include <stddef.h>
+#include <stdint.h>
+
+/********************************************************************************
+* ALU_API: Exports the functions from the library and imports them into
+*          programs using it. Define ALU_CAPI_EXPORTS when building the library.
+********************************************************************************/
+#if defined(_WIN32)
+#if defined(ALU_CAPI_EXPORTS)
+#define ALU_API __declspec(dllexport)
+#else
+#define ALU_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define ALU_API __attribute__((visibility("default")))
+#else
+#define ALU_API
+#endif
+
+#define ALU_CAPI_VERSION 1 /* Incremented whenever functions or fields are added. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/********************************************************************************
+* alu_status: Status codes returned by the functions.
+*
+*             - ALU_OK              : Success.
+*             - ALU_INVALID_ARGUMENT: A pointer was null or an address range
+*                                     exceeded the data memory.
+*             - ALU_INVALID_PROGRAM : The program couldn't be assembled, see
+*                                     alu_context_error.
+*             - ALU_OUT_OF_MEMORY   : Memory couldn't be allocated.
+********************************************************************************/
+enum alu_status
+{
+   ALU_OK = 0,
+   ALU_INVALID_ARGUMENT = -1,
+   ALU_INVALID_PROGRAM = -2,
+   ALU_OUT_OF_MEMORY = -3
+};
+
+/********************************************************************************
+* alu_state: Registers and counters of the CPU of a context.
+*
+*            - cycles      : Number of clock cycles since reset.
+*            - instructions: Number of executed instructions since reset.
+*            - pc          : Program counter.
+*            - sp          : Stack pointer.
+*            - sreg        : Status register, SNZVC in bits 4 - 0, I in bit 7.
+*            - halted      : 1 if the CPU executed HALT, else 0.
+*            - r           : Registers R0 - R31.
+********************************************************************************/
+typedef struct alu_state
+{
+   uint64_t cycles;
+   uint64_t instructions;
+   uint16_t pc;
+   uint16_t sp;
+   uint8_t sreg;
+   uint8_t halted;
+   uint8_t r[32];
+} alu_state;
+
+/********************************************************************************
+* alu_context: Opaque context holding an emulated CPU.
+********************************************************************************/
+typedef struct alu_context alu_context;
+
+/********************************************************************************
+* alu_version: Returns ALU_CAPI_VERSION of the library.
+********************************************************************************/
+ALU_API uint32_t alu_version(void);
+
+/********************************************************************************
+* alu_calculate: Performs specified operation and returns the result. The
+*                status flags SNZVC of the referenced status register are
+*                updated as by alu::calculate. Operations that aren't ALU
+*                instructions return 0.
+*
+*                - operation: OP code of the operation (see cpu.hpp).
+*                - a        : First operand.
+*                - b        : Second operand.
+*                - sr       : Pointer to the status register.
+********************************************************************************/
+ALU_API uint8_t alu_calculate(uint8_t operation,
+                              uint8_t a,
+                              uint8_t b,
+                              uint8_t* sr);
+
+/********************************************************************************
+* alu_calculate_n: Performs specified operation on n operand pairs, storing
+*                  the result of element i in result[i] and updating sr[i] as
+*                  alu_calculate would. The buffers are owned by the caller;
+*                  result may be the same buffer as a or b.
+*
+*                  - operation: OP code of the operation (see cpu.hpp).
+*                  - a        : Pointer to the first operands.
+*                  - b        : Pointer to the second operands.
+*                  - result   : Pointer to storage for the results.
+*                  - sr       : Pointer to the status registers.
+*                  - n        : The number of elements.
+********************************************************************************/
+ALU_API int alu_calculate_n(uint8_t operation,
+                            const uint8_t* a,
+                            const uint8_t* b,
+                            uint8_t* result,
+                            uint8_t* sr,
+                            size_t n);
+
+/********************************************************************************
+* alu_context_create: Returns a new context with program memory filled with
+*                     HALT, or null if memory couldn't be allocated.
+********************************************************************************/
+ALU_API alu_context* alu_context_create(void);
+
+/********************************************************************************
+* alu_context_destroy: Destroys specified context (null is ignored).
+********************************************************************************/
+ALU_API void alu_context_destroy(alu_context* context);
+
+/********************************************************************************
+* alu_context_load: Assembles specified null-terminated assembly source (see
+*                   assembler.hpp), loads it and resets the CPU. Idle loops
+*                   are fast-forwarded as with --run (see idle.hpp).
+********************************************************************************/
+ALU_API int alu_context_load(alu_context* context,
+                             const char* source);
+
+/********************************************************************************
+* alu_context_reset: Resets the registers and counters of the CPU, leaving the
+*                    memories unchanged.
+********************************************************************************/
+ALU_API int alu_context_reset(alu_context* context);
+
+/********************************************************************************
+* alu_context_run: Executes instructions until HALT or until specified number
+*                  of instructions has been executed, and returns the number
+*                  of executed instructions (0 if context is null). If the
+*                  run fails, e.g. out of memory, it returns the instructions
+*                  executed before.
+********************************************************************************/
+ALU_API uint64_t alu_context_run(alu_context* context,
+                                 uint64_t limit);
+
+/********************************************************************************
+* alu_context_state: Copies the registers and counters of the CPU to state.
+********************************************************************************/
+ALU_API int alu_context_state(const alu_context* context,
+                              alu_state* state);
+
+/********************************************************************************
+* alu_context_set_register: Sets register R0 - R31 of the CPU.
+********************************************************************************/
+ALU_API int alu_context_set_register(alu_context* context,
+                                     uint8_t index,
+                                     uint8_t value);
+
+/********************************************************************************
+* alu_context_read: Copies n bytes of data memory from specified address to
+*                   buffer.
+********************************************************************************/
+ALU_API int alu_context_read(alu_context* context,
+                             uint16_t address,
+                             uint8_t* buffer,
+                             size_t n);
+
+/********************************************************************************
+* alu_context_write: Copies n bytes from buffer to data memory at specified
+*                    address.
+********************************************************************************/
+ALU_API int alu_context_write(alu_context* context,
+                              uint16_t address,
+                              const uint8_t* buffer,
+                              size_t n);
+
+/********************************************************************************
+* alu_context_error: Returns the message of the last failed alu_context_load
+*                    of specified context, or an empty string.
+********************************************************************************/
+ALU_API const char* alu_context_error(const alu_context* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ALU_CAPI_H_ */
\ No newline at end of file
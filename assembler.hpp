@@ -0,0 +1,735 @@
+/********************************************************************************
+* assembler.hpp: Contains a two-pass assembler producing pre-decoded programs
+*                for the CPU in emulator.hpp. Each line holds at most one
+*                statement, optionally preceded by labels and followed by a
+*                comment starting with ';':
+*
+*                loop:   ADD R16, R17      ; ALU instruction, register operand.
+*                        SUB R16, 0x01     ; ALU instruction, immediate operand.
+*                        BRNE loop         ; Branch to label.
+*                        LD R0, [R26]      ; Load indirect via R27:R26.
+*                        LDI R26, lo(table); Low and high byte of a symbol.
+*
+*                Mnemonics are the ones of CPU_INSTRUCTIONS (see
+*                get_instruction_name), EMULATOR_INSTRUCTIONS and
+*                EMULATOR_BRANCHES, in any case. Immediates are entered in
+*                decimal, hexadecimal (0x) or binary (0b) notation, or as
+*                symbols optionally followed by + or - and a number. The
+*                directives are:
+*
+*                - .equ name, value: Defines a constant (before its use).
+*                - .org address    : Sets the address of the next instruction
+*                                    or data byte of the current segment.
+*                - .text           : Selects the program segment (default).
+*                - .data [address] : Selects the data segment, which starts
+*                                    after the I/O registers at 0x100.
+*                - .byte v, v, ... : Stores bytes in the data segment.
+*
+*                The names of the timer registers, flags and interrupt
+*                vectors in timer.hpp, e.g. TCNT0, TOV0 and TIMER0_OVF_vect,
+*                are predefined symbols.
+*
+*                The first pass parses the lines and assigns addresses to the
+*                labels, the second pass resolves the operands and emits the
+*                pre-decoded instructions. Symbols are kept in an open-addressing
+*                hash table referring to the source text, so that no memory is
+*                allocated per line or symbol.
+********************************************************************************/
+#ifndef ASSEMBLER_HPP_
+#define ASSEMBLER_HPP_
+
+/* Include directives: */
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include "emulator.hpp"
+
+/********************************************************************************
+* assembler: Namespace containing the assembler.
+********************************************************************************/
+namespace assembler
+{
+   using namespace emulator; /* Brings all content of the emulator namespace into current scope. */
+
+   /********************************************************************************
+   * symbol_table: Open-addressing hash table with linear probing, mapping names
+   *               to 32-bit values. The names aren't copied, hence the text
+   *               they refer to must outlive the table.
+   ********************************************************************************/
+   class symbol_table
+   {
+   public:
+
+      /********************************************************************************
+      * symbol_table: Creates a table with room for specified number of symbols
+      *               before growing.
+      ********************************************************************************/
+      explicit symbol_table(const std::size_t capacity = 512)
+      {
+         std::size_t size = 16;
+         while (size < capacity * 2) size <<= 1;
+         entries_.assign(size, entry{});
+      }
+
+      /********************************************************************************
+      * insert: Inserts specified symbol. Returns false if the symbol already
+      *         exists, in which case its value is left unchanged.
+      *
+      *         - name : Pointer to the name.
+      *         - size : The number of characters of the name.
+      *         - value: The value of the symbol.
+      ********************************************************************************/
+      bool insert(const char* name,
+                  const std::size_t size,
+                  const std::uint32_t value)
+      {
+         if ((count_ + 1) * 2 > entries_.size()) grow();
+         const auto h = hash(name, size);
+         auto& e = entries_[probe(name, size, h)];
+         if (e.name) return false;
+         e = entry{ name, static_cast<std::uint32_t>(size), h, value };
+         ++count_;
+         return true;
+      }
+
+      /********************************************************************************
+      * find: Stores the value of specified symbol in the referenced variable and
+      *       returns true if the symbol exists, otherwise false is returned.
+      ********************************************************************************/
+      bool find(const char* name,
+                const std::size_t size,
+                std::uint32_t& value) const
+      {
+         const auto& e = entries_[probe(name, size, hash(name, size))];
+         if (!e.name) return false;
+         value = e.value;
+         return true;
+      }
+
+      /********************************************************************************
+      * size: Returns the number of symbols.
+      ********************************************************************************/
+      std::size_t size(void) const
+      {
+         return count_;
+      }
+
+   private:
+
+      struct entry
+      {
+         const char* name = nullptr;
+         std::uint32_t size = 0;
+         std::uint32_t hash = 0;
+         std::uint32_t value = 0;
+      };
+
+      /********************************************************************************
+      * hash: Returns the FNV-1a hash of specified name.
+      ********************************************************************************/
+      static std::uint32_t hash(const char* name,
+                                const std::size_t size)
+      {
+         std::uint32_t h = 2166136261u;
+
+         for (std::size_t i = 0; i < size; ++i)
+         {
+            h = (h ^ static_cast<std::uint8_t>(name[i])) * 16777619u;
+         }
+         return h;
+      }
+
+      /********************************************************************************
+      * probe: Returns the index of the entry holding specified name, or of the
+      *        empty entry where it would be inserted.
+      ********************************************************************************/
+      std::size_t probe(const char* name,
+                        const std::size_t size,
+                        const std::uint32_t h) const
+      {
+         const auto mask = entries_.size() - 1;
+
+         for (auto i = h & mask;; i = (i + 1) & mask)
+         {
+            const auto& e = entries_[i];
+            if (!e.name) return i;
+            if (e.hash == h && e.size == size && std::memcmp(e.name, name, size) == 0) return i;
+         }
+      }
+
+      /********************************************************************************
+      * grow: Doubles the number of entries and reinserts the symbols.
+      ********************************************************************************/
+      void grow(void)
+      {
+         std::vector<entry> old(entries_.size() * 2);
+         old.swap(entries_);
+
+         for (const auto& e : old)
+         {
+            if (e.name) entries_[probe(e.name, e.size, e.hash)] = e;
+         }
+         return;
+      }
+
+      std::vector<entry> entries_;  /* Entries, a power of two. */
+      std::size_t count_ = 0;       /* Number of symbols. */
+   };
+
+   /********************************************************************************
+   * statement: A parsed instruction or .byte directive awaiting the second pass.
+   ********************************************************************************/
+   struct statement
+   {
+      const char* operands;         /* Operand text (up to the comment). */
+      std::uint32_t size;           /* Number of characters of the operand text. */
+      std::uint32_t line;           /* Line number, for error messages. */
+      std::uint16_t address;        /* Program or data address. */
+      std::uint8_t op;              /* OP code, or NOP with data = true for .byte. */
+      std::uint8_t flag;            /* Status flag of branch aliases. */
+      bool data;                    /* Indicates a .byte directive. */
+   };
+
+   /********************************************************************************
+   * mnemonic: Entry of the mnemonic table.
+   ********************************************************************************/
+   struct mnemonic
+   {
+      std::uint8_t op;
+      std::uint8_t flag;
+   };
+
+   /********************************************************************************
+   * mnemonic_table: Mnemonics (upper case) mapped to indices of their entries.
+   ********************************************************************************/
+   struct mnemonic_table
+   {
+      symbol_table names{ 128 };
+      std::vector<mnemonic> entries;
+   };
+
+   /********************************************************************************
+   * mnemonics: Returns the table of mnemonics, generated from CPU_INSTRUCTIONS,
+   *            EMULATOR_INSTRUCTIONS and EMULATOR_BRANCHES on first use.
+   ********************************************************************************/
+   static const mnemonic_table& mnemonics(void)
+   {
+      static const mnemonic_table table = []()
+      {
+         mnemonic_table t;
+         const auto add = [&t](const char* name, const std::uint8_t op, const std::uint8_t flag)
+         {
+            t.names.insert(name, std::strlen(name), static_cast<std::uint32_t>(t.entries.size()));
+            t.entries.push_back(mnemonic{ op, flag });
+         };
+
+         add("NOP", NOP, 0);
+#define ASSEMBLER_CPU(name, code, symbol, form, comment) add(#name, name, 0);
+         CPU_INSTRUCTIONS(ASSEMBLER_CPU)
+#undef ASSEMBLER_CPU
+#define ASSEMBLER_EMULATOR(name, code, format, comment) add(#name, name, 0);
+         EMULATOR_INSTRUCTIONS(ASSEMBLER_EMULATOR)
+#undef ASSEMBLER_EMULATOR
+#define ASSEMBLER_BRANCH(name, op, flag) add(#name, op, flag);
+         EMULATOR_BRANCHES(ASSEMBLER_BRANCH)
+#undef ASSEMBLER_BRANCH
+         return t;
+      }();
+      return table;
+   }
+
+   /********************************************************************************
+   * program_assembler: Assembles source text into an image for the emulator.
+   ********************************************************************************/
+   class program_assembler
+   {
+   public:
+
+      /********************************************************************************
+      * assemble: Assembles specified source and returns the image. An exception
+      *           of type std::invalid_argument is thrown on errors, with the
+      *           line number in the message.
+      *
+      *           - source: The source text, which must outlive the call.
+      ********************************************************************************/
+      image assemble(const std::string& source)
+      {
+         symbols_ = symbol_table{ 512 };
+#define ASSEMBLER_REGISTER(name, address, comment) symbols_.insert(#name, sizeof(#name) - 1, timer::name);
+         TIMER_REGISTERS(ASSEMBLER_REGISTER)
+#undef ASSEMBLER_REGISTER
+         symbols_.insert("TOV0", 4, timer::TOV0);
+         symbols_.insert("OCF0A", 5, timer::OCF0A);
+         symbols_.insert("OCF0B", 5, timer::OCF0B);
+         symbols_.insert("TIMER0_COMPA_vect", 17, timer::TIMER0_COMPA_vect);
+         symbols_.insert("TIMER0_COMPB_vect", 17, timer::TIMER0_COMPB_vect);
+         symbols_.insert("TIMER0_OVF_vect", 15, timer::TIMER0_OVF_vect);
+         statements_.clear();
+         image img;
+
+         first_pass(source);
+         img.program.assign(program_end_, make(HALT));
+         img.lines.assign(program_end_, 0);
+         img.data.assign(data_end_, 0);
+         second_pass(img);
+         return img;
+      }
+
+      /********************************************************************************
+      * symbols: Returns the symbol table of the last assembled source.
+      ********************************************************************************/
+      const symbol_table& symbols(void) const
+      {
+         return symbols_;
+      }
+
+   private:
+
+      /********************************************************************************
+      * error: Throws an exception with specified message and line number.
+      ********************************************************************************/
+      [[noreturn]] static void error(const std::uint32_t line,
+                                     const char* message)
+      {
+         throw std::invalid_argument("Line " + std::to_string(line) + ": " + message);
+      }
+
+      static bool is_space(const char c) { return c == ' ' || c == '\t' || c == '\r'; }
+      static bool is_name_start(const char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '.'; }
+      static bool is_name(const char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.'; }
+
+      /********************************************************************************
+      * skip_spaces: Advances specified position past white space.
+      ********************************************************************************/
+      static void skip_spaces(const char*& p, const char* end)
+      {
+         while (p < end && is_space(*p)) ++p;
+         return;
+      }
+
+      /********************************************************************************
+      * first_pass: Parses each line, defines labels and constants and records
+      *             the statements with their addresses.
+      ********************************************************************************/
+      void first_pass(const std::string& source)
+      {
+         const auto& table = mnemonics();
+         std::uint32_t location[2] = { 0, io_size };
+         bool in_data = false;
+         std::uint32_t line = 0;
+         program_end_ = 0;
+         data_end_ = 0;
+
+         auto p = source.data();
+         const auto source_end = p + source.size();
+
+         while (p < source_end)
+         {
+            ++line;
+            auto end = p;
+            while (end < source_end && *end != '\n') ++end;
+            const auto next = end + 1;
+            auto comment = p;
+            while (comment < end && *comment != ';') ++comment;
+            end = comment;
+
+            while (true)
+            {
+               skip_spaces(p, end);
+               if (p == end || !is_name_start(*p)) break;
+               auto q = p;
+               while (q < end && is_name(*q)) ++q;
+               auto colon = q;
+               skip_spaces(colon, end);
+               if (colon == end || *colon != ':') break;
+               if (!symbols_.insert(p, static_cast<std::size_t>(q - p), location[in_data])) error(line, "Symbol already defined!");
+               p = colon + 1;
+            }
+
+            if (p < end)
+            {
+               auto q = p;
+               while (q < end && !is_space(*q)) ++q;
+               const auto word = p;
+               const auto size = static_cast<std::size_t>(q - p);
+               skip_spaces(q, end);
+               auto operands_end = end;
+               while (operands_end > q && is_space(operands_end[-1])) --operands_end;
+               const auto operand_size = static_cast<std::uint32_t>(operands_end - q);
+
+               if (*word == '.')
+               {
+                  directive(word, size, q, operand_size, line, location, in_data);
+               }
+               else
+               {
+                  char upper[8];
+                  std::uint32_t index = 0;
+                  if (size > sizeof(upper)) error(line, "Unknown instruction!");
+                  for (std::size_t i = 0; i < size; ++i) upper[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(word[i])));
+                  if (!table.names.find(upper, size, index)) error(line, "Unknown instruction!");
+                  if (in_data) error(line, "Instruction in data segment!");
+                  if (location[0] >= program_size) error(line, "Program memory exceeded!");
+
+                  const auto& m = table.entries[index];
+                  statements_.push_back(statement{ q, operand_size, line, static_cast<std::uint16_t>(location[0]),
+                                                   m.op, m.flag, false });
+                  location[0]++;
+               }
+            }
+
+            program_end_ = std::max(program_end_, location[0]);
+            data_end_ = std::max(data_end_, location[1]);
+            p = next;
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * directive: Processes a directive during the first pass.
+      ********************************************************************************/
+      void directive(const char* word,
+                     const std::size_t size,
+                     const char* operands,
+                     const std::uint32_t operand_size,
+                     const std::uint32_t line,
+                     std::uint32_t* location,
+                     bool& in_data)
+      {
+         const auto end = operands + operand_size;
+         const auto is = [&](const char* name) { return size == std::strlen(name) && std::memcmp(word, name, size) == 0; };
+
+         if (is(".text"))
+         {
+            in_data = false;
+         }
+         else if (is(".data"))
+         {
+            in_data = true;
+            if (operand_size) location[1] = value(operands, end, line, 0xFFFF);
+         }
+         else if (is(".org"))
+         {
+            location[in_data] = value(operands, end, line, 0xFFFF);
+         }
+         else if (is(".equ"))
+         {
+            auto comma = operands;
+            while (comma < end && *comma != ',') ++comma;
+            auto name_end = comma;
+            while (name_end > operands && is_space(name_end[-1])) --name_end;
+            if (comma == end || name_end == operands) error(line, "Expected .equ name, value!");
+            const auto v = value(comma + 1, end, line, 0xFFFF);
+            if (!symbols_.insert(operands, static_cast<std::size_t>(name_end - operands), v)) error(line, "Symbol already defined!");
+         }
+         else if (is(".byte"))
+         {
+            if (!in_data) error(line, ".byte outside data segment!");
+            if (!operand_size) error(line, "Missing operand!");
+            std::uint32_t count = 1;
+            for (auto c = operands; c < end; ++c) count += *c == ',';
+            if (location[1] + count > data_size) error(line, "Data memory exceeded!");
+            statements_.push_back(statement{ operands, operand_size, line, static_cast<std::uint16_t>(location[1]), NOP, 0, true });
+            location[1] += count;
+         }
+         else
+         {
+            error(line, "Unknown directive!");
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * value: Evaluates an immediate in [p, end): a number, a symbol, lo(x) or
+      *        hi(x), optionally followed by + or - and another such term. An
+      *        error is raised if the value is undefined or exceeds the limit.
+      ********************************************************************************/
+      std::uint32_t value(const char* p,
+                          const char* end,
+                          const std::uint32_t line,
+                          const std::uint32_t limit) const
+      {
+         skip_spaces(p, end);
+         const auto v = sum(p, end, line);
+         skip_spaces(p, end);
+         if (p != end) error(line, "Invalid operand!");
+         if (v < -static_cast<std::int64_t>(limit + 1) / 2 || v > static_cast<std::int64_t>(limit)) error(line, "Operand out of range!");
+         return static_cast<std::uint32_t>(v) & limit;
+      }
+
+      std::int64_t sum(const char*& p,
+                       const char* end,
+                       const std::uint32_t line) const
+      {
+         auto v = term(p, end, line);
+
+         while (true)
+         {
+            skip_spaces(p, end);
+            if (p == end || (*p != '+' && *p != '-')) return v;
+            const auto negative = *p++ == '-';
+            const auto t = term(p, end, line);
+            v = negative ? v - t : v + t;
+         }
+      }
+
+      std::int64_t term(const char*& p,
+                        const char* end,
+                        const std::uint32_t line) const
+      {
+         skip_spaces(p, end);
+         if (p == end) error(line, "Missing operand!");
+         if (*p == '-') return -term(++p, end, line);
+
+         if (std::isdigit(static_cast<unsigned char>(*p)))
+         {
+            unsigned base = 10;
+            if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))      base = 16, p += 2;
+            else if (end - p > 2 && p[0] == '0' && (p[1] == 'b' || p[1] == 'B')) base = 2, p += 2;
+            std::int64_t v = 0;
+            std::size_t digits = 0;
+
+            for (; p < end; ++p, ++digits)
+            {
+               const auto c = static_cast<char>(std::tolower(static_cast<unsigned char>(*p)));
+               unsigned digit = base;
+               if (c >= '0' && c <= '9')      digit = static_cast<unsigned>(c - '0');
+               else if (c >= 'a' && c <= 'f') digit = static_cast<unsigned>(c - 'a' + 10);
+               if (digit >= base) break;
+               v = v * base + digit;
+               if (v > 0xFFFFFF) error(line, "Operand out of range!");
+            }
+
+            if (!digits || (p < end && is_name(*p))) error(line, "Invalid number!");
+            return v;
+         }
+
+         if (!is_name_start(*p)) error(line, "Invalid operand!");
+         const auto name = p;
+         while (p < end && is_name(*p)) ++p;
+         const auto size = static_cast<std::size_t>(p - name);
+         skip_spaces(p, end);
+
+         const auto low = size == 2 && std::tolower(name[0]) == 'l' && std::tolower(name[1]) == 'o';
+         const auto high = size == 2 && std::tolower(name[0]) == 'h' && std::tolower(name[1]) == 'i';
+
+         if (p < end && *p == '(' && (low || high))
+         {
+            const auto v = sum(++p, end, line);
+            skip_spaces(p, end);
+            if (p == end || *p != ')') error(line, "Missing closing parenthesis!");
+            ++p;
+            return high ? (v >> 8) & 0xFF : v & 0xFF;
+         }
+
+         std::uint32_t v = 0;
+         if (!symbols_.find(name, size, v)) error(line, "Undefined symbol!");
+         return v;
+      }
+
+      /********************************************************************************
+      * operand: Returns the next comma separated operand of a statement.
+      ********************************************************************************/
+      static void operand(const char*& p,
+                          const char* end,
+                          const char*& first,
+                          const char*& last)
+      {
+         skip_spaces(p, end);
+         first = p;
+         while (p < end && *p != ',') ++p;
+         last = p;
+         while (last > first && is_space(last[-1])) --last;
+         if (p < end) ++p;
+         return;
+      }
+
+      /********************************************************************************
+      * register_number: Returns the number of the register R0 - R31 in
+      *                  [first, last), or -1 if it isn't a register.
+      ********************************************************************************/
+      static int register_number(const char* first,
+                                 const char* last)
+      {
+         if (last - first < 2 || last - first > 3 || (*first != 'R' && *first != 'r')) return -1;
+         int n = 0;
+
+         for (auto c = first + 1; c < last; ++c)
+         {
+            if (!std::isdigit(static_cast<unsigned char>(*c))) return -1;
+            n = n * 10 + (*c - '0');
+         }
+         return n < 32 ? n : -1;
+      }
+
+      /********************************************************************************
+      * reg: Returns the register in [first, last), raising an error otherwise.
+      ********************************************************************************/
+      static std::uint8_t reg(const char* first,
+                              const char* last,
+                              const std::uint32_t line)
+      {
+         const auto n = register_number(first, last);
+         if (n < 0) error(line, "Expected register R0 - R31!");
+         return static_cast<std::uint8_t>(n);
+      }
+
+      /********************************************************************************
+      * pointer: Returns the register of an indirect operand [Rn], raising an
+      *          error otherwise.
+      ********************************************************************************/
+      static std::uint8_t pointer(const char* first,
+                                  const char* last,
+                                  const std::uint32_t line)
+      {
+         if (last - first < 4 || *first != '[' || last[-1] != ']') error(line, "Expected pointer [R0] - [R30]!");
+         auto p = first + 1, q = last - 1;
+         skip_spaces(p, q);
+         while (q > p && is_space(q[-1])) --q;
+         const auto n = reg(p, q, line);
+         if (n == 31) error(line, "Expected pointer [R0] - [R30]!");
+         return n;
+      }
+
+      /********************************************************************************
+      * second_pass: Resolves the operands of the statements and emits the
+      *              instructions and data bytes.
+      ********************************************************************************/
+      void second_pass(image& img) const
+      {
+         for (const auto& s : statements_)
+         {
+            const auto end = s.operands + s.size;
+            auto p = s.operands;
+            const char* first[2] = {};
+            const char* last[2] = {};
+
+            if (s.data)
+            {
+               auto address = s.address;
+
+               while (p < end)
+               {
+                  operand(p, end, first[0], last[0]);
+                  img.data[address++] = static_cast<std::uint8_t>(value(first[0], last[0], s.line, 0xFF));
+               }
+               continue;
+            }
+
+            std::size_t count = 0;
+            while (p < end && count < 2) operand(p, end, first[count], last[count]), ++count;
+            if (p < end) error(s.line, "Too many operands!");
+
+            const auto expect = [&](const std::size_t n)
+            {
+               if (count != n) error(s.line, n == 0 ? "No operands expected!" : n == 1 ? "Expected one operand!" : "Expected two operands!");
+            };
+
+            instruction ins;
+
+            switch (get_format(s.op))
+            {
+            case format::none:
+               expect(0);
+               ins = make(s.op);
+               break;
+            case format::rd:
+               expect(1);
+               ins = make(s.op, reg(first[0], last[0], s.line));
+               break;
+            case format::rr:
+               expect(1);
+               ins = make(s.op, 0, reg(first[0], last[0], s.line));
+               break;
+            case format::rd_rr:
+               expect(2);
+               ins = make(s.op, reg(first[0], last[0], s.line), reg(first[1], last[1], s.line));
+               break;
+            case format::rd_k:
+               expect(2);
+               ins = make(s.op, reg(first[0], last[0], s.line), 0,
+                          static_cast<std::uint16_t>(value(first[1], last[1], s.line, 0xFF)));
+               break;
+            case format::rd_address: case format::rd_pointer:
+            {
+               expect(2);
+               const auto rd = reg(first[0], last[0], s.line);
+               if (first[1] < last[1] && *first[1] == '[') ins = make(LDX, rd, pointer(first[1], last[1], s.line));
+               else                  ins = make(LD, rd, 0, static_cast<std::uint16_t>(value(first[1], last[1], s.line, 0xFFFF)));
+               break;
+            }
+            case format::address_rr: case format::pointer_rr:
+            {
+               expect(2);
+               const auto rr = reg(first[1], last[1], s.line);
+               if (first[0] < last[0] && *first[0] == '[') ins = make(STX, pointer(first[0], last[0], s.line), rr);
+               else                  ins = make(ST, 0, rr, static_cast<std::uint16_t>(value(first[0], last[0], s.line, 0xFFFF)));
+               break;
+            }
+            case format::target:
+               expect(1);
+               ins = make(s.op, 0, 0, static_cast<std::uint16_t>(value(first[0], last[0], s.line, 0xFFFF)));
+               break;
+            case format::bit_target:
+            {
+               if (count == 2)
+               {
+                  const auto flag = value(first[0], last[0], s.line, 0xFF);
+                  if (flag > 7) error(s.line, "Status flag out of range 0 - 7!");
+                  ins = make(s.op, static_cast<std::uint8_t>(flag), 0,
+                             static_cast<std::uint16_t>(value(first[1], last[1], s.line, 0xFFFF)));
+               }
+               else
+               {
+                  expect(1);
+                  ins = make(s.op, s.flag, 0, static_cast<std::uint16_t>(value(first[0], last[0], s.line, 0xFFFF)));
+               }
+               break;
+            }
+            case format::alu_unary:
+            {
+               expect(1);
+               const auto rd = reg(first[0], last[0], s.line);
+               ins = make(s.op, rd, rd);
+               break;
+            }
+            case format::alu:
+            {
+               expect(2);
+               const auto rd = reg(first[0], last[0], s.line);
+               const auto rr = register_number(first[1], last[1]);
+               if (rr >= 0) ins = make(s.op, rd, static_cast<std::uint8_t>(rr));
+               else         ins = make(s.op, rd, immediate, static_cast<std::uint16_t>(value(first[1], last[1], s.line, 0xFF)));
+               break;
+            }
+            case format::mdu:
+               expect(2);
+               ins = make(s.op, reg(first[0], last[0], s.line), reg(first[1], last[1], s.line));
+               break;
+            }
+
+            img.program[s.address] = ins;
+            img.lines[s.address] = s.line;
+         }
+         return;
+      }
+
+      symbol_table symbols_;                /* Labels and constants. */
+      std::vector<statement> statements_;   /* Statements of the first pass. */
+      std::uint32_t program_end_ = 0;       /* End of the program segment. */
+      std::uint32_t data_end_ = 0;          /* End of the data segment. */
+   };
+
+   /********************************************************************************
+   * assemble: Assembles specified source and returns the image, see
+   *           program_assembler::assemble.
+   ********************************************************************************/
+   static image assemble(const std::string& source)
+   {
+      program_assembler a;
+      return a.assemble(source);
+   }
+}
+
+#endif /* ASSEMBLER_HPP_ */
\ No newline at end of file
@@ -0,0 +1,313 @@
+/********************************************************************************
+* batch.hpp: Contains function definitions for performing the same ALU
+*            operation on many operand pairs at once. Each element gets its
+*            own status register, updated exactly as alu::calculate would.
+*
+*            The dispatch is generated from CPU_ALU_INSTRUCTIONS: each ALU
+*            operation gets its own loop calling the kernel of the operation
+*            (see alu::kernel), with the status flags computed without
+*            branches and the buffers qualified as not overlapping, so that
+*            optimizing compilers (e.g. GCC at -O3) can vectorize the loops
+*            of the simpler kernels without runtime alias checks. Calls with
+*            the result in place of an operand are processed through a buffer
+*            on the stack, so that the qualification holds. On
+*            x86 hosts supporting SSE2, the saturating operations are
+*            processed 16 elements at a time with the saturating SIMD
+*            instructions, and the packed operations with the lane masks of
+*            alu::add_packed and alu::sub_packed applied to 16 bytes.
+********************************************************************************/
+#ifndef BATCH_HPP_
+#define BATCH_HPP_
+
+/* Include directives: */
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "alu.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BATCH_SSE2 1
+#endif
+
+/********************************************************************************
+* batch: Namespace containing batch versions of the ALU functions.
+********************************************************************************/
+namespace batch
+{
+   using namespace cpu; /* Brings all content of the cpu namespace into current scope. */
+
+   /********************************************************************************
+   * update: Returns the status register sr updated from specified kernel
+   *         output, exactly as alu::finish would update it. The calculation is
+   *         branch-free, so that loops calling it can be vectorized.
+   ********************************************************************************/
+   static std::uint8_t update(const std::uint16_t output,
+                              const std::uint8_t sr)
+   {
+      const auto c = (output >> alu::carry_bit) & 1;
+      const auto v = (output >> alu::overflow_bit) & 1;
+      const auto n = (output >> 7) & 1;
+      const auto z = static_cast<int>((output & 0xFF) == 0);
+      const auto unaffected = (output >> alu::unaffected_bit) & 1;
+      const auto flags = ((n ^ v) << S) | (n << N) | (z << Z) | (v << V) | (c << C);
+      const auto updated = (sr & ~0x1F) | flags;
+      return static_cast<std::uint8_t>(sr ^ ((sr ^ updated) & (unaffected - 1)));
+   }
+
+   /********************************************************************************
+   * apply: Applies the kernel of specified operation to the elements from
+   *        index first to n. The loop is free of branches for all kernels
+   *        except some shifts, and can be vectorized by the compiler. None
+   *        of the buffers may overlap.
+   ********************************************************************************/
+   template<std::uint8_t operation>
+   static void apply(const std::uint8_t* __restrict a,
+                     const std::uint8_t* __restrict b,
+                     std::uint8_t* __restrict result,
+                     std::uint8_t* __restrict sr,
+                     const std::size_t first,
+                     const std::size_t n)
+   {
+      for (auto i = first; i < n; ++i)
+      {
+         const auto output = alu::kernel<operation>(a[i], b[i], (sr[i] >> C) & 1);
+         result[i] = static_cast<std::uint8_t>(output);
+         sr[i] = update(output, sr[i]);
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * simd: Processes the elements with explicit SIMD instructions, if available
+   *       for specified operation, and returns the number of processed
+   *       elements. The remaining elements are processed by apply.
+   ********************************************************************************/
+   template<std::uint8_t operation>
+   static std::size_t simd(const std::uint8_t*,
+                           const std::uint8_t*,
+                           std::uint8_t*,
+                           std::uint8_t*,
+                           const std::size_t)
+   {
+      return 0;
+   }
+
+#ifdef BATCH_SSE2
+   /********************************************************************************
+   * store_sse2: Stores 16 results and updates their status registers, with C
+   *             set where carry is nonzero and V cleared, as the saturating
+   *             and packed operations do.
+   ********************************************************************************/
+   static void store_sse2(const __m128i value,
+                          const __m128i carry,
+                          std::uint8_t* result,
+                          std::uint8_t* sr)
+   {
+      const auto zero = _mm_setzero_si128();
+      const auto keep = _mm_set1_epi8(static_cast<char>(0xE0));
+      const auto c = _mm_andnot_si128(_mm_cmpeq_epi8(carry, zero), _mm_set1_epi8(1 << C));
+      const auto negative = _mm_cmplt_epi8(value, zero);
+      const auto n_s = _mm_and_si128(negative, _mm_set1_epi8((1 << N) | (1 << S)));
+      const auto z = _mm_and_si128(_mm_cmpeq_epi8(value, zero), _mm_set1_epi8(1 << Z));
+      const auto vsr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sr));
+      const auto flags = _mm_or_si128(_mm_or_si128(c, n_s), z);
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(result), value);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(sr), _mm_or_si128(_mm_and_si128(vsr, keep), flags));
+      return;
+   }
+
+   /********************************************************************************
+   * saturated_sse2: Performs a saturating operation 16 elements at a time with
+   *                 SSE2 and returns the number of processed elements. The
+   *                 carry flag is set where the saturated result differs from
+   *                 the wrapped around result.
+   ********************************************************************************/
+   template<class Saturated, class Wrapped>
+   static std::size_t saturated_sse2(Saturated saturate,
+                                     Wrapped wrap,
+                                     const std::uint8_t* a,
+                                     const std::uint8_t* b,
+                                     std::uint8_t* result,
+                                     std::uint8_t* sr,
+                                     const std::size_t n)
+   {
+      std::size_t i = 0;
+
+      for (; i + 16 <= n; i += 16)
+      {
+         const auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+         const auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+         const auto saturated = saturate(va, vb);
+         store_sse2(saturated, _mm_xor_si128(saturated, wrap(va, vb)), result + i, sr + i);
+      }
+      return i;
+   }
+
+   /********************************************************************************
+   * packed_sse2: Performs a packed addition or subtraction (see alu::add_packed
+   *              and alu::sub_packed) 16 elements at a time with SSE2 and
+   *              returns the number of processed elements. Clearing or setting
+   *              the most significant bit of each lane (msbs) keeps the carries
+   *              within the lanes, as in the scalar versions.
+   ********************************************************************************/
+   template<bool subtract>
+   static std::size_t packed_sse2(const std::uint8_t msbs,
+                                  const std::uint8_t* a,
+                                  const std::uint8_t* b,
+                                  std::uint8_t* result,
+                                  std::uint8_t* sr,
+                                  const std::size_t n)
+   {
+      const auto m = _mm_set1_epi8(static_cast<char>(msbs));
+      const auto ones = _mm_set1_epi8(static_cast<char>(0xFF));
+      std::size_t i = 0;
+
+      for (; i + 16 <= n; i += 16)
+      {
+         const auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+         const auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+         __m128i value, carries;
+
+         if (subtract)
+         {
+            const auto difference = _mm_sub_epi8(_mm_or_si128(va, m), _mm_andnot_si128(m, vb));
+            value = _mm_xor_si128(difference, _mm_and_si128(_mm_xor_si128(va, _mm_xor_si128(vb, ones)), m));
+            carries = _mm_or_si128(_mm_andnot_si128(va, vb), _mm_andnot_si128(_mm_xor_si128(va, vb), value));
+         }
+         else
+         {
+            const auto sum = _mm_add_epi8(_mm_andnot_si128(m, va), _mm_andnot_si128(m, vb));
+            value = _mm_xor_si128(sum, _mm_and_si128(_mm_xor_si128(va, vb), m));
+            carries = _mm_or_si128(_mm_and_si128(va, vb), _mm_andnot_si128(value, _mm_or_si128(va, vb)));
+         }
+         store_sse2(value, _mm_and_si128(carries, m), result + i, sr + i);
+      }
+      return i;
+   }
+
+   template<> std::size_t simd<ADDUS>(const std::uint8_t* a, const std::uint8_t* b,
+                                      std::uint8_t* result, std::uint8_t* sr, const std::size_t n)
+   {
+      return saturated_sse2([](__m128i x, __m128i y) { return _mm_adds_epu8(x, y); },
+                            [](__m128i x, __m128i y) { return _mm_add_epi8(x, y); }, a, b, result, sr, n);
+   }
+
+   template<> std::size_t simd<SUBUS>(const std::uint8_t* a, const std::uint8_t* b,
+                                      std::uint8_t* result, std::uint8_t* sr, const std::size_t n)
+   {
+      return saturated_sse2([](__m128i x, __m128i y) { return _mm_subs_epu8(x, y); },
+                            [](__m128i x, __m128i y) { return _mm_sub_epi8(x, y); }, a, b, result, sr, n);
+   }
+
+   template<> std::size_t simd<ADDSS>(const std::uint8_t* a, const std::uint8_t* b,
+                                      std::uint8_t* result, std::uint8_t* sr, const std::size_t n)
+   {
+      return saturated_sse2([](__m128i x, __m128i y) { return _mm_adds_epi8(x, y); },
+                            [](__m128i x, __m128i y) { return _mm_add_epi8(x, y); }, a, b, result, sr, n);
+   }
+
+   template<> std::size_t simd<SUBSS>(const std::uint8_t* a, const std::uint8_t* b,
+                                      std::uint8_t* result, std::uint8_t* sr, const std::size_t n)
+   {
+      return saturated_sse2([](__m128i x, __m128i y) { return _mm_subs_epi8(x, y); },
+                            [](__m128i x, __m128i y) { return _mm_sub_epi8(x, y); }, a, b, result, sr, n);
+   }
+
+   template<> std::size_t simd<ADD4>(const std::uint8_t* a, const std::uint8_t* b,
+                                     std::uint8_t* result, std::uint8_t* sr, const std::size_t n)
+   {
+      return packed_sse2<false>(0x88, a, b, result, sr, n);
+   }
+
+   template<> std::size_t simd<SUB4>(const std::uint8_t* a, const std::uint8_t* b,
+                                     std::uint8_t* result, std::uint8_t* sr, const std::size_t n)
+   {
+      return packed_sse2<true>(0x88, a, b, result, sr, n);
+   }
+
+   template<> std::size_t simd<ADD2>(const std::uint8_t* a, const std::uint8_t* b,
+                                     std::uint8_t* result, std::uint8_t* sr, const std::size_t n)
+   {
+      return packed_sse2<false>(0xAA, a, b, result, sr, n);
+   }
+
+   template<> std::size_t simd<SUB2>(const std::uint8_t* a, const std::uint8_t* b,
+                                     std::uint8_t* result, std::uint8_t* sr, const std::size_t n)
+   {
+      return packed_sse2<true>(0xAA, a, b, result, sr, n);
+   }
+#endif /* BATCH_SSE2 */
+
+   /********************************************************************************
+   * dispatch: Performs specified operation on n operand pairs in buffers that
+   *           don't overlap, see calculate. The dispatch is generated from
+   *           CPU_ALU_INSTRUCTIONS.
+   ********************************************************************************/
+   static void dispatch(const std::uint8_t operation,
+                        const std::uint8_t* a,
+                        const std::uint8_t* b,
+                        std::uint8_t* result,
+                        std::uint8_t* sr,
+                        const std::size_t n)
+   {
+      switch (operation)
+      {
+#define BATCH_DISPATCH(name, code, symbol, form, comment) \
+      case name: apply<name>(a, b, result, sr, simd<name>(a, b, result, sr, n), n); break;
+      CPU_ALU_INSTRUCTIONS(BATCH_DISPATCH)
+#undef BATCH_DISPATCH
+      default:
+      {
+         for (std::size_t i = 0; i < n; ++i)
+         {
+            result[i] = alu::calculate(operation, a[i], b[i], sr[i]);
+         }
+         break;
+      }
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * calculate: Performs specified operation on n operand pairs. The result of
+   *            element i is stored in result[i] and the status register sr[i]
+   *            is updated as by alu::calculate(operation, a[i], b[i], sr[i]).
+   *            result may be the same buffer as a or b, in which case blocks
+   *            of 256 elements are calculated into a buffer on the stack and
+   *            copied to result. The buffers must not overlap otherwise.
+   *
+   *            - operation: The operation to perform (any ALU operation).
+   *            - a        : Pointer to the first operands.
+   *            - b        : Pointer to the second operands.
+   *            - result   : Pointer to storage for the results.
+   *            - sr       : Pointer to the status registers.
+   *            - n        : The number of elements.
+   ********************************************************************************/
+   static void calculate(const std::uint8_t operation,
+                         const std::uint8_t* a,
+                         const std::uint8_t* b,
+                         std::uint8_t* result,
+                         std::uint8_t* sr,
+                         const std::size_t n)
+   {
+      if (result != a && result != b)
+      {
+         dispatch(operation, a, b, result, sr, n);
+         return;
+      }
+
+      std::uint8_t block[256];
+
+      for (std::size_t first = 0; first < n; first += sizeof(block))
+      {
+         const auto count = std::min(n - first, sizeof(block));
+         dispatch(operation, a + first, b + first, block, sr + first, count);
+         std::memcpy(result + first, block, count);
+      }
+      return;
+   }
+}
+
+#endif /* BATCH_HPP_ */
\ No newline at end of file
@@ -0,0 +1,1158 @@
+/********************************************************************************
+* benchmark.hpp: Contains benchmarks for measuring the host execution time
+*                of the emulator components. The benchmarks are run by
+*                starting the program with the argument --benchmark.
+********************************************************************************/
+#ifndef BENCHMARK_HPP_
+#define BENCHMARK_HPP_
+
+/* Include directives: */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <iomanip>
+#include <sstream>
+#include "bignum.hpp"
+#include "softfloat.hpp"
+#include "batch.hpp"
+#include "netlist.hpp"
+#include "graph.hpp"
+#include "expr.hpp"
+#include "assembler.hpp"
+#include "disassembler.hpp"
+#include "history.hpp"
+#include "debugger.hpp"
+#include "idle.hpp"
+#include "profiler.hpp"
+#include "coverage.hpp"
+#include "fuzz.hpp"
+#include "checked.hpp"
+
+/********************************************************************************
+* benchmark: Namespace containing benchmarks and timing utilities.
+********************************************************************************/
+namespace benchmark
+{
+   /********************************************************************************
+   * measure: Calls specified function repeatedly and returns the average
+   *          execution time per call in nanoseconds.
+   *
+   *          - function  : The function to measure.
+   *          - iterations: The number of calls to perform.
+   ********************************************************************************/
+   template<class Function>
+   static double measure(Function&& function,
+                         const std::size_t iterations)
+   {
+      const auto start = std::chrono::steady_clock::now();
+
+      for (std::size_t i = 0; i < iterations; ++i)
+      {
+         function();
+      }
+
+      const auto end = std::chrono::steady_clock::now();
+      const auto ns = std::chrono::duration<double, std::nano>(end - start).count();
+      return ns / static_cast<double>(iterations);
+   }
+
+   /********************************************************************************
+   * random_integer: Returns an integer of specified width with random content.
+   *
+   *                 - bytes    : The width of the integer in bytes.
+   *                 - generator: Reference to the random number generator.
+   ********************************************************************************/
+   static bignum::integer random_integer(const std::size_t bytes,
+                                         std::mt19937& generator)
+   {
+      bignum::integer num{ bytes };
+
+      for (std::size_t i = 0; i < num.size(); ++i)
+      {
+         num.data()[i] = static_cast<bignum::limb>(generator());
+      }
+
+      num.normalize();
+      return num;
+   }
+
+   /********************************************************************************
+   * bignum_arithmetic: Measures addition, subtraction and schoolbook/Karatsuba
+   *                    multiplication of random operands from 64 up to 4096
+   *                    bits. The host time per operation is printed together
+   *                    with the number of cycles the 8-bit ALU would have
+   *                    executed. Subtraction is verified by (a + b) - b == a.
+   *
+   *                    - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void bignum_arithmetic(std::ostream& ostream = std::cout)
+   {
+      std::mt19937 generator{ 1 };
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: bignum arithmetic\n";
+      ostream << std::setw(6) << "Bits" << std::setw(10) << "Add [ns]" << std::setw(10) << "Sub [ns]"
+         << std::setw(16) << "Schoolbook [ns]" << std::setw(16) << "Karatsuba [ns]"
+         << std::setw(18) << "Schoolbook [cyc]" << std::setw(18) << "Karatsuba [cyc]" << "\n";
+
+      for (std::size_t bits = 64; bits <= 4096; bits *= 2)
+      {
+         const auto a = random_integer(bits / 8, generator);
+         const auto b = random_integer(bits / 8, generator);
+         const auto iterations = static_cast<std::size_t>(4096 * 4096 / (bits * bits)) + 10;
+         std::uint8_t sr = 0x00;
+
+         const auto add_ns = measure([&]() { bignum::add(a, b, sr); }, iterations * 100);
+         const auto sub_ns = measure([&]() { bignum::sub(a, b, sr); }, iterations * 100);
+         const auto school_ns = measure([&]() { bignum::multiply(a, b, sr, nullptr, false); }, iterations);
+         const auto karatsuba_ns = measure([&]() { bignum::multiply(a, b, sr, nullptr, true); }, iterations);
+
+         bignum::counter school, karatsuba;
+         const auto p1 = bignum::multiply(a, b, sr, &school, false);
+         const auto p2 = bignum::multiply(a, b, sr, &karatsuba, true);
+
+         if (p1 != p2)
+         {
+            ostream << "Mismatch between schoolbook and Karatsuba at " << bits << " bits!\n";
+         }
+
+         if (bignum::sub(bignum::add(a, b, sr), b, sr) != a)
+         {
+            ostream << "Mismatch between addition and subtraction at " << bits << " bits!\n";
+         }
+
+         ostream << std::setw(6) << bits << std::setw(10) << std::fixed << std::setprecision(1) << add_ns
+            << std::setw(10) << sub_ns
+            << std::setw(16) << school_ns << std::setw(16) << karatsuba_ns
+            << std::setw(18) << school.cycles() << std::setw(18) << karatsuba.cycles() << "\n";
+      }
+
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * softfloat_arithmetic: Measures the soft-float operations executed on host
+   *                       words (fast path) and byte by byte with the ALU. The
+   *                       number of 8-bit operations per float operation is
+   *                       printed as well. The results of the fast path are
+   *                       verified against the floating point unit of the host,
+   *                       together with compare, from_int and to_int, and the
+   *                       results and operation counts of the ALU path against
+   *                       the fast path, which checks the cost model. Besides
+   *                       the random operands, all pairs of a fixed set of edge
+   *                       cases are verified: signed zeros, subnormals, the
+   *                       largest finite value, infinities, NaNs, results that
+   *                       overflow or underflow, halfway cases of rounding to
+   *                       nearest even and integers out of range.
+   *
+   *                       - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void softfloat_arithmetic(std::ostream& ostream = std::cout)
+   {
+      using host_function = std::uint32_t(*)(std::uint32_t, std::uint32_t, softfloat::counter*);
+      using alu_function = std::uint32_t(*)(softfloat::alu_machine&, std::uint32_t, std::uint32_t);
+      static constexpr const char* names[] = { "add", "sub", "mul", "div" };
+      static constexpr host_function host[] = { softfloat::add, softfloat::sub, softfloat::mul, softfloat::div };
+      static constexpr alu_function emulated[] = { softfloat::add, softfloat::sub, softfloat::mul, softfloat::div };
+      static constexpr std::size_t iterations = 100000;
+      static constexpr std::uint32_t edges[] =
+      {
+         0x00000000, 0x80000000, 0x00000001, 0x80000001, 0x00000003, 0x007FFFFF, 0x00800000, /* Zeros, subnormals. */
+         0x7F7FFFFF, 0xFF7FFFFF, 0x7F000000, 0x7F800000, 0xFF800000, 0x7FC00000, 0x7F800001, /* Overflow, Inf, NaN. */
+         0x3F800000, 0xBF800000, 0x3F800001, 0x33800000, 0x3F000000, 0x40000000,             /* Halfway sums and products. */
+         0xBFC00000, 0xBF000000, 0x4EFFFFFF, 0x4F000000, 0xCF000000, 0xCF000001              /* Truncation, int range. */
+      };
+      static constexpr std::size_t random = 256, edge_count = sizeof(edges) / sizeof(edges[0]);
+      static constexpr std::size_t count = random + edge_count * edge_count;
+
+      std::mt19937 generator{ 1 };
+      std::uniform_real_distribution<float> distribution{ -1000.0f, 1000.0f };
+      std::uint32_t a[count], b[count];
+      std::size_t mismatches = 0;
+
+      for (std::size_t i = 0; i < random; ++i)
+      {
+         a[i] = softfloat::to_bits(distribution(generator));
+         b[i] = softfloat::to_bits(distribution(generator));
+      }
+
+      for (std::size_t i = random; i < count; ++i)
+      {
+         a[i] = edges[(i - random) / edge_count];
+         b[i] = edges[(i - random) % edge_count];
+      }
+
+      const auto matches = [](const std::uint32_t result, const float expected)
+      {
+         return softfloat::is_nan(result) ? std::isnan(expected) : result == softfloat::to_bits(expected);
+      };
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: soft-float arithmetic\n";
+      ostream << std::setw(6) << "Op" << std::setw(14) << "Host [ns]" << std::setw(14) << "ALU [ns]"
+         << std::setw(16) << "8-bit ops/op" << "\n";
+
+      for (std::size_t op = 0; op < 4; ++op)
+      {
+         softfloat::alu_machine alu_machine;
+         volatile std::uint32_t sink = 0;
+         std::size_t i = 0, operations = 0;
+
+         for (std::size_t j = 0; j < count; ++j)
+         {
+            const auto x = softfloat::from_bits(a[j]), y = softfloat::from_bits(b[j]);
+            const float expected[] = { x + y, x - y, x * y, x / y };
+            softfloat::counter counter, alu_counter;
+            softfloat::alu_machine checked{ &alu_counter };
+            const auto result = host[op](a[j], b[j], &counter);
+            mismatches += !matches(result, expected[op]);
+            mismatches += emulated[op](checked, a[j], b[j]) != result;
+            mismatches += alu_counter.operations != counter.operations;
+            if (j < random) operations += counter.operations;
+         }
+
+         const auto host_ns = measure([&]() { sink = sink ^ host[op](a[i & 255], b[i & 255], nullptr); ++i; }, iterations);
+         const auto alu_ns = measure([&]() { sink = sink ^ emulated[op](alu_machine, a[i & 255], b[i & 255]); ++i; }, iterations / 10);
+
+         ostream << std::setw(6) << names[op] << std::setw(14) << std::fixed << std::setprecision(1) << host_ns
+            << std::setw(14) << alu_ns << std::setw(16) << operations / random << "\n";
+      }
+
+      for (std::size_t j = 0; j < count; ++j)
+      {
+         const auto x = softfloat::from_bits(a[j]), y = softfloat::from_bits(b[j]);
+         const auto value = static_cast<std::int32_t>(j < random ? generator() : a[j]);
+         const auto order = x < y ? softfloat::less : x > y ? softfloat::greater : x == y ? softfloat::equal : softfloat::unordered;
+         const auto truncated = !(x >= -2147483648.0f && x < 2147483648.0f) ? static_cast<std::int32_t>(0x80000000) : static_cast<std::int32_t>(x);
+         softfloat::counter counter, alu_counter;
+         softfloat::alu_machine checked{ &alu_counter };
+         mismatches += softfloat::compare(a[j], b[j], &counter) != order;
+         mismatches += softfloat::from_int(value, &counter) != softfloat::to_bits(static_cast<float>(value));
+         mismatches += softfloat::to_int(a[j], &counter) != truncated;
+         mismatches += softfloat::compare(checked, a[j], b[j]) != order;
+         mismatches += softfloat::from_int(checked, value) != softfloat::to_bits(static_cast<float>(value));
+         mismatches += softfloat::to_int(checked, a[j]) != truncated;
+         mismatches += alu_counter.operations != counter.operations;
+      }
+
+      ostream << "Mismatches against the host: " << mismatches << "\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * batch_arithmetic: Measures the batch path against calling alu::calculate
+   *                   for each element, for all 65 536 operand pairs, with
+   *                   separate buffers and with the result in place of the
+   *                   first operand. The results and status registers of both
+   *                   are verified against alu::calculate.
+   *
+   *                   - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void batch_arithmetic(std::ostream& ostream = std::cout)
+   {
+      static constexpr std::size_t n = 65536;
+      std::vector<std::uint8_t> a(n), b(n), result(n), sr(n, 0), in_place(n);
+
+      for (std::size_t i = 0; i < n; ++i)
+      {
+         a[i] = static_cast<std::uint8_t>(i);
+         b[i] = static_cast<std::uint8_t>(i >> 8);
+      }
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: batch arithmetic (65536 elements)\n";
+      ostream << std::setw(6) << "Op" << std::setw(14) << "Scalar [us]" << std::setw(14) << "Batch [us]"
+         << std::setw(16) << "In place [us]" << std::setw(12) << "Mismatches" << "\n";
+
+      for (const auto operation : { cpu::ADD, cpu::SUB, cpu::ADDUS, cpu::SUBSS, cpu::ADD4, cpu::SUB2 })
+      {
+         const auto scalar_ns = measure([&]()
+         {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+               result[i] = alu::calculate(operation, a[i], b[i], sr[i]);
+            }
+         }, 100);
+         const auto batch_ns = measure([&]()
+         {
+            batch::calculate(operation, a.data(), b.data(), result.data(), sr.data(), n);
+         }, 100);
+         const auto in_place_ns = measure([&]()
+         {
+            in_place = a;
+            batch::calculate(operation, in_place.data(), b.data(), in_place.data(), sr.data(), n);
+         }, 100);
+
+         std::vector<std::uint8_t> expected_sr(n), batch_sr(n), in_place_sr(n);
+         std::size_t mismatches = 0;
+
+         for (std::size_t i = 0; i < n; ++i)
+         {
+            expected_sr[i] = batch_sr[i] = in_place_sr[i] = static_cast<std::uint8_t>(i * 13);
+         }
+
+         in_place = a;
+         batch::calculate(operation, a.data(), b.data(), result.data(), batch_sr.data(), n);
+         batch::calculate(operation, in_place.data(), b.data(), in_place.data(), in_place_sr.data(), n);
+
+         for (std::size_t i = 0; i < n; ++i)
+         {
+            const auto expected = alu::calculate(operation, a[i], b[i], expected_sr[i]);
+            mismatches += result[i] != expected || batch_sr[i] != expected_sr[i];
+            mismatches += in_place[i] != expected || in_place_sr[i] != expected_sr[i];
+         }
+
+         ostream << std::setw(6) << cpu::get_instruction_name(operation) << std::setw(14) << std::fixed
+            << std::setprecision(1) << scalar_ns / 1000 << std::setw(14) << batch_ns / 1000 << std::setw(16)
+            << in_place_ns / 1000 << std::setw(12) << mismatches << "\n";
+      }
+
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * netlist_simulation: Measures the exhaustive bit-parallel sweep of the gate
+   *                     netlist and the event-driven delay statistics for the
+   *                     ripple-carry and carry-lookahead adders.
+   *
+   *                     - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void netlist_simulation(std::ostream& ostream = std::cout)
+   {
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: gate netlist (524288 vectors, 10000 transitions)\n";
+      ostream << std::setw(8) << "Adder" << std::setw(8) << "Gates" << std::setw(12) << "Mismatches"
+         << std::setw(12) << "Sweep [ms]" << std::setw(10) << "Critical" << std::setw(10) << "Settle"
+         << std::setw(12) << "Glitches" << "\n";
+
+      for (const auto adder : { gates::adder_type::ripple_carry, gates::adder_type::carry_lookahead })
+      {
+         gates::netlist netlist{ adder };
+         std::size_t mismatches = 0;
+         const auto sweep_ns = measure([&]() { mismatches = netlist.sweep(); }, 1);
+         const auto stats = netlist.measure_delays(10000);
+
+         ostream << std::setw(8) << (adder == gates::adder_type::ripple_carry ? "RCA" : "CLA")
+            << std::setw(8) << netlist.size() << std::setw(12) << mismatches << std::setw(12) << std::fixed
+            << std::setprecision(1) << sweep_ns / 1e6 << std::setw(10) << stats.critical_path
+            << std::setw(10) << stats.average_settle() << std::setw(12) << stats.glitches << "\n";
+      }
+
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * graph_evaluation: Measures a full evaluation of a dataflow graph against
+   *                   the incremental evaluation after changing one input.
+   *                   The graph consists of 4096 chains of 16 operations.
+   *
+   *                   - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void graph_evaluation(std::ostream& ostream = std::cout)
+   {
+      static constexpr std::uint32_t chains = 4096, depth = 16;
+      static constexpr std::uint8_t operations[] = { cpu::ADD, cpu::XOR, cpu::SUB, cpu::ROL };
+      graph::dataflow_graph dataflow;
+      std::vector<std::uint32_t> inputs;
+
+      for (std::uint32_t i = 0; i < chains; ++i)
+      {
+         inputs.push_back(dataflow.input(static_cast<std::uint8_t>(i)));
+      }
+
+      for (std::uint32_t i = 0; i < chains; ++i)
+      {
+         auto previous = inputs[i];
+
+         for (std::uint32_t j = 0; j < depth; ++j)
+         {
+            const auto neighbour = inputs[(i + j + 1) % chains];
+            previous = dataflow.operation(operations[j % 4], graph::result(previous),
+                                          graph::result(neighbour), graph::flags(previous));
+         }
+      }
+
+      std::size_t iteration = 0, incremental = 0;
+      const auto full_ns = measure([&]()
+      {
+         dataflow.invalidate();
+         dataflow.evaluate();
+      }, 20);
+      const auto full = dataflow.recomputed();
+      const auto incremental_ns = measure([&]()
+      {
+         const auto input = inputs[iteration++ % chains];
+         dataflow.set(input, static_cast<std::uint8_t>(dataflow.value(input) + 1));
+         dataflow.evaluate();
+         incremental += dataflow.recomputed();
+      }, 1000);
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: dataflow graph (" << dataflow.size() << " nodes)\n";
+      ostream << std::setw(14) << "Evaluation" << std::setw(14) << "Nodes" << std::setw(14) << "Time [us]" << "\n";
+      ostream << std::setw(14) << "Full" << std::setw(14) << full << std::setw(14) << std::fixed
+         << std::setprecision(1) << full_ns / 1000 << "\n";
+      ostream << std::setw(14) << "Incremental" << std::setw(14) << incremental / iteration
+         << std::setw(14) << incremental_ns / 1000 << "\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * expression_evaluation: Measures the evaluation of a compiled expression for
+   *                        65 536 bindings, one binding at a time against all
+   *                        bindings at once.
+   *
+   *                        - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void expression_evaluation(std::ostream& ostream = std::cout)
+   {
+      static constexpr std::size_t n = 65536;
+      const expr::expression expression{ "(a + b) & 0x0F ^ c" };
+      std::vector<std::uint8_t> values[3], result(n), sr(n, 0);
+      std::mt19937 generator{ 1 };
+
+      for (auto& v : values)
+      {
+         v.resize(n);
+         for (auto& x : v) x = static_cast<std::uint8_t>(generator());
+      }
+
+      const std::uint8_t* bindings[] = { values[0].data(), values[1].data(), values[2].data() };
+      const auto scalar_ns = measure([&]()
+      {
+         for (std::size_t i = 0; i < n; ++i)
+         {
+            const std::uint8_t binding[] = { values[0][i], values[1][i], values[2][i] };
+            result[i] = expression.evaluate(binding, sr[i]);
+         }
+      }, 20);
+      const auto batch_ns = measure([&]()
+      {
+         expression.evaluate(bindings, result.data(), sr.data(), n);
+      }, 20);
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: expression (a + b) & 0x0F ^ c, " << expression.program().size()
+         << " operations (65536 bindings)\n";
+      ostream << std::setw(14) << "Scalar [us]" << std::setw(14) << "Batch [us]" << "\n";
+      ostream << std::setw(14) << std::fixed << std::setprecision(1) << scalar_ns / 1000
+         << std::setw(14) << batch_ns / 1000 << "\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * assembler_emulator: Measures the assembly of a 100 000 line source and the
+   *                     execution speed of the emulated CPU.
+   *
+   *                     - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void assembler_emulator(std::ostream& ostream = std::cout)
+   {
+      std::string source;
+      source.reserve(4 << 20);
+
+      for (std::size_t i = 0; i < 50000; ++i)
+      {
+         source += "; Block " + std::to_string(i) + "\n";
+         source += "l" + std::to_string(i) + ": " + (i % 2 ? "ADD R16, 0x11" : "BRNE l" + std::to_string(i / 2)) + "\n";
+      }
+
+      emulator::image img;
+      const auto assemble_ns = measure([&]() { img = assembler::assemble(source); }, 5);
+
+      const auto loop = assembler::assemble("       LDI R17, 0\n       LDI R18, 0\n"
+                                            "loop:  ADD R16, R17\n       SUB R17, 1\n       BRNE loop\n"
+                                            "       SUB R18, 1\n       BRNE loop\n       HALT\n");
+      emulator::machine machine;
+      machine.load(loop);
+      const auto run_ns = measure([&]() { machine.run(); }, 1);
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: assembler and emulator\n";
+      ostream << "Assembly of 100000 lines (" << img.program.size() << " instructions): " << std::fixed
+         << std::setprecision(2) << assemble_ns / 1e6 << " ms\n";
+      ostream << "Execution of " << machine.instructions << " instructions: " << run_ns / 1e6 << " ms ("
+         << std::setprecision(1) << machine.instructions * 1e3 / run_ns << " MIPS)\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * disassembly: Measures the disassembly of a program of 64 000 instructions
+   *              and the tracing of a program to a string stream.
+   *
+   *              - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void disassembly(std::ostream& ostream = std::cout)
+   {
+      std::string source;
+      source.reserve(2 << 20);
+
+      for (std::size_t i = 0; i < 16000; ++i)
+      {
+         source += "l" + std::to_string(i) + ": LD R16, [R26]\n       ADD R16, 0x11\n";
+         source += "       ST 0x0200, R16\n       BRNE l" + std::to_string(i) + "\n";
+      }
+
+      const auto img = assembler::assemble(source);
+      std::ostringstream text;
+      const auto disassemble_ns = measure([&]()
+      {
+         text.str({});
+         disassembler::writer out{ text };
+         disassembler::disassemble(img.program, 0, img.program.size(), out);
+      }, 5);
+
+      const auto loop = assembler::assemble("       LDI R18, 0\nloop:  ADD R16, R17\n       SUB R17, 1\n       BRNE loop\n"
+                                            "       SUB R18, 1\n       BRNE loop\n       HALT\n");
+      const std::uint64_t steps = 200000;
+      const auto trace_ns = measure([&]()
+      {
+         std::ostringstream trace;
+         disassembler::writer out{ trace };
+         emulator::machine machine;
+         machine.load(loop);
+         disassembler::trace(machine, steps, out);
+      }, 1);
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: disassembler\n";
+      ostream << "Disassembly of " << img.program.size() << " instructions: " << std::fixed << std::setprecision(2)
+         << disassemble_ns / 1e6 << " ms (" << std::setprecision(1) << img.program.size() * 1e3 / disassemble_ns
+         << " M instructions/s, " << text.str().size() / 1024 << " KiB)\n";
+      ostream << "Trace of " << steps << " instructions: " << std::setprecision(2) << trace_ns / 1e6 << " ms ("
+         << std::setprecision(1) << steps * 1e3 / trace_ns << " M instructions/s)\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * snapshots: Measures saving and restoring the state of a CPU with all 64 KiB
+   *            of data memory in use, where each scenario run from the snapshot
+   *            writes to four pages, compared to copying the full data memory.
+   *
+   *            - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void snapshots(std::ostream& ostream = std::cout)
+   {
+      emulator::machine machine;
+      emulator::image img;
+      img.data.assign(emulator::data_size, 0x55);
+      machine.load(img);
+
+      const std::size_t scenarios = 100000;
+      const auto save_ns = measure([&]() { for (std::size_t i = 0; i < scenarios; ++i) machine.save(); }, 5);
+
+      const auto base = machine.save();
+      machine.page_copies = 0;
+      const auto restore_ns = measure([&]()
+      {
+         for (std::size_t i = 0; i < scenarios; ++i)
+         {
+            for (std::size_t j = 0; j < 4; ++j)
+            {
+               machine.write(static_cast<std::uint16_t>((i * 4 + j) * 4099), static_cast<std::uint8_t>(i));
+            }
+            machine.restore(base);
+         }
+      }, 5);
+      const auto copies = machine.page_copies / 5;
+
+      std::vector<std::uint8_t> data(emulator::data_size, 0x55), saved;
+      const auto copy_ns = measure([&]()
+      {
+         for (std::size_t i = 0; i < scenarios; ++i)
+         {
+            saved = data;
+            data[(i * 4099) % data.size()] = static_cast<std::uint8_t>(i);
+            data.swap(saved);
+         }
+      }, 5);
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: snapshots\n";
+      ostream << "Snapshot: " << std::fixed << std::setprecision(1) << save_ns / scenarios << " ns\n";
+      ostream << "Scenario of 4 page writes and restore: " << restore_ns / scenarios << " ns ("
+         << static_cast<double>(copies) / scenarios << " pages copied)\n";
+      ostream << "Full copy of " << emulator::data_size / 1024 << " KiB data memory: " << copy_ns / scenarios << " ns\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * reverse_execution: Measures the overhead of recording a run of about 17
+   *                    million instructions with checkpoints and the average
+   *                    time of a reverse step at the end of the run, within
+   *                    the sliding window of the latest checkpoints. Then
+   *                    checks that reverse steps from a breakpoint and from
+   *                    HALT of a program with fast-forwarded idle loops give
+   *                    the same state as executing every instruction.
+   *
+   *                    - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void reverse_execution(std::ostream& ostream = std::cout)
+   {
+      const auto program = assembler::assemble("       LDI R19, 64\n"
+                                               "loop:  ADD R16, R17\n       ST 0x0100, R16\n       SUB R17, 1\n       BRNE loop\n"
+                                               "       SUB R18, 1\n       BRNE loop\n       SUB R19, 1\n       BRNE loop\n       HALT\n");
+      emulator::machine machine;
+      machine.load(program);
+      const auto run_ns = measure([&]() { machine.run(); }, 1);
+      const auto instructions = machine.instructions;
+
+      machine.load(program);
+      history::recorder recorder{ machine };
+      const auto record_ns = measure([&]() { recorder.run(); }, 1);
+
+      const std::size_t steps = 1000;
+      const auto reverse_ns = measure([&]() { recorder.reverse_step(); }, steps);
+
+      const auto idle_program = assembler::assemble("       LDI R16, 5\n       ST TCCR0B, R16\n       LDI R20, 100\n"
+                                                    "wait:  LD R17, TIFR0\n       AND R17, 1\n       BREQ wait\n"
+                                                    "       ST TIFR0, R17\n       SUB R20, 1\n       BRNE wait\n       HALT\n");
+      emulator::machine fast, plain;
+      auto exact = true;
+      const auto check = [&](const std::uint64_t instructions)
+      {
+         plain.load(idle_program);
+         plain.run(instructions);
+         exact = exact && fast.r == plain.r && fast.sreg == plain.sreg && fast.pc == plain.pc &&
+                 fast.cycles == plain.cycles && fast.instructions == plain.instructions && fast.halted == plain.halted;
+      };
+
+      fast.load(idle_program);
+      idle::optimize(fast);
+      {
+         debugger::session session{ fast };
+         session.set_breakpoint(6);
+         history::recorder idle_recorder{ fast };
+         idle_recorder.run();
+         const auto hit = fast.instructions;
+         session.set_breakpoint(4);
+         idle_recorder.reverse_step();
+         check(hit - 1);
+         idle_recorder.reverse_continue([](const emulator::machine& m) { return m.pc == 3; });
+         check(hit - 3);
+      }
+
+      fast.load(idle_program);
+      idle::optimize(fast);
+      {
+         history::recorder idle_recorder{ fast };
+         idle_recorder.run();
+         const auto halt = fast.instructions;
+         idle_recorder.reverse_step();
+         check(halt - 1);
+      }
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: reverse execution\n";
+      ostream << "Run of " << instructions << " instructions: " << std::fixed << std::setprecision(2) << run_ns / 1e6
+         << " ms, recorded: " << record_ns / 1e6 << " ms (" << recorder.checkpoints() << " checkpoints, interval "
+         << recorder.interval() << ", earliest reachable state after " << recorder.earliest() << " instructions)\n";
+      ostream << "Reverse step: " << std::setprecision(1) << reverse_ns / 1e3 << " us ("
+         << recorder.replayed() / steps << " instructions executed again)\n";
+      ostream << "Reverse steps with fast-forwarded idle loops and a breakpoint: " << (exact ? "exact" : "different")
+         << " state\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * breakpoints: Measures the execution speed of a loop storing to data memory
+   *              without breakpoints, with a breakpoint and a watchpoint that
+   *              are never hit, and with a list of 16 breakpoints checked before
+   *              every instruction for comparison.
+   *
+   *              - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void breakpoints(std::ostream& ostream = std::cout)
+   {
+      const auto program = assembler::assemble("       LDI R19, 8\n"
+                                               "loop:  ADD R16, R17\n       ST 0x0100, R16\n       SUB R17, 1\n       BRNE loop\n"
+                                               "       SUB R18, 1\n       BRNE loop\n       SUB R19, 1\n       BRNE loop\n       HALT\n");
+      emulator::machine machine;
+      machine.load(program);
+      const auto plain_ns = measure([&]() { machine.run(); }, 1);
+      const auto instructions = machine.instructions;
+
+      machine.load(program);
+      debugger::session session{ machine };
+      session.set_breakpoint(0x0100);
+      session.watch(0x0200, 0x02FF);
+      const auto patched_ns = measure([&]() { session.run(); }, 1);
+
+      machine.load(program);
+      std::vector<std::uint16_t> list(16);
+      for (std::size_t i = 0; i < list.size(); ++i) list[i] = static_cast<std::uint16_t>(0x0100 + i);
+      const auto list_ns = measure([&]()
+      {
+         while (!machine.halted && std::find(list.begin(), list.end(), machine.pc) == list.end()) machine.step();
+      }, 1);
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: breakpoints\n";
+      ostream << "Execution of " << instructions << " instructions without breakpoints: " << std::fixed
+         << std::setprecision(1) << instructions * 1e3 / plain_ns << " MIPS\n";
+      ostream << "With breakpoint and watchpoint (not hit): " << instructions * 1e3 / patched_ns << " MIPS\n";
+      ostream << "With 16 breakpoints checked per instruction: " << instructions * 1e3 / list_ns << " MIPS\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * idle_loops: Measures a program waiting for 100 overflows of the timer with
+   *             prescaler 1024 by polling TOV0, executed instruction by
+   *             instruction and with idle loop fast-forwarding.
+   *
+   *             - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void idle_loops(std::ostream& ostream = std::cout)
+   {
+      const auto program = assembler::assemble("       LDI R16, 5\n       ST TCCR0B, R16\n       LDI R20, 100\n"
+                                               "wait:  LD R17, TIFR0\n       AND R17, 1\n       BREQ wait\n"
+                                               "       ST TIFR0, R17\n       SUB R20, 1\n       BRNE wait\n       HALT\n");
+      emulator::machine plain, fast;
+      plain.load(program);
+      fast.load(program);
+      const auto loops = idle::optimize(fast);
+
+      const auto plain_ns = measure([&]() { plain.run(); }, 1);
+      const auto fast_ns = measure([&]() { fast.run(); }, 1);
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: idle loops\n";
+      ostream << "Execution of " << plain.instructions << " instructions (" << plain.cycles << " cycles): " << std::fixed
+         << std::setprecision(3) << plain_ns / 1e6 << " ms\n";
+      ostream << "With " << loops << " idle loop fast-forwarded: " << fast_ns / 1e6 << " ms (" << std::setprecision(0)
+         << plain_ns / fast_ns << " times faster, " << (fast.cycles == plain.cycles &&
+         fast.instructions == plain.instructions ? "same" : "different") << " cycles and instructions)\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * sleep_mode: Measures a program waiting for 100 overflow interrupts of the
+   *             timer with prescaler 1024, once busy waiting and once in
+   *             sleep mode, where the clock advances to each interrupt in one
+   *             step.
+   *
+   *             - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void sleep_mode(std::ostream& ostream = std::cout)
+   {
+      const auto source = [](const char* wait)
+      {
+         return std::string{ "       JMP main\n.org TIMER0_OVF_vect\n       ADD R20, 1\n       RETI\n"
+                             "main:  LDI R16, 5\n       ST TCCR0B, R16\n       LDI R16, 1\n       ST TIMSK0, R16\n"
+                             "       SEI\nloop:  " } + wait + "\n       MOV R17, R20\n       SUB R17, 100\n"
+                             "       BRNE loop\n       HALT\n";
+      };
+      const auto busy_source = source("NOP");
+      const auto sleep_source = source("SLEEP");
+      emulator::machine busy, sleeping;
+      busy.load(assembler::assemble(busy_source));
+      sleeping.load(assembler::assemble(sleep_source));
+
+      const auto busy_ns = measure([&]() { busy.run(); }, 1);
+      const auto sleep_ns = measure([&]() { sleeping.run(); }, 1);
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: sleep mode\n";
+      ostream << "Busy waiting, " << busy.instructions << " instructions (" << busy.cycles << " cycles): " << std::fixed
+         << std::setprecision(3) << busy_ns / 1e6 << " ms\n";
+      ostream << "Sleeping, " << sleeping.instructions << " instructions (" << sleeping.cycles << " cycles, "
+         << std::setprecision(1) << 100.0 * sleeping.skipped / sleeping.cycles << " % skipped): " << std::setprecision(3)
+         << sleep_ns / 1e6 << " ms (" << std::setprecision(0) << busy_ns / sleep_ns << " times faster)\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * timer_model: Compares the closed-form timer update with the tick-by-tick
+   *              reference on 100 000 random register accesses, 0 - 4095
+   *              cycles apart with random prescalers, and measures both.
+   *
+   *              - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void timer_model(std::ostream& ostream = std::cout)
+   {
+      struct access
+      {
+         std::uint64_t cycle;
+         std::uint16_t address;
+         std::uint8_t value;
+         bool write;
+      };
+
+      static constexpr std::uint16_t addresses[] = { timer::TIFR0, timer::TCCR0B, timer::TCNT0, timer::OCR0A, timer::OCR0B };
+      using update = void (timer::timer0::*)(std::uint64_t);
+      std::mt19937 generator{ 1 };
+      std::vector<access> accesses(100000);
+      std::uint64_t cycle = 0;
+
+      for (auto& a : accesses)
+      {
+         cycle += generator() % 4096;
+         a.cycle = cycle;
+         a.address = addresses[generator() % 5];
+         a.value = static_cast<std::uint8_t>(a.address == timer::TCCR0B ? generator() % 6 : generator());
+         a.write = generator() % 2 == 0;
+      }
+
+      const auto perform = [](timer::timer0& t, const access& a, const update u)
+      {
+         (t.*u)(a.cycle);
+         if (a.write) t.write(a.address, a.value, a.cycle);
+         return;
+      };
+
+      timer::timer0 closed, ticked;
+      std::size_t mismatches = 0;
+
+      for (const auto& a : accesses)
+      {
+         perform(closed, a, &timer::timer0::update);
+         perform(ticked, a, &timer::timer0::update_by_ticks);
+         if (closed.tcnt != ticked.tcnt || closed.tifr != ticked.tifr || closed.tccrb != ticked.tccrb) ++mismatches;
+      }
+
+      const auto replay = [&](const update u)
+      {
+         return measure([&]()
+         {
+            timer::timer0 t;
+            for (const auto& a : accesses) perform(t, a, u);
+         }, 10) / accesses.size();
+      };
+      const auto closed_ns = replay(&timer::timer0::update);
+      const auto ticked_ns = replay(&timer::timer0::update_by_ticks);
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: timer model\n";
+      ostream << "Accesses" << std::setw(14) << "Mismatches" << std::setw(18) << "Closed form [ns]"
+         << std::setw(18) << "By ticks [ns]\n";
+      ostream << std::setw(8) << accesses.size() << std::setw(14) << mismatches << std::setw(18) << std::fixed
+         << std::setprecision(1) << closed_ns << std::setw(17) << ticked_ns << "\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * profiling: Measures a loop kernel and a program calling two short functions
+   *            in nested loops, without the profiler and with the profiler in
+   *            counting and stacks mode (see profiler.hpp). Each profiled run
+   *            is compared with the mean of the plain runs just before and
+   *            after it, and the median of 100 such ratios is taken, which
+   *            is least affected by the load on the host changing between
+   *            runs. Prints the overheads, whether counting mode
+   *            is within its budget of 5 %, the number of addresses whose
+   *            executions or cycles differ between the modes, and the
+   *            instructions of the second program taking the most cycles.
+   *
+   *            - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void profiling(std::ostream& ostream = std::cout)
+   {
+      const auto loops = assembler::assemble("       LDI R20, 200\nouter: LDI R21, 250\n"
+                                             "inner: ADD R16, R17\n       ADD R17, 1\n       XOR R16, R17\n"
+                                             "       ADD R19, R16\n       LSR R18, 1\n       OR R18, R16\n"
+                                             "       SUB R21, 1\n       BRNE inner\n       SUB R20, 1\n"
+                                             "       BRNE outer\n       HALT\n");
+      const auto calls = assembler::assemble("       LDI R20, 200\nouter: LDI R21, 250\n"
+                                             "inner: CALL mix\n       CALL sum\n       SUB R21, 1\n"
+                                             "       BRNE inner\n       SUB R20, 1\n       BRNE outer\n       HALT\n"
+                                             "mix:   XOR R16, R17\n       ADD R17, R16\n       LSL R16, 1\n"
+                                             "       BRCC done\n       OR R16, 0x01\ndone:  RET\n"
+                                             "sum:   LDI R18, 8\nsum_l: ADD R19, R16\n       ADD R19, R17\n"
+                                             "       SUB R18, 1\n       BRNE sum_l\n       RET\n");
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: profiling\n";
+      ostream << "Program" << std::setw(16) << "Instructions" << std::setw(14) << "Plain [ms]" << std::setw(16)
+         << "Counting [%]" << std::setw(14) << "Stacks [%]" << std::setw(10) << "Budget" << std::setw(12) << "Mismatches\n";
+
+      for (const auto* program : { &loops, &calls })
+      {
+         static constexpr std::size_t runs = 100;
+         emulator::machine machine;
+         machine.load(*program);
+         const auto run = [&]() { machine.reset(); machine.run(); };
+         std::vector<double> counted(runs), stacked(runs);
+         auto plain_ns = measure(run, 1), before_ns = plain_ns;
+
+         for (std::size_t i = 0; i < runs; ++i)
+         {
+            double c, s;
+            {
+               profiler::profile profile{ machine, profiler::mode::counting };
+               c = measure(run, 1);
+            }
+            {
+               profiler::profile profile{ machine, profiler::mode::stacks };
+               s = measure(run, 1);
+            }
+            const auto after_ns = measure(run, 1);
+            counted[i] = 2.0 * c / (before_ns + after_ns) - 1.0;
+            stacked[i] = 2.0 * s / (before_ns + after_ns) - 1.0;
+            plain_ns = std::min(plain_ns, after_ns);
+            before_ns = after_ns;
+         }
+
+         std::nth_element(counted.begin(), counted.begin() + runs / 2, counted.end());
+         std::nth_element(stacked.begin(), stacked.begin() + runs / 2, stacked.end());
+
+         profiler::profile stacks{ machine };
+         machine.reset();
+         machine.run();
+         std::vector<std::uint64_t> executions(emulator::program_size), cycles(emulator::program_size);
+         std::size_t mismatches = 0;
+
+         for (std::size_t address = 0; address < emulator::program_size; ++address)
+         {
+            executions[address] = stacks.executions(static_cast<std::uint16_t>(address));
+            cycles[address] = stacks.cycles(static_cast<std::uint16_t>(address));
+         }
+
+         {
+            emulator::machine counted;
+            counted.load(*program);
+            profiler::profile counting{ counted, profiler::mode::counting };
+            counted.run();
+
+            for (std::size_t address = 0; address < emulator::program_size; ++address)
+            {
+               const auto a = static_cast<std::uint16_t>(address);
+               mismatches += counting.executions(a) != executions[address] || counting.cycles(a) != cycles[address];
+            }
+         }
+
+         const auto counting_overhead = 100.0 * counted[runs / 2];
+         ostream << std::setw(7) << (program == &loops ? "Loops" : "Calls") << std::setw(16) << machine.instructions
+            << std::setw(14) << std::fixed << std::setprecision(2) << plain_ns / 1e6 << std::setw(16)
+            << std::setprecision(1) << counting_overhead << std::setw(14) << 100.0 * stacked[runs / 2]
+            << std::setw(9) << (counting_overhead <= 5.0 ? "met" : "exceeded") << std::setw(12) << mismatches << "\n";
+         if (program == &calls) stacks.print(ostream, 5);
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * coverage_recording: Measures the profiling programs with and without the
+   *                     coverage tracker (see coverage.hpp), and the time to
+   *                     reset a bitmap and to merge the bitmaps of many runs.
+   *
+   *                     - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void coverage_recording(std::ostream& ostream = std::cout)
+   {
+      const auto program = assembler::assemble("       LDI R20, 200\nouter: LDI R21, 250\n"
+                                               "inner: CALL mix\n       SUB R21, 1\n       BRNE inner\n"
+                                               "       SUB R20, 1\n       BRNE outer\n       HALT\n"
+                                               "mix:   XOR R16, R17\n       ADD R17, R16\n       LSL R16, 1\n"
+                                               "       BRCC done\n       OR R16, 0x01\ndone:  RET\n");
+      static constexpr std::size_t runs = 1024;
+      emulator::machine plain, covered;
+      plain.load(program);
+      covered.load(program);
+      coverage::tracker tracker{ covered };
+
+      const auto plain_ns = measure([&]() { plain.reset(); plain.run(); }, 10);
+      const auto covered_ns = measure([&]() { covered.reset(); tracker.reset(); covered.run(); }, 10);
+
+      std::vector<coverage::bitmap> maps(runs);
+      coverage::bitmap merged;
+      coverage::clear(merged);
+      for (auto& map : maps) map = tracker.map();
+      const auto merge_ns = measure([&]() { for (const auto& map : maps) coverage::merge(merged, map); }, 10) / runs;
+      const auto reset_ns = measure([&]() { for (auto& map : maps) coverage::clear(map); }, 10) / runs;
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      std::size_t executed = 0;
+      for (std::size_t address = 0; address < emulator::program_size; ++address)
+      {
+         executed += coverage::is_marked(merged.executed, address);
+      }
+
+      ostream << "Benchmark: coverage recording (" << executed << " instructions covered, bitmap of "
+         << sizeof(coverage::bitmap) << " bytes)\n";
+      ostream << "Plain [ms]" << std::setw(15) << "Covered [ms]" << std::setw(15) << "Overhead [%]" << std::setw(13)
+         << "Reset [ns]" << std::setw(13) << "Merge [ns]\n";
+      ostream << std::setw(10) << std::fixed << std::setprecision(2) << plain_ns / 1e6 << std::setw(15)
+         << covered_ns / 1e6 << std::setw(15) << std::setprecision(1) << 100.0 * (covered_ns - plain_ns) / plain_ns
+         << std::setw(13) << reset_ns << std::setw(12) << merge_ns << "\n";
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * differential_fuzzing: Runs the differential fuzzer (see fuzz.hpp) over the
+   *                       ALU backends and prints the throughput, the reached
+   *                       features and any minimized failure.
+   *
+   *                       - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void differential_fuzzing(std::ostream& ostream = std::cout)
+   {
+      static constexpr std::uint64_t tests = 100000;
+      fuzz::fuzzer fuzzer;
+      const auto ns = measure([&]() { fuzzer.run(tests); }, 1);
+
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: differential fuzzing (" << fuzz::lanes << " cases per test)\n";
+      ostream << "Tests" << std::setw(16) << "Cases [M/s]" << std::setw(21) << "Operations [M/s]" << std::setw(11)
+         << "Features" << std::setw(9) << "Corpus" << std::setw(11) << "Failures\n";
+      ostream << std::setw(5) << fuzzer.tests() << std::setw(16) << std::fixed << std::setprecision(2)
+         << 1e3 * fuzzer.tests() * fuzz::lanes / ns << std::setw(21) << 1e3 * fuzzer.operations() / ns
+         << std::setw(11) << fuzzer.features() << std::setw(9) << fuzzer.corpus_size() << std::setw(10)
+         << fuzzer.failures().size() << "\n";
+      for (const auto& f : fuzzer.failures()) fuzzer.print(f, ostream);
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * checked_width: Measures checked ADD and SUB of specified width (see
+   *                checked.hpp) on 4096 random operand pairs, by the bit tests
+   *                of checked::portable and by the host intrinsics, and prints
+   *                one line per operation. Both are verified against a
+   *                reference: for 8-bit values alu::calculate, over all 65536
+   *                operand pairs with C cleared and set before; for wider
+   *                values the bit tests, over the random pairs.
+   ********************************************************************************/
+   template<class T>
+   static void checked_width(std::ostream& ostream)
+   {
+      static constexpr std::size_t count = 4096;
+      std::mt19937 generator{ 1 };
+      std::vector<T> a(count), b(count);
+      volatile std::uint32_t sink = 0;
+
+      for (std::size_t i = 0; i < count; ++i)
+      {
+         a[i] = static_cast<T>(generator());
+         b[i] = static_cast<T>(generator());
+      }
+
+      const auto bit_test = [](const std::uint8_t operation, const T x, const T y)
+      {
+         return operation == cpu::ADD ? checked::portable::add(x, y) : checked::portable::sub(x, y);
+      };
+      const auto reference = [&](const std::uint8_t operation, const T x, const T y, const std::uint8_t carry)
+      {
+         if (sizeof(T) > 1) return bit_test(operation, x, y);
+         std::uint8_t sr = static_cast<std::uint8_t>(carry << cpu::C);
+         const auto result = alu::calculate(operation, static_cast<std::uint8_t>(x), static_cast<std::uint8_t>(y), sr);
+         return checked::outcome<T>{ static_cast<T>(result), static_cast<std::uint8_t>(sr) };
+      };
+      const auto matches = [&](const std::uint8_t operation, const T x, const T y, const std::uint8_t carry)
+      {
+         const auto expected = reference(operation, x, y, carry);
+         const auto portable = bit_test(operation, x, y);
+         const auto actual = checked::calculate(operation, x, y);
+         return expected.result == actual.result && expected.flags == actual.flags &&
+                expected.result == portable.result && expected.flags == portable.flags;
+      };
+
+      for (const auto operation : { cpu::ADD, cpu::SUB })
+      {
+         std::size_t mismatches = 0;
+
+         if (sizeof(T) == 1)
+         {
+            for (std::uint32_t pair = 0; pair < 0x20000; ++pair)
+            {
+               const auto x = static_cast<T>(pair & 0xFF);
+               const auto y = static_cast<T>((pair >> 8) & 0xFF);
+               if (!matches(operation, x, y, static_cast<std::uint8_t>(pair >> 16))) ++mismatches;
+            }
+         }
+         else
+         {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+               if (!matches(operation, a[i], b[i], 0)) ++mismatches;
+            }
+         }
+
+         const auto bit_test_ns = measure([&]()
+         {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+               const auto o = bit_test(operation, a[i], b[i]);
+               sink = sink + (o.result ^ o.flags);
+            }
+         }, 1000) / count;
+
+         const auto intrinsic_ns = measure([&]()
+         {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+               const auto o = operation == cpu::ADD ? checked::add(a[i], b[i]) : checked::sub(a[i], b[i]);
+               sink = sink + (o.result ^ o.flags);
+            }
+         }, 1000) / count;
+
+         ostream << std::setw(5) << 8 * sizeof(T) << std::setw(6) << cpu::get_instruction_name(operation) << std::setw(16)
+            << std::fixed << std::setprecision(2) << bit_test_ns << std::setw(17) << intrinsic_ns << std::setw(12)
+            << mismatches << "\n";
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * checked_arithmetic: Compares checked 8-, 16- and 32-bit arithmetic by host
+   *                     intrinsics with the bit-test approach, see
+   *                     checked_width.
+   *
+   *                     - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void checked_arithmetic(std::ostream& ostream = std::cout)
+   {
+      ostream << "--------------------------------------------------------------------------------\n";
+      ostream << "Benchmark: checked arithmetic (4096 random operand pairs)\n";
+      ostream << "Bits" << std::setw(7) << "Op" << std::setw(16) << "Bit tests [ns]" << std::setw(17)
+         << "Intrinsics [ns]" << std::setw(12) << "Mismatches\n";
+      checked_width<std::uint8_t>(ostream);
+      checked_width<std::uint16_t>(ostream);
+      checked_width<std::uint32_t>(ostream);
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   /********************************************************************************
+   * run: Runs all benchmarks.
+   *
+   *      - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void run(std::ostream& ostream = std::cout)
+   {
+      bignum_arithmetic(ostream);
+      softfloat_arithmetic(ostream);
+      batch_arithmetic(ostream);
+      netlist_simulation(ostream);
+      graph_evaluation(ostream);
+      expression_evaluation(ostream);
+      assembler_emulator(ostream);
+      disassembly(ostream);
+      snapshots(ostream);
+      reverse_execution(ostream);
+      breakpoints(ostream);
+      idle_loops(ostream);
+      sleep_mode(ostream);
+      timer_model(ostream);
+      profiling(ostream);
+      coverage_recording(ostream);
+      differential_fuzzing(ostream);
+      checked_arithmetic(ostream);
+      return;
+   }
+}
+
+#endif /* BENCHMARK_HPP_ */
\ No newline at end of file
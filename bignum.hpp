@@ -0,0 +1,567 @@
+/********************************************************************************
+* bignum.hpp: Contains an arbitrary-precision integer type for modelling
+*             multi-byte arithmetic on 8-bit targets. Numbers are stored in
+*             two's complement with a fixed width in bytes, just like a
+*             chain of 8-bit registers on the target.
+*
+*             Addition and subtraction update the status flags SNZVC with the
+*             same semantics as alu::calculate, as if the operation had been
+*             performed byte by byte with the carry propagated between the
+*             bytes (ADD followed by ADC on an AVR target):
+*
+*             S (Signed)  : Set if N ^ V.
+*             N (Negative): Set if the most significant bit of the result is set.
+*             Z (Zero)    : Set if every byte of the result is zero.
+*             V (Overflow): Set if signed overflow occurs in the most significant
+*                           byte, see alu.hpp.
+*             C (Carry)   : Set if a carry is generated out of the most
+*                           significant byte. During subtraction the carry is
+*                           set if no borrow occurs, since a - b is calculated
+*                           as a + (2^n - b), see alu.hpp.
+*
+*             Internally the calculations are performed on 32-bit host words
+*             (limbs) for speed. The number of operations the 8-bit ALU would
+*             have executed is recorded in an optional counter, where each
+*             32-bit limb operation is accounted for as four byte operations.
+********************************************************************************/
+#ifndef BIGNUM_HPP_
+#define BIGNUM_HPP_
+
+/* Include directives: */
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include "cpu.hpp"
+
+/********************************************************************************
+* bignum: Namespace containing the arbitrary-precision integer type and
+*         its arithmetic operations.
+********************************************************************************/
+namespace bignum
+{
+   using limb = std::uint32_t; /* Host word used for internal calculations. */
+
+   static constexpr std::size_t limb_bytes = sizeof(limb);       /* Bytes per limb. */
+   static constexpr std::size_t limb_bits = limb_bytes * 8;      /* Bits per limb. */
+   static constexpr std::size_t karatsuba_threshold = 24;        /* Limbs below which schoolbook is used. */
+
+   /********************************************************************************
+   * counter: Accounting of the operations the 8-bit ALU would have executed.
+   *
+   *          - additions         : Number of byte additions/subtractions (ADD,
+   *                                ADC, SUB, SBC), each one cycle long.
+   *          - multiplications   : Number of 8 x 8 bit multiplications.
+   *          - cycles_per_multiply: Cycles per 8 x 8 bit multiplication
+   *                                 (default = 2, as for the AVR MUL instruction).
+   ********************************************************************************/
+   struct counter
+   {
+      std::size_t additions = 0;
+      std::size_t multiplications = 0;
+      std::size_t cycles_per_multiply = 2;
+
+      /********************************************************************************
+      * operations: Returns the total number of executed 8-bit operations.
+      ********************************************************************************/
+      std::size_t operations(void) const
+      {
+         return additions + multiplications;
+      }
+
+      /********************************************************************************
+      * cycles: Returns the total number of cycles the operations would take.
+      ********************************************************************************/
+      std::size_t cycles(void) const
+      {
+         return additions + multiplications * cycles_per_multiply;
+      }
+
+      /********************************************************************************
+      * reset: Clears the accounted operations.
+      ********************************************************************************/
+      void reset(void)
+      {
+         additions = 0;
+         multiplications = 0;
+         return;
+      }
+   };
+
+   /********************************************************************************
+   * integer: Fixed-width two's complement integer of arbitrary size. The width
+   *          is specified in bytes and the value is stored in 32-bit limbs,
+   *          least significant limb first. Unused bits of the most significant
+   *          limb are always kept cleared.
+   ********************************************************************************/
+   class integer
+   {
+   public:
+
+      /********************************************************************************
+      * integer: Creates a new integer of specified width, initialized with
+      *          specified value (sign-extended to the full width).
+      *
+      *          - bytes: The width of the integer in bytes (default = 1).
+      *          - value: The initial value (default = 0).
+      ********************************************************************************/
+      explicit integer(const std::size_t bytes = 1,
+                       const std::int64_t value = 0)
+         : bytes_{ bytes }, limbs_((bytes + limb_bytes - 1) / limb_bytes, 0)
+      {
+         if (bytes == 0)
+         {
+            throw std::invalid_argument("Width of integer must be at least one byte!");
+         }
+
+         auto v = static_cast<std::uint64_t>(value);
+         const limb fill = value < 0 ? ~limb{ 0 } : 0;
+
+         for (std::size_t i = 0; i < limbs_.size(); ++i)
+         {
+            if (i < sizeof(v) / limb_bytes)
+            {
+               limbs_[i] = static_cast<limb>(v >> (i * limb_bits));
+            }
+            else
+            {
+               limbs_[i] = fill;
+            }
+         }
+         normalize();
+      }
+
+      /********************************************************************************
+      * from_hex: Returns an integer of specified width parsed from a string of
+      *           hexadecimal digits (optionally prefixed by 0x). Digits beyond
+      *           the width are truncated.
+      *
+      *           - s    : The hexadecimal string.
+      *           - bytes: The width of the integer in bytes.
+      ********************************************************************************/
+      static integer from_hex(const std::string& s,
+                              const std::size_t bytes)
+      {
+         integer result{ bytes };
+         std::size_t end = 0;
+
+         if (s.size() >= 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) end = 2;
+
+         std::size_t nibble = 0;
+
+         for (auto i = s.size(); i > end && nibble < bytes * 2; --i, ++nibble)
+         {
+            const auto c = s[i - 1];
+            limb digit = 0;
+
+            if (c >= '0' && c <= '9')      digit = static_cast<limb>(c - '0');
+            else if (c >= 'a' && c <= 'f') digit = static_cast<limb>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') digit = static_cast<limb>(c - 'A' + 10);
+            else throw std::invalid_argument("Invalid hexadecimal digit!");
+
+            result.limbs_[nibble / (limb_bytes * 2)] |= digit << ((nibble % (limb_bytes * 2)) * 4);
+         }
+
+         return result;
+      }
+
+      /********************************************************************************
+      * to_hex: Returns the value as a string of hexadecimal digits, two digits
+      *         per byte, most significant byte first.
+      ********************************************************************************/
+      std::string to_hex(void) const
+      {
+         static constexpr char digits[] = "0123456789ABCDEF";
+         std::string s(bytes_ * 2, '0');
+
+         for (std::size_t i = 0; i < bytes_; ++i)
+         {
+            const auto b = byte(i);
+            s[s.size() - 1 - i * 2] = digits[b & 0x0F];
+            s[s.size() - 2 - i * 2] = digits[b >> 4];
+         }
+
+         return s;
+      }
+
+      /********************************************************************************
+      * byte: Returns the byte at specified index, where index 0 is the least
+      *       significant byte.
+      *
+      *       - index: Index of the byte to read.
+      ********************************************************************************/
+      std::uint8_t byte(const std::size_t index) const
+      {
+         return static_cast<std::uint8_t>(limbs_[index / limb_bytes] >> ((index % limb_bytes) * 8));
+      }
+
+      /********************************************************************************
+      * bytes: Returns the width of the integer in bytes.
+      ********************************************************************************/
+      std::size_t bytes(void) const
+      {
+         return bytes_;
+      }
+
+      /********************************************************************************
+      * negative: Returns true if the most significant bit is set.
+      ********************************************************************************/
+      bool negative(void) const
+      {
+         return cpu::read(byte(bytes_ - 1), 7);
+      }
+
+      /********************************************************************************
+      * zero: Returns true if all bytes are zero.
+      ********************************************************************************/
+      bool zero(void) const
+      {
+         return std::all_of(limbs_.begin(), limbs_.end(), [](const limb l) { return l == 0; });
+      }
+
+      /********************************************************************************
+      * is_min: Returns true if only the most significant bit is set, i.e. the
+      *         value is the most negative number of the width.
+      ********************************************************************************/
+      bool is_min(void) const
+      {
+         if (!negative()) return false;
+
+         for (std::size_t i = 0; i + 1 < limbs_.size(); ++i)
+         {
+            if (limbs_[i] != 0) return false;
+         }
+
+         return limbs_.back() == top_bit();
+      }
+
+      /********************************************************************************
+      * data: Returns a pointer to the limbs, least significant limb first.
+      ********************************************************************************/
+      const limb* data(void) const { return limbs_.data(); }
+      limb* data(void) { return limbs_.data(); }
+
+      /********************************************************************************
+      * size: Returns the number of limbs.
+      ********************************************************************************/
+      std::size_t size(void) const
+      {
+         return limbs_.size();
+      }
+
+      /********************************************************************************
+      * normalize: Clears unused bits of the most significant limb and returns
+      *            the bit that was carried out of the width (if any).
+      ********************************************************************************/
+      bool normalize(void)
+      {
+         const auto used = (bytes_ % limb_bytes) * 8;
+         if (used == 0) return false;
+         const auto mask = (limb{ 1 } << used) - 1;
+         const auto carry = cpu::read(limbs_.back(), static_cast<std::uint8_t>(used));
+         limbs_.back() &= mask;
+         return carry;
+      }
+
+      bool operator==(const integer& other) const
+      {
+         return bytes_ == other.bytes_ && limbs_ == other.limbs_;
+      }
+
+      bool operator!=(const integer& other) const
+      {
+         return !(*this == other);
+      }
+
+   private:
+
+      /********************************************************************************
+      * top_bit: Returns the sign bit mask within the most significant limb.
+      ********************************************************************************/
+      limb top_bit(void) const
+      {
+         return limb{ 1 } << (((bytes_ - 1) % limb_bytes) * 8 + 7);
+      }
+
+      std::size_t bytes_;        /* Width in bytes. */
+      std::vector<limb> limbs_;  /* Value, least significant limb first. */
+   };
+
+   /********************************************************************************
+   * add_n: Adds n limbs of b to a with specified carry in and stores the sum
+   *        in r. The carry out of the most significant limb is returned.
+   ********************************************************************************/
+   static limb add_n(limb* r, const limb* a, const limb* b,
+                     const std::size_t n, limb carry = 0)
+   {
+      for (std::size_t i = 0; i < n; ++i)
+      {
+         const auto sum = static_cast<std::uint64_t>(a[i]) + b[i] + carry;
+         r[i] = static_cast<limb>(sum);
+         carry = static_cast<limb>(sum >> limb_bits);
+      }
+      return carry;
+   }
+
+   /********************************************************************************
+   * sub_n: Subtracts n limbs of b from a and stores the difference in r.
+   *        The borrow out of the most significant limb is returned.
+   ********************************************************************************/
+   static limb sub_n(limb* r, const limb* a, const limb* b,
+                     const std::size_t n)
+   {
+      limb borrow = 0;
+
+      for (std::size_t i = 0; i < n; ++i)
+      {
+         const auto diff = static_cast<std::uint64_t>(a[i]) - b[i] - borrow;
+         r[i] = static_cast<limb>(diff);
+         borrow = static_cast<limb>((diff >> limb_bits) & 1);
+      }
+      return borrow;
+   }
+
+   /********************************************************************************
+   * add_into: Adds n limbs of b into the rn limbs of r (n <= rn) and
+   *           propagates the carry through the remaining limbs of r.
+   ********************************************************************************/
+   static void add_into(limb* r, const std::size_t rn,
+                        const limb* b, const std::size_t n)
+   {
+      auto carry = add_n(r, r, b, n);
+
+      for (auto i = n; i < rn && carry; ++i)
+      {
+         carry = ++r[i] == 0 ? 1 : 0;
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * update_flags: Updates SNZVC in the referenced status register after an
+   *               addition of a and b into result, where b_negative is the
+   *               sign of the second operand as added by the ALU.
+   ********************************************************************************/
+   static void update_flags(const integer& a,
+                            const bool b_negative,
+                            const integer& result,
+                            const bool carry,
+                            std::uint8_t& sr)
+   {
+      using namespace cpu;
+      sr &= ~((1 << S) | (1 << N) | (1 << Z) | (1 << V) | (1 << C));
+
+      if ((a.negative() == b_negative) && (a.negative() != result.negative()))
+      {
+         set(sr, V);
+      }
+
+      if (carry)                      set(sr, C);
+      if (result.negative())          set(sr, N);
+      if (result.zero())              set(sr, Z);
+      if (read(sr, N) != read(sr, V)) set(sr, S);
+      return;
+   }
+
+   /********************************************************************************
+   * check_width: Throws std::invalid_argument if the operands differ in width.
+   ********************************************************************************/
+   static void check_width(const integer& a,
+                           const integer& b)
+   {
+      if (a.bytes() != b.bytes())
+      {
+         throw std::invalid_argument("Operands must be of the same width!");
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * add: Returns the sum of a and b, truncated to the width of the operands.
+   *      The status flags SNZVC of the referenced status register are updated
+   *      as for an ADD/ADC chain on the 8-bit ALU.
+   *
+   *      - a       : First operand.
+   *      - b       : Second operand (must be of the same width as a).
+   *      - sr      : Reference to status register containing SNZVC flags.
+   *      - counter : Pointer to operation counter (default = none).
+   ********************************************************************************/
+   static integer add(const integer& a,
+                      const integer& b,
+                      std::uint8_t& sr,
+                      counter* counter = nullptr)
+   {
+      check_width(a, b);
+      integer result{ a.bytes() };
+      auto carry = add_n(result.data(), a.data(), b.data(), a.size()) != 0;
+      if (result.bytes() % limb_bytes) carry = result.normalize();
+      update_flags(a, b.negative(), result, carry, sr);
+      if (counter) counter->additions += a.bytes();
+      return result;
+   }
+
+   /********************************************************************************
+   * sub: Returns the difference of a and b, truncated to the width of the
+   *      operands. The difference is calculated as a + (2^n - b) and the status
+   *      flags SNZVC of the referenced status register are updated as for a
+   *      SUB/SBC chain on the 8-bit ALU, see alu::calculate.
+   *
+   *      - a       : First operand.
+   *      - b       : Second operand (must be of the same width as a).
+   *      - sr      : Reference to status register containing SNZVC flags.
+   *      - counter : Pointer to operation counter (default = none).
+   ********************************************************************************/
+   static integer sub(const integer& a,
+                      const integer& b,
+                      std::uint8_t& sr,
+                      counter* counter = nullptr)
+   {
+      check_width(a, b);
+      integer result{ a.bytes() };
+      const auto borrow = sub_n(result.data(), a.data(), b.data(), a.size()) != 0;
+      result.normalize();
+
+      const auto negated_b_negative = (b.zero() || b.is_min()) ? b.negative() : !b.negative();
+      update_flags(a, negated_b_negative, result, !borrow, sr);
+      if (counter) counter->additions += a.bytes();
+      return result;
+   }
+
+   /********************************************************************************
+   * account_schoolbook: Accounts for the 8-bit operations of a schoolbook
+   *                     multiplication of na x nb limbs. Every byte product
+   *                     requires one multiplication and two additions (ADD, ADC)
+   *                     of the 16-bit partial product, and every row ends with
+   *                     a carry propagation.
+   ********************************************************************************/
+   static void account_schoolbook(counter* counter,
+                                  const std::size_t na,
+                                  const std::size_t nb)
+   {
+      if (!counter) return;
+      const auto products = na * nb * limb_bytes * limb_bytes;
+      counter->multiplications += products;
+      counter->additions += products * 2 + na * limb_bytes;
+      return;
+   }
+
+   /********************************************************************************
+   * mul_schoolbook: Multiplies na limbs of a with nb limbs of b and stores the
+   *                 na + nb limb product in r.
+   ********************************************************************************/
+   static void mul_schoolbook(limb* r,
+                              const limb* a, const std::size_t na,
+                              const limb* b, const std::size_t nb,
+                              counter* counter = nullptr)
+   {
+      std::fill(r, r + na + nb, 0);
+
+      for (std::size_t i = 0; i < na; ++i)
+      {
+         std::uint64_t carry = 0;
+
+         for (std::size_t j = 0; j < nb; ++j)
+         {
+            const auto t = static_cast<std::uint64_t>(a[i]) * b[j] + r[i + j] + carry;
+            r[i + j] = static_cast<limb>(t);
+            carry = t >> limb_bits;
+         }
+         r[i + nb] = static_cast<limb>(carry);
+      }
+
+      account_schoolbook(counter, na, nb);
+      return;
+   }
+
+   /********************************************************************************
+   * mul_karatsuba: Multiplies n limbs of a with n limbs of b and stores the
+   *                2n limb product in r. The operands are split into halves
+   *                a = a1 * B^h + a0 and b = b1 * B^h + b0, after which the
+   *                product is obtained by three half-sized multiplications:
+   *
+   *                a * b = z2 * B^2h + (z1 - z2 - z0) * B^h + z0,
+   *
+   *                where z0 = a0 * b0, z2 = a1 * b1 and z1 = (a0 + a1)(b0 + b1).
+   ********************************************************************************/
+   static void mul_karatsuba(limb* r,
+                             const limb* a,
+                             const limb* b,
+                             const std::size_t n,
+                             counter* counter = nullptr)
+   {
+      if (n < karatsuba_threshold)
+      {
+         mul_schoolbook(r, a, n, b, n, counter);
+         return;
+      }
+
+      const auto h = n / 2;
+      const auto hn = n - h;
+      const auto m = hn + 1;
+
+      mul_karatsuba(r, a, b, h, counter);
+      if (h < hn) std::fill(r + 2 * h, r + 2 * hn, 0);
+      mul_karatsuba(r + 2 * h, a + h, b + h, hn, counter);
+
+      std::vector<limb> sa(m, 0), sb(m, 0), z1(2 * m, 0);
+      std::copy(a + h, a + n, sa.begin());
+      std::copy(b + h, b + n, sb.begin());
+      add_into(sa.data(), m, a, h);
+      add_into(sb.data(), m, b, h);
+      mul_karatsuba(z1.data(), sa.data(), sb.data(), m, counter);
+
+      std::vector<limb> z0(2 * m, 0), z2(2 * m, 0);
+      std::copy(r, r + 2 * h, z0.begin());
+      std::copy(r + 2 * h, r + 2 * n, z2.begin());
+      sub_n(z1.data(), z1.data(), z0.data(), 2 * m);
+      sub_n(z1.data(), z1.data(), z2.data(), 2 * m);
+
+      add_into(r + h, 2 * n - h, z1.data(), std::min(2 * m, 2 * n - h));
+
+      if (counter) counter->additions += (2 * m + 4 * m + (2 * n - h)) * limb_bytes;
+      return;
+   }
+
+   /********************************************************************************
+   * multiply: Returns the unsigned product of a and b. The width of the product
+   *           is the sum of the widths of the operands, hence no overflow can
+   *           occur. The flags of the referenced status register are updated
+   *           as for the AVR MUL instruction, i.e. C is set to the most
+   *           significant bit of the product and Z is set if the product is
+   *           zero. Other flags are cleared.
+   *
+   *           - a        : First operand.
+   *           - b        : Second operand.
+   *           - sr       : Reference to status register containing SNZVC flags.
+   *           - counter  : Pointer to operation counter (default = none).
+   *           - karatsuba: Uses Karatsuba multiplication for large operands
+   *                        if true, else schoolbook multiplication (default = true).
+   ********************************************************************************/
+   static integer multiply(const integer& a,
+                           const integer& b,
+                           std::uint8_t& sr,
+                           counter* counter = nullptr,
+                           const bool karatsuba = true)
+   {
+      using namespace cpu;
+      integer result{ a.bytes() + b.bytes() };
+      std::vector<limb> product(a.size() + b.size());
+
+      if (karatsuba && a.size() == b.size() && a.size() >= karatsuba_threshold)
+      {
+         mul_karatsuba(product.data(), a.data(), b.data(), a.size(), counter);
+      }
+      else
+      {
+         mul_schoolbook(product.data(), a.data(), a.size(), b.data(), b.size(), counter);
+      }
+
+      std::copy(product.begin(), product.begin() + result.size(), result.data());
+      sr &= ~((1 << S) | (1 << N) | (1 << Z) | (1 << V) | (1 << C));
+      if (result.negative()) set(sr, C);
+      if (result.zero())     set(sr, Z);
+      return result;
+   }
+}
+
+#endif /* BIGNUM_HPP_ */
\ No newline at end of file
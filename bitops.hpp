@@ -0,0 +1,130 @@
+/********************************************************************************
+* bitops.hpp: Contains bit manipulation functions (population count, leading
+*             and trailing zero count, bit reversal and parity). The functions
+*             are mapped onto the corresponding host instructions via compiler
+*             intrinsics when available, with portable fallbacks otherwise.
+********************************************************************************/
+#ifndef BITOPS_HPP_
+#define BITOPS_HPP_
+
+/* Include directives: */
+#include <cstdint>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+/********************************************************************************
+* bitops: Namespace containing bit manipulation functions.
+********************************************************************************/
+namespace bitops
+{
+   /********************************************************************************
+   * popcount: Returns the number of set bits in specified 32-bit word.
+   *           The popcnt instruction is only used by MSVC if AVX is enabled,
+   *           since older processors lack it.
+   ********************************************************************************/
+   static std::uint8_t popcount(const std::uint32_t x)
+   {
+#if defined(__GNUC__) || defined(__clang__)
+      return static_cast<std::uint8_t>(__builtin_popcount(x));
+#elif defined(_MSC_VER) && defined(__AVX__)
+      return static_cast<std::uint8_t>(__popcnt(x));
+#else
+      auto v = x - ((x >> 1) & 0x55555555);
+      v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+      v = (v + (v >> 4)) & 0x0F0F0F0F;
+      return static_cast<std::uint8_t>((v * 0x01010101) >> 24);
+#endif
+   }
+
+   /********************************************************************************
+   * clz: Returns the number of leading zeros in specified 32-bit word,
+   *      or 32 if the word is zero.
+   ********************************************************************************/
+   static std::uint8_t clz(const std::uint32_t x)
+   {
+      if (x == 0) return 32;
+#if defined(__GNUC__) || defined(__clang__)
+      return static_cast<std::uint8_t>(__builtin_clz(x));
+#elif defined(_MSC_VER)
+      unsigned long index;
+      _BitScanReverse(&index, x);
+      return static_cast<std::uint8_t>(31 - index);
+#else
+      std::uint8_t n = 0;
+      auto v = x;
+      if (!(v & 0xFFFF0000)) { n += 16; v <<= 16; }
+      if (!(v & 0xFF000000)) { n += 8;  v <<= 8; }
+      if (!(v & 0xF0000000)) { n += 4;  v <<= 4; }
+      if (!(v & 0xC0000000)) { n += 2;  v <<= 2; }
+      if (!(v & 0x80000000)) { n += 1; }
+      return n;
+#endif
+   }
+
+   /********************************************************************************
+   * ctz: Returns the number of trailing zeros in specified 32-bit word,
+   *      or 32 if the word is zero.
+   ********************************************************************************/
+   static std::uint8_t ctz(const std::uint32_t x)
+   {
+      if (x == 0) return 32;
+#if defined(__GNUC__) || defined(__clang__)
+      return static_cast<std::uint8_t>(__builtin_ctz(x));
+#elif defined(_MSC_VER)
+      unsigned long index;
+      _BitScanForward(&index, x);
+      return static_cast<std::uint8_t>(index);
+#else
+      return static_cast<std::uint8_t>(popcount((x & (0 - x)) - 1));
+#endif
+   }
+
+   /********************************************************************************
+   * parity: Returns 1 if specified 32-bit word has an odd number of set bits,
+   *         otherwise 0.
+   ********************************************************************************/
+   static std::uint8_t parity(const std::uint32_t x)
+   {
+#if defined(__GNUC__) || defined(__clang__)
+      return static_cast<std::uint8_t>(__builtin_parity(x));
+#else
+      auto v = x ^ (x >> 16);
+      v ^= v >> 8;
+      v ^= v >> 4;
+      return static_cast<std::uint8_t>((0x6996 >> (v & 0x0F)) & 1);
+#endif
+   }
+
+   /********************************************************************************
+   * reverse: Returns specified byte with the order of its bits reversed.
+   ********************************************************************************/
+   static std::uint8_t reverse(std::uint8_t x)
+   {
+      x = static_cast<std::uint8_t>(((x & 0xF0) >> 4) | ((x & 0x0F) << 4));
+      x = static_cast<std::uint8_t>(((x & 0xCC) >> 2) | ((x & 0x33) << 2));
+      x = static_cast<std::uint8_t>(((x & 0xAA) >> 1) | ((x & 0x55) << 1));
+      return x;
+   }
+
+   /********************************************************************************
+   * clz8: Returns the number of leading zeros in specified byte, or 8 if the
+   *       byte is zero.
+   ********************************************************************************/
+   static std::uint8_t clz8(const std::uint8_t x)
+   {
+      return static_cast<std::uint8_t>(clz(static_cast<std::uint32_t>(x) << 24 | 0x00800000));
+   }
+
+   /********************************************************************************
+   * ctz8: Returns the number of trailing zeros in specified byte, or 8 if the
+   *       byte is zero.
+   ********************************************************************************/
+   static std::uint8_t ctz8(const std::uint8_t x)
+   {
+      return ctz(static_cast<std::uint32_t>(x) | 0x100);
+   }
+}
+
+#endif /* BITOPS_HPP_ */
\ No newline at end of file
@@ -0,0 +1,238 @@
+/********************************************************************************
+* checked.hpp: Contains checked arithmetic for 8-, 16- and 32-bit unsigned
+*              host values with the status flags SNZVC of alu::calculate, so
+*              that host code can detect carry, overflow and sign exactly as
+*              the emulated ALU does. Each operation returns the result and
+*              the flags in the bit positions of the status register:
+*
+*              - ADD: C is the carry out of the most significant bit and V is
+*                     set on signed overflow.
+*              - SUB: Calculated as a + (2^n - b) like kernel<SUB>, hence C is
+*                     set if no borrow occurs (a >= b) and V is the signed
+*                     overflow of adding the negated operand, which differs
+*                     from the signed overflow of a - b when b is the most
+*                     negative value (-2^(n-1) can't be negated).
+*              - OR, AND, XOR: C and V are cleared.
+*
+*              N is the most significant bit of the result, Z is set if the
+*              result is zero and S = N ^ V. For 8-bit values, the flags equal
+*              those of alu::calculate with the same operands.
+*
+*              The functions in namespace checked use the overflow intrinsics
+*              of GCC and Clang (__builtin_add_overflow, ...) and the add with
+*              carry intrinsics of MSVC on x86 (_addcarry_u8, ...), so that the
+*              flags come from the host flags register. The functions in
+*              namespace checked::portable calculate the flags by bit tests
+*              on a wider result as alu::kernel does; they are the fallback
+*              for other compilers and the reference in benchmark.hpp.
+********************************************************************************/
+#ifndef CHECKED_HPP_
+#define CHECKED_HPP_
+
+/* Include directives: */
+#include <cstdint>
+#include <type_traits>
+#include "cpu.hpp"
+
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CHECKED_ADDCARRY 1
+#endif
+
+/********************************************************************************
+* checked: Namespace containing checked arithmetic.
+********************************************************************************/
+namespace checked
+{
+   using namespace cpu; /* Brings all content of the cpu namespace into current scope. */
+
+   /********************************************************************************
+   * outcome: Result of a checked operation.
+   *
+   *          - result: The result, wrapped around to the width of T.
+   *          - flags : SNZVC in bits 4 - 0, as in the status register.
+   ********************************************************************************/
+   template<class T>
+   struct outcome
+   {
+      T result;
+      std::uint8_t flags;
+   };
+
+   /********************************************************************************
+   * msb: Index of the most significant bit of T.
+   ********************************************************************************/
+   template<class T>
+   struct msb
+   {
+      static_assert(std::is_same<T, std::uint8_t>::value || std::is_same<T, std::uint16_t>::value ||
+                    std::is_same<T, std::uint32_t>::value, "Only 8-, 16- and 32-bit unsigned values are supported!");
+      static constexpr unsigned value = 8 * sizeof(T) - 1;
+   };
+
+   /********************************************************************************
+   * make: Returns the outcome of specified result with specified carry and
+   *       overflow, deriving N, Z and S from the result.
+   ********************************************************************************/
+   template<class T>
+   static constexpr outcome<T> make(const T result,
+                                    const bool carry,
+                                    const bool overflow)
+   {
+      return outcome<T>{ result, static_cast<std::uint8_t>(
+         ((((result >> msb<T>::value) & 1) ^ static_cast<unsigned>(overflow)) << S) |
+         (((result >> msb<T>::value) & 1) << N) | (static_cast<unsigned>(result == 0) << Z) |
+         (static_cast<unsigned>(overflow) << V) | (static_cast<unsigned>(carry) << C)) };
+   }
+
+   /********************************************************************************
+   * portable: Namespace containing the checked operations calculated by bit
+   *           tests, see the file header.
+   ********************************************************************************/
+   namespace portable
+   {
+      /********************************************************************************
+      * add: Returns a + b with the flags of ADD. The carry is bit n of the sum.
+      ********************************************************************************/
+      template<class T>
+      static constexpr outcome<T> add(const T a,
+                                      const T b)
+      {
+         return make(static_cast<T>(a + b), ((static_cast<std::uint64_t>(a) + b) >> (msb<T>::value + 1)) & 1,
+                     ((~(a ^ b) & (a ^ static_cast<T>(a + b))) >> msb<T>::value) & 1);
+      }
+
+      /********************************************************************************
+      * sub: Returns a - b with the flags of SUB, calculated as a + (2^n - b).
+      ********************************************************************************/
+      template<class T>
+      static constexpr outcome<T> sub(const T a,
+                                      const T b)
+      {
+         return make(static_cast<T>(a - b),
+                     ((static_cast<std::uint64_t>(a) + ((1ULL << (msb<T>::value + 1)) - b)) >> (msb<T>::value + 1)) & 1,
+                     ((~(a ^ static_cast<T>(0 - b)) & (a ^ static_cast<T>(a - b))) >> msb<T>::value) & 1);
+      }
+   }
+
+#ifdef CHECKED_ADDCARRY
+   /********************************************************************************
+   * add_carry: Stores a + b in result and returns the carry (MSVC on x86).
+   ********************************************************************************/
+   static bool add_carry(std::uint8_t a, std::uint8_t b, std::uint8_t& result)    { return _addcarry_u8(0, a, b, &result) != 0; }
+   static bool add_carry(std::uint16_t a, std::uint16_t b, std::uint16_t& result) { return _addcarry_u16(0, a, b, &result) != 0; }
+   static bool add_carry(std::uint32_t a, std::uint32_t b, std::uint32_t& result) { return _addcarry_u32(0, a, b, reinterpret_cast<unsigned int*>(&result)) != 0; }
+
+   /********************************************************************************
+   * sub_borrow: Stores a - b in result and returns the borrow (MSVC on x86).
+   ********************************************************************************/
+   static bool sub_borrow(std::uint8_t a, std::uint8_t b, std::uint8_t& result)    { return _subborrow_u8(0, a, b, &result) != 0; }
+   static bool sub_borrow(std::uint16_t a, std::uint16_t b, std::uint16_t& result) { return _subborrow_u16(0, a, b, &result) != 0; }
+   static bool sub_borrow(std::uint32_t a, std::uint32_t b, std::uint32_t& result) { return _subborrow_u32(0, a, b, reinterpret_cast<unsigned int*>(&result)) != 0; }
+#endif /* CHECKED_ADDCARRY */
+
+   /********************************************************************************
+   * add: Returns a + b with the flags of ADD, see the file header.
+   ********************************************************************************/
+   template<class T>
+   static inline outcome<T> add(const T a,
+                                const T b)
+   {
+#if defined(__GNUC__) || defined(__clang__)
+      using signed_type = typename std::make_signed<T>::type;
+      T result;
+      signed_type signed_result;
+      const auto carry = __builtin_add_overflow(a, b, &result);
+      const auto overflow = __builtin_add_overflow(static_cast<signed_type>(a), static_cast<signed_type>(b), &signed_result);
+      return make(result, carry, overflow);
+#elif defined(CHECKED_ADDCARRY)
+      T result;
+      const auto carry = add_carry(a, b, result);
+      return make(result, carry, ((~(a ^ b) & (a ^ result)) >> msb<T>::value) & 1);
+#else
+      return portable::add(a, b);
+#endif
+   }
+
+   /********************************************************************************
+   * sub: Returns a - b with the flags of SUB, see the file header. The
+   *      overflow of a - b is corrected for the most negative b.
+   ********************************************************************************/
+   template<class T>
+   static inline outcome<T> sub(const T a,
+                                const T b)
+   {
+#if defined(__GNUC__) || defined(__clang__)
+      using signed_type = typename std::make_signed<T>::type;
+      T result;
+      signed_type signed_result;
+      const auto borrow = __builtin_sub_overflow(a, b, &result);
+      const auto overflow = __builtin_sub_overflow(static_cast<signed_type>(a), static_cast<signed_type>(b), &signed_result);
+      return make(result, !borrow, overflow != (b == static_cast<T>(1U << msb<T>::value)));
+#elif defined(CHECKED_ADDCARRY)
+      T result;
+      const auto borrow = sub_borrow(a, b, result);
+      return make(result, !borrow, ((~(a ^ static_cast<T>(0 - b)) & (a ^ result)) >> msb<T>::value) & 1);
+#else
+      return portable::sub(a, b);
+#endif
+   }
+
+   /********************************************************************************
+   * bitwise_or: Returns a | b with the flags of OR.
+   ********************************************************************************/
+   template<class T>
+   static constexpr outcome<T> bitwise_or(const T a,
+                                          const T b)
+   {
+      return make(static_cast<T>(a | b), false, false);
+   }
+
+   /********************************************************************************
+   * bitwise_and: Returns a & b with the flags of AND.
+   ********************************************************************************/
+   template<class T>
+   static constexpr outcome<T> bitwise_and(const T a,
+                                           const T b)
+   {
+      return make(static_cast<T>(a & b), false, false);
+   }
+
+   /********************************************************************************
+   * bitwise_xor: Returns a ^ b with the flags of XOR.
+   ********************************************************************************/
+   template<class T>
+   static constexpr outcome<T> bitwise_xor(const T a,
+                                           const T b)
+   {
+      return make(static_cast<T>(a ^ b), false, false);
+   }
+
+   /********************************************************************************
+   * calculate: Performs specified operation (OR, AND, XOR, ADD or SUB) and
+   *            returns its outcome. Other operations return 0 with the flags
+   *            of a zero result. When the operation is a constant, the
+   *            dispatch is removed by the compiler.
+   *
+   *            - operation: The operation to perform.
+   *            - a        : First operand.
+   *            - b        : Second operand.
+   ********************************************************************************/
+   template<class T>
+   static inline outcome<T> calculate(const std::uint8_t operation,
+                                      const T a,
+                                      const T b)
+   {
+      switch (operation)
+      {
+      case OR:  return bitwise_or(a, b);
+      case AND: return bitwise_and(a, b);
+      case XOR: return bitwise_xor(a, b);
+      case ADD: return add(a, b);
+      case SUB: return sub(a, b);
+      default:  return make(T{ 0 }, false, false);
+      }
+   }
+}
+
+#endif /* CHECKED_HPP_ */
\ No newline at end of file
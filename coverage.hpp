@@ -0,0 +1,298 @@
+/********************************************************************************
+* coverage.hpp: Contains instruction and branch coverage for programs of the
+*               CPU in emulator.hpp. Coverage is recorded in a bitmap with one
+*               bit per program address for executed instructions, and two
+*               bits per conditional branch for the outcomes of its condition:
+*               taken (the tested status flag of SNZVC matched) and not taken.
+*
+*               As for breakpoints (see debugger.hpp), the handlers of the
+*               pre-decoded instructions are replaced by probes, which set the
+*               bits and put the original handler back once there is nothing
+*               left to record: after the first execution of an instruction,
+*               and after both outcomes of a branch. Covered code hence runs
+*               at full speed.
+*
+*               The bitmap is plain data, so it is cleared by a single memset
+*               after probing the executed instructions again, being the only
+*               ones whose probe was removed. The bitmaps of many runs, e.g. on
+*               several machines in parallel, are merged by OR, 16 bytes at a
+*               time with SSE2 on x86 hosts. The merged coverage is exported as lcov tracefile, with
+*               the source lines of the image produced by the assembler.
+********************************************************************************/
+#ifndef COVERAGE_HPP_
+#define COVERAGE_HPP_
+
+/* Include directives: */
+#include <cstring>
+#include <string>
+#include "emulator.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COVERAGE_SSE2 1
+#endif
+
+/********************************************************************************
+* coverage: Namespace containing the coverage recording.
+********************************************************************************/
+namespace coverage
+{
+   using namespace emulator; /* Brings all content of the emulator namespace into current scope. */
+
+   static constexpr std::size_t words = program_size / 64; /* 64-bit words per bit array. */
+
+   /********************************************************************************
+   * bitmap: Coverage of a program, with bit address % 64 of word address / 64
+   *         of each array belonging to the instruction at address.
+   *
+   *         - executed : Set if the instruction was executed.
+   *         - taken    : Set if the branch was taken.
+   *         - not_taken: Set if the branch was not taken.
+   ********************************************************************************/
+   struct bitmap
+   {
+      std::uint64_t executed[words];
+      std::uint64_t taken[words];
+      std::uint64_t not_taken[words];
+   };
+
+   /********************************************************************************
+   * is_marked: Returns true if the bit of specified address is set.
+   ********************************************************************************/
+   static bool is_marked(const std::uint64_t* bits,
+                         const std::size_t address)
+   {
+      return (bits[address / 64] >> (address % 64)) & 1;
+   }
+
+   /********************************************************************************
+   * mark: Sets the bit of specified address.
+   ********************************************************************************/
+   static void mark(std::uint64_t* bits,
+                    const std::size_t address)
+   {
+      bits[address / 64] |= 1ULL << (address % 64);
+      return;
+   }
+
+   /********************************************************************************
+   * clear: Clears all bits of specified bitmap.
+   ********************************************************************************/
+   static void clear(bitmap& map)
+   {
+      std::memset(&map, 0, sizeof(map));
+      return;
+   }
+
+   /********************************************************************************
+   * merge: Adds the coverage of source to target (bitwise OR).
+   ********************************************************************************/
+   static void merge(bitmap& target,
+                     const bitmap& source)
+   {
+      static constexpr std::size_t n = sizeof(bitmap) / sizeof(std::uint64_t);
+      auto t = reinterpret_cast<std::uint64_t*>(&target);
+      const auto s = reinterpret_cast<const std::uint64_t*>(&source);
+      std::size_t i = 0;
+
+#ifdef COVERAGE_SSE2
+      for (; i + 2 <= n; i += 2)
+      {
+         const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t + i));
+         const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+         _mm_storeu_si128(reinterpret_cast<__m128i*>(t + i), _mm_or_si128(a, b));
+      }
+#endif /* COVERAGE_SSE2 */
+
+      for (; i < n; ++i) t[i] |= s[i];
+      return;
+   }
+
+   /********************************************************************************
+   * tracker: Records the coverage of a machine while the tracker exists. The
+   *          probes are placed in the loaded program, so the tracker must be
+   *          created after machine::load. The machine can't be profiled at
+   *          the same time, and breakpoints (see debugger.hpp) must be set
+   *          after the tracker is created or reset and removed before it is
+   *          destroyed.
+   ********************************************************************************/
+   class tracker
+   {
+   public:
+
+      /********************************************************************************
+      * tracker: Places the probes in the program of specified machine, with
+      *          empty coverage.
+      ********************************************************************************/
+      explicit tracker(machine& m)
+         : machine_{ m }, original_(m.program.size())
+      {
+         if (machine_.instrumentation) throw std::invalid_argument("coverage: Machine is already instrumented!");
+
+         for (std::size_t address = 0; address < machine_.program.size(); ++address)
+         {
+            original_[address] = machine_.program[address].execute;
+         }
+
+         machine_.instrumentation = this;
+         clear(map_);
+
+         for (std::size_t address = 0; address < machine_.program.size(); ++address)
+         {
+            place(address);
+         }
+      }
+
+      tracker(const tracker&) = delete;
+      tracker& operator=(const tracker&) = delete;
+
+      /********************************************************************************
+      * ~tracker: Restores the original handlers.
+      ********************************************************************************/
+      ~tracker(void)
+      {
+         for (std::size_t address = 0; address < machine_.program.size(); ++address)
+         {
+            machine_.program[address].execute = original_[address];
+         }
+         machine_.instrumentation = nullptr;
+      }
+
+      /********************************************************************************
+      * reset: Places the probes again at the executed instructions, which are
+      *        the only ones whose probe can have been removed, and clears the
+      *        coverage.
+      ********************************************************************************/
+      void reset(void)
+      {
+         for (std::size_t word = 0; word < words; ++word)
+         {
+            auto bits = map_.executed[word];
+
+            for (std::size_t address = word * 64; bits; ++address, bits >>= 1)
+            {
+               if (bits & 1) place(address);
+            }
+         }
+
+         clear(map_);
+         return;
+      }
+
+      /********************************************************************************
+      * map: Returns the recorded coverage.
+      ********************************************************************************/
+      const bitmap& map(void) const
+      {
+         return map_;
+      }
+
+   private:
+
+      /********************************************************************************
+      * place: Places the probe at specified address.
+      ********************************************************************************/
+      void place(const std::size_t address)
+      {
+         auto& ins = machine_.program[address];
+         ins.execute = ins.op == BRBS || ins.op == BRBC ? probe_branch : probe;
+         return;
+      }
+
+      /********************************************************************************
+      * restore: Puts the original handler back at specified address.
+      ********************************************************************************/
+      void restore(const std::uint16_t address)
+      {
+         machine_.program[address].execute = original_[address];
+         return;
+      }
+
+      /********************************************************************************
+      * probe: Marks the instruction as executed, removes the probe and executes
+      *        the instruction.
+      ********************************************************************************/
+      static void probe(machine& m, const instruction& ins)
+      {
+         auto& t = *static_cast<tracker*>(m.instrumentation);
+         mark(t.map_.executed, m.pc);
+         t.restore(m.pc);
+         ins.execute(m, ins);
+         return;
+      }
+
+      /********************************************************************************
+      * probe_branch: Marks the branch as executed and the outcome of its
+      *               condition, removes the probe once both outcomes occurred
+      *               and executes the branch.
+      ********************************************************************************/
+      static void probe_branch(machine& m, const instruction& ins)
+      {
+         auto& t = *static_cast<tracker*>(m.instrumentation);
+         const auto address = m.pc;
+         const auto taken = read(m.sreg, ins.rd) == (ins.op == BRBS);
+
+         mark(t.map_.executed, address);
+         mark(taken ? t.map_.taken : t.map_.not_taken, address);
+         if (is_marked(t.map_.taken, address) && is_marked(t.map_.not_taken, address)) t.restore(address);
+         t.original_[address](m, ins);
+         return;
+      }
+
+      machine& machine_;               /* The machine. */
+      std::vector<handler> original_;  /* Original handler per address. */
+      bitmap map_;                     /* The recorded coverage. */
+   };
+
+   /********************************************************************************
+   * write_lcov: Writes specified coverage of the program of specified image as
+   *             lcov tracefile, with one DA record per instruction and two
+   *             BRDA records per conditional branch (taken and not taken),
+   *             at the source line of the instruction, or at its address + 1
+   *             if the image has no source lines.
+   *
+   *             - ostream: Reference to output stream.
+   *             - map    : The coverage.
+   *             - img    : The image the coverage was recorded for.
+   *             - source : Name of the source file.
+   ********************************************************************************/
+   static void write_lcov(std::ostream& ostream,
+                          const bitmap& map,
+                          const image& img,
+                          const std::string& source)
+   {
+      const auto size = std::min(img.program.size(), program_size);
+      std::size_t lines = 0, lines_hit = 0, branches = 0, branches_hit = 0;
+      ostream << "TN:\nSF:" << source << "\n";
+
+      for (std::size_t address = 0; address < size; ++address)
+      {
+         if (address < img.lines.size() && !img.lines[address]) continue;
+         const auto line = address < img.lines.size() ? img.lines[address] : address + 1;
+         const auto executed = is_marked(map.executed, address);
+
+         ostream << "DA:" << line << "," << executed << "\n";
+         ++lines;
+         lines_hit += executed;
+
+         if (img.program[address].op == BRBS || img.program[address].op == BRBC)
+         {
+            for (std::size_t outcome = 0; outcome < 2; ++outcome)
+            {
+               const auto hit = is_marked(outcome == 0 ? map.taken : map.not_taken, address);
+               ostream << "BRDA:" << line << "," << address << "," << outcome << ",";
+               if (executed) ostream << hit << "\n";
+               else          ostream << "-\n";
+               ++branches;
+               branches_hit += hit;
+            }
+         }
+      }
+
+      ostream << "BRF:" << branches << "\nBRH:" << branches_hit << "\nLF:" << lines << "\nLH:" << lines_hit
+         << "\nend_of_record\n";
+      return;
+   }
+}
+
+#endif /* COVERAGE_HPP_ */
\ No newline at end of file
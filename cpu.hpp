@@ -11,6 +11,69 @@
 #include <bitset>
 #include <string>
 
+/********************************************************************************
+* CPU_ALU_INSTRUCTIONS: Declarative description of the ALU instructions, from
+*                       which the OP code constants, the name and operator
+*                       lookups, alu::calculate, the lookup tables and the
+*                       batch dispatch are all generated. Each entry holds:
+*
+*                       - name    : Mnemonic of the instruction.
+*                       - code    : OP code of the instruction.
+*                       - symbol  : Operator as text, used for printing.
+*                       - form    : Operand form of the instruction, see
+*                                   cpu::form.
+*                       - comment : Short description of the instruction.
+*
+*                       Adding an instruction requires a new entry below and
+*                       a specialization of alu::kernel in alu.hpp. The fast
+*                       paths are then generated automatically.
+********************************************************************************/
+#define CPU_ALU_INSTRUCTIONS(X) \
+   X(OR,     0x01, " | ",    binary, "Bitwise OR.") \
+   X(AND,    0x02, " & ",    binary, "Bitwise AND.") \
+   X(XOR,    0x03, " ^ ",    binary, "Bitwise XOR.") \
+   X(ADD,    0x04, " + ",    binary, "Addition.") \
+   X(SUB,    0x05, " - ",    binary, "Subtraction.") \
+   X(LSL,    0x0E, " << ",   shift,  "Logical shift left.") \
+   X(LSR,    0x0F, " >> ",   shift,  "Logical shift right.") \
+   X(ASR,    0x10, " >> ",   shift,  "Arithmetic shift right.") \
+   X(ROL,    0x11, " <<< ",  shift,  "Rotate left through carry.") \
+   X(ROR,    0x12, " >>> ",  shift,  "Rotate right through carry.") \
+   X(SWAP,   0x13, " <> ",   unary,  "Swap nibbles, status bits unaffected.") \
+   X(ADDUS,  0x14, " +| ",   binary, "Unsigned saturating addition.") \
+   X(SUBUS,  0x15, " -| ",   binary, "Unsigned saturating subtraction.") \
+   X(ADDSS,  0x16, " +| ",   binary, "Signed saturating addition.") \
+   X(SUBSS,  0x17, " -| ",   binary, "Signed saturating subtraction.") \
+   X(ADD4,   0x18, " +. ",   binary, "Packed 2 x 4-bit addition.") \
+   X(SUB4,   0x19, " -. ",   binary, "Packed 2 x 4-bit subtraction.") \
+   X(ADD2,   0x1A, " +. ",   binary, "Packed 4 x 2-bit addition.") \
+   X(SUB2,   0x1B, " -. ",   binary, "Packed 4 x 2-bit subtraction.") \
+   X(POPCNT, 0x1C, "popcnt", unary,  "Number of set bits.") \
+   X(CLZ,    0x1D, "clz",    unary,  "Number of leading zeros.") \
+   X(CTZ,    0x1E, "ctz",    unary,  "Number of trailing zeros.") \
+   X(BREV,   0x1F, "brev",   unary,  "Bit reversal.") \
+   X(PARITY, 0x20, "parity", unary,  "Parity, 1 if odd number of set bits.")
+
+/********************************************************************************
+* CPU_MDU_INSTRUCTIONS: Declarative description of the multiply and divide
+*                       instructions, see mdu.hpp. The entries are of the same
+*                       format as CPU_ALU_INSTRUCTIONS.
+********************************************************************************/
+#define CPU_MDU_INSTRUCTIONS(X) \
+   X(MUL,    0x06, " * ",    wide,   "Unsigned multiplication.") \
+   X(MULS,   0x07, " * ",    wide,   "Signed multiplication.") \
+   X(MULSU,  0x08, " * ",    wide,   "Signed with unsigned multiplication.") \
+   X(FMUL,   0x09, " * ",    wide,   "Unsigned fractional multiplication.") \
+   X(FMULS,  0x0A, " * ",    wide,   "Signed fractional multiplication.") \
+   X(FMULSU, 0x0B, " * ",    wide,   "Signed with unsigned fractional multiplication.") \
+   X(DIV,    0x0C, " / ",    wide,   "Unsigned division, quotient in R0.") \
+   X(MOD,    0x0D, " % ",    wide,   "Unsigned division, remainder in R0.")
+
+/********************************************************************************
+* CPU_INSTRUCTIONS: All instructions of the ALU and the multiply and divide unit.
+********************************************************************************/
+#define CPU_INSTRUCTIONS(X) CPU_ALU_INSTRUCTIONS(X) CPU_MDU_INSTRUCTIONS(X)
+
 /********************************************************************************
 * cpu: Namespace containing generic constants and functions for performing
 *      calculations with an ALU.
@@ -18,14 +81,23 @@
 namespace cpu
 {
    /********************************************************************************
-   * Aritmetic and logic operations:
+   * form: Operand forms of the instructions:
+   *
+   *       - binary: Two operands, 8-bit result.
+   *       - shift : Second operand is the number of steps, 8-bit result.
+   *       - unary : Only the first operand is used, 8-bit result.
+   *       - wide  : Two operands, 16-bit result in register pair R1:R0.
+   ********************************************************************************/
+   enum class form { binary, shift, unary, wide };
+
+   /********************************************************************************
+   * Instructions (OP codes generated from CPU_INSTRUCTIONS):
    ********************************************************************************/
    static constexpr std::uint8_t NOP = 0x00; /* No operation. */
-   static constexpr std::uint8_t OR  = 0x01; /* Bitwise OR. */
-   static constexpr std::uint8_t AND = 0x02; /* Bitwise AND. */
-   static constexpr std::uint8_t XOR = 0x03; /* Bitwise XOR. */
-   static constexpr std::uint8_t ADD = 0x04; /* Addition. */
-   static constexpr std::uint8_t SUB = 0x05; /* Subtraction. */
+
+#define CPU_OP_CODE(name, code, symbol, form, comment) static constexpr std::uint8_t name = code;
+   CPU_INSTRUCTIONS(CPU_OP_CODE)
+#undef CPU_OP_CODE
 
    /********************************************************************************
    * Status flags:
@@ -44,7 +116,7 @@ namespace cpu
    *      - bit: The bit to be set in the referenced register.
    ********************************************************************************/
    template<class T = std::uint8_t>
-   static void set(T& reg, const std::uint8_t bit)
+   static constexpr void set(T& reg, const std::uint8_t bit)
    {
       reg |= (1 << bit);
       return;
@@ -57,7 +129,7 @@ namespace cpu
    *      - bit: The bit to be cleared in the referenced register.
    ********************************************************************************/
    template<class T = std::uint8_t>
-   static void clr(T& reg, const std::uint8_t bit)
+   static constexpr void clr(T& reg, const std::uint8_t bit)
    {
       reg &= ~(1 << bit);
       return;
@@ -71,7 +143,7 @@ namespace cpu
    *       - bit: The bit to be read in the referenced register.
    ********************************************************************************/
    template<class T = std::uint8_t>
-   static bool read(const T reg, const std::uint8_t bit)
+   static constexpr bool read(const T reg, const std::uint8_t bit)
    {
       return static_cast<bool>(reg & (1 << bit));
    }
@@ -83,12 +155,13 @@ namespace cpu
    ********************************************************************************/
    static const char* get_operator(const std::uint8_t op_code)
    {
-      if (op_code == OR)       return " | ";
-      else if (op_code == AND) return " & ";
-      else if (op_code == XOR) return " ^ ";
-      else if (op_code == ADD) return " + ";
-      else if (op_code == SUB) return " - ";
-      else return "Unknown";
+      switch (op_code)
+      {
+#define CPU_OPERATOR(name, code, symbol, form, comment) case name: return symbol;
+      CPU_INSTRUCTIONS(CPU_OPERATOR)
+#undef CPU_OPERATOR
+      default: return "Unknown";
+      }
    }
 
    /********************************************************************************
@@ -98,27 +171,128 @@ namespace cpu
    ********************************************************************************/
    static const char* get_instruction_name(const std::uint8_t op_code)
    {
-      if (op_code == OR)       return "OR";
-      else if (op_code == AND) return "AND";
-      else if (op_code == XOR) return "XOR";
-      else if (op_code == ADD) return "ADD";
-      else if (op_code == SUB) return "SUB";
-      else return "Unknown";
+      switch (op_code)
+      {
+#define CPU_NAME(name, code, symbol, form, comment) case name: return #name;
+      CPU_INSTRUCTIONS(CPU_NAME)
+#undef CPU_NAME
+      default: return "Unknown";
+      }
    }
 
    /********************************************************************************
-   * get_op_code: Returns the OP code of specified instruction.
+   * get_description: Returns a short description of the specified instruction.
    *
-   *              - instruction_name: The specified CPU instruction in text form.
+   *                  - op_code: OP code of the specified instruction.
    ********************************************************************************/
-   static std::uint8_t get_op_code(const std::string& instruction_name)
+   static inline const char* get_description(const std::uint8_t op_code)
    {
-      if (instruction_name == "OR")       return OR;
-      else if (instruction_name == "AND") return AND;
-      else if (instruction_name == "XOR") return XOR;
-      else if (instruction_name == "ADD") return ADD;
-      else if (instruction_name == "SUB") return SUB;
-      else                                return NOP;
+      switch (op_code)
+      {
+#define CPU_DESCRIPTION(name, code, symbol, form, comment) case name: return comment;
+      CPU_INSTRUCTIONS(CPU_DESCRIPTION)
+#undef CPU_DESCRIPTION
+      default: return "Unknown";
+      }
+   }
+
+   /********************************************************************************
+   * equals: Returns true if the specified characters equal the specified
+   *         instruction name, ignoring case.
+   *
+   *         - s   : Pointer to the characters.
+   *         - size: The number of characters.
+   *         - name: The instruction name (null terminated, upper case).
+   ********************************************************************************/
+   static bool equals(const char* s,
+                      const std::size_t size,
+                      const char* name)
+   {
+      for (std::size_t i = 0; i < size; ++i, ++name)
+      {
+         const auto c = s[i] >= 'a' && s[i] <= 'z' ? static_cast<char>(s[i] - 'a' + 'A') : s[i];
+         if (*name != c) return false;
+      }
+      return *name == '\0';
+   }
+
+   /********************************************************************************
+   * get_op_code: Returns the OP code of specified instruction, or NOP if there
+   *              is no such instruction. Case is ignored and no memory is
+   *              allocated, so that the function can be called per command.
+   *
+   *              - instruction_name: Pointer to the instruction name.
+   *              - size            : The number of characters of the name.
+   ********************************************************************************/
+   static inline std::uint8_t get_op_code(const char* instruction_name,
+                                          const std::size_t size)
+   {
+#define CPU_OP_CODE(name, code, symbol, form, comment) if (equals(instruction_name, size, #name)) return name;
+      CPU_INSTRUCTIONS(CPU_OP_CODE)
+#undef CPU_OP_CODE
+      return NOP;
+   }
+
+   /********************************************************************************
+   * get_form: Returns the operand form of specified instruction.
+   *
+   *           - op_code: OP code of the specified instruction.
+   ********************************************************************************/
+   static form get_form(const std::uint8_t op_code)
+   {
+      switch (op_code)
+      {
+#define CPU_FORM(name, code, symbol, form_, comment) case name: return form::form_;
+      CPU_INSTRUCTIONS(CPU_FORM)
+#undef CPU_FORM
+      default: return form::binary;
+      }
+   }
+
+   /********************************************************************************
+   * get_instruction_list: Returns the names of all instructions separated by
+   *                       commas, for instance to be used in prompts.
+   ********************************************************************************/
+   static inline std::string get_instruction_list(void)
+   {
+      std::string list;
+#define CPU_LIST(name, code, symbol, form, comment) list += list.empty() ? #name : ", " #name;
+      CPU_INSTRUCTIONS(CPU_LIST)
+#undef CPU_LIST
+      return list;
+   }
+
+   /********************************************************************************
+   * is_wide: Returns true if the specified instruction produces a 16-bit result
+   *          in register pair R1:R0, i.e. a multiply or divide operation.
+   *
+   *          - op_code: OP code of the specified instruction.
+   ********************************************************************************/
+   static bool is_wide(const std::uint8_t op_code)
+   {
+      return get_form(op_code) == form::wide;
+   }
+
+   /********************************************************************************
+   * is_shift: Returns true if the specified instruction is a shift or rotate
+   *           operation, where the second operand is the number of steps.
+   *
+   *           - op_code: OP code of the specified instruction.
+   ********************************************************************************/
+   static bool is_shift(const std::uint8_t op_code)
+   {
+      return get_form(op_code) == form::shift;
+   }
+
+   /********************************************************************************
+   * is_unary: Returns true if the specified instruction only uses the first
+   *           operand, i.e. SWAP and the bit manipulation operations.
+   *
+   *           - op_code: OP code of the specified instruction.
+   ********************************************************************************/
+   static bool is_unary(const std::uint8_t op_code)
+   {
+      return get_form(op_code) == form::unary;
    }
 
    /********************************************************************************
@@ -157,62 +331,6 @@ namespace cpu
          return static_cast<int>(num);
       }
    }
-
-   /********************************************************************************
-   * readline: Reads a string of text from the terminal into referenced string.
-   *
-   *           - s: Reference to string for storage of entered text.
-   ********************************************************************************/
-   static void readline(std::string& s)
-   {
-      std::getline(std::cin, s);
-      std::cout << "\n";
-   }
-
-   /********************************************************************************
-   * read_byte: Returns an unsigned 8-bit integer entered from the terminal.
-   *            If an invalid character is entered, input is done again.
-   ********************************************************************************/
-   static std::uint8_t read_byte(void)
-   {
-      while (1)
-      {
-         std::string s;
-         readline(s);
-
-         try
-         {
-            return static_cast<std::uint8_t>(std::stoi(s));
-         }
-         catch (std::invalid_argument&)
-         {
-            std::cerr << "Invalid input, try again!\n\n";
-         }
-      }
-   }
-
-   /********************************************************************************
-   * read_op_code: Returns an OP code entered from the terminal. If an invalid
-   *               OP code is entered, the OP code has to be entered again.
-   ********************************************************************************/
-   static std::uint8_t read_op_code(void)
-   {
-      while (1)
-      {
-         std::string s;
-         readline(s);
-         const auto op_code = get_op_code(s);
-
-         if (op_code == NOP)
-         {
-            std::cout << "Invalid instruction, try again!\n\n";
-         }
-         else
-         {
-            return  op_code;
-         }
-      }
-   }
 }
 
 #endif /* CPU_HPP_ */
\ No newline at end of file
@@ -0,0 +1,293 @@
+/********************************************************************************
+* debugger.hpp: Contains breakpoints and watchpoints for the CPU in
+*               emulator.hpp. Nothing is checked per instruction in the
+*               execution loop:
+*
+*               - Breakpoints replace the handler of the pre-decoded instruction
+*                 at their address with a trap handler, which stops the CPU
+*                 before the instruction is executed.
+*               - Conditional breakpoints replace the handler with a trap
+*                 handler that executes the instruction and stops the CPU if
+*                 the status flags SNZVC match the condition afterwards, e.g.
+*                 V set after ADD. They can be set at an address or at every
+*                 instruction with a given OP code.
+*               - Watchpoints mark the pages they cover, and writes to marked
+*                 pages take the same slow path as the first write to a page
+*                 after a snapshot (see machine::write), where the address is
+*                 checked. Writes to other pages are unaffected.
+*
+*               The CPU is stopped by setting halted, so that the execution
+*               loop of the machine ends, with the reason in machine::stopped.
+*
+*               The handler replaced by a breakpoint is saved per address and
+*               called by the trap, so that breakpoints can be combined with
+*               idle loops (see idle.hpp), the profiler and coverage, and is
+*               put back when the breakpoint is removed.
+********************************************************************************/
+#ifndef DEBUGGER_HPP_
+#define DEBUGGER_HPP_
+
+/* Include directives: */
+#include "emulator.hpp"
+
+/********************************************************************************
+* debugger: Namespace containing breakpoints and watchpoints.
+********************************************************************************/
+namespace debugger
+{
+   using namespace emulator; /* Brings all content of the emulator namespace into current scope. */
+
+   /********************************************************************************
+   * trap_breakpoint: Stops the CPU before the instruction is executed. The
+   *                  trap isn't counted as an executed instruction.
+   ********************************************************************************/
+   static void trap_breakpoint(machine& m, const instruction&)
+   {
+      m.halted = true;
+      m.stopped = event::breakpoint;
+      m.event_address = m.pc;
+      --m.instructions;
+      return;
+   }
+
+   /********************************************************************************
+   * session: Breakpoints and watchpoints of a machine. Breakpoints are set in
+   *          the loaded program, so they must be set after machine::load. All
+   *          breakpoints and watchpoints are removed when the session ends.
+   ********************************************************************************/
+   class session
+   {
+   public:
+
+      /********************************************************************************
+      * session: Creates a session without breakpoints for specified machine.
+      ********************************************************************************/
+      explicit session(machine& m)
+         : machine_{ m }, replaced_(m.program.size())
+      {
+         if (machine_.debugger) throw std::invalid_argument("debugger: Machine is already debugged!");
+         machine_.debugger = this;
+      }
+
+      session(const session&) = delete;
+      session& operator=(const session&) = delete;
+
+      ~session(void)
+      {
+         clear();
+         machine_.debugger = nullptr;
+      }
+
+      /********************************************************************************
+      * set_breakpoint: Sets a breakpoint at specified program address.
+      ********************************************************************************/
+      void set_breakpoint(const std::uint16_t address)
+      {
+         patch(address, trap_breakpoint, 0, 0);
+         return;
+      }
+
+      /********************************************************************************
+      * set_breakpoint: Sets a conditional breakpoint at specified program
+      *                 address, which stops the CPU after the instruction if
+      *                 (SREG & mask) == value, e.g. mask = value = 1 << V stops
+      *                 when V is set.
+      ********************************************************************************/
+      void set_breakpoint(const std::uint16_t address,
+                          const std::uint8_t mask,
+                          const std::uint8_t value)
+      {
+         patch(address, trap_condition, mask, value & mask);
+         return;
+      }
+
+      /********************************************************************************
+      * break_on_flags: Sets a conditional breakpoint (see set_breakpoint) at every
+      *                 instruction with specified OP code, e.g. break_on_flags(ADD,
+      *                 1 << V, 1 << V) stops when V is set after any ADD.
+      ********************************************************************************/
+      void break_on_flags(const std::uint8_t op,
+                          const std::uint8_t mask,
+                          const std::uint8_t value)
+      {
+         for (std::size_t address = 0; address < machine_.program.size(); ++address)
+         {
+            if (machine_.program[address].op == op)
+            {
+               set_breakpoint(static_cast<std::uint16_t>(address), mask, value);
+            }
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * clear_breakpoint: Removes the breakpoint at specified program address.
+      ********************************************************************************/
+      void clear_breakpoint(const std::uint16_t address)
+      {
+         const auto i = std::find(breakpoints_.begin(), breakpoints_.end(), address);
+         if (i == breakpoints_.end()) return;
+
+         auto& ins = machine_.program[address];
+         ins.execute = replaced_[address];
+         ins.mask = 0;
+         ins.value = 0;
+         breakpoints_.erase(i);
+         return;
+      }
+
+      /********************************************************************************
+      * watch: Sets a watchpoint for data addresses first to last (inclusive),
+      *        which stops the CPU after an instruction writing to the range.
+      ********************************************************************************/
+      void watch(const std::uint16_t first,
+                 const std::uint16_t last)
+      {
+         machine_.watch(first, last);
+         watchpoints_.push_back(watchpoint{ first, last });
+         return;
+      }
+
+      /********************************************************************************
+      * unwatch: Removes the watchpoint for data addresses first to last.
+      ********************************************************************************/
+      void unwatch(const std::uint16_t first,
+                   const std::uint16_t last)
+      {
+         machine_.unwatch(first, last);
+         watchpoints_.erase(std::remove_if(watchpoints_.begin(), watchpoints_.end(),
+            [&](const watchpoint& w) { return w.first == first && w.last == last; }), watchpoints_.end());
+         return;
+      }
+
+      /********************************************************************************
+      * clear: Removes all breakpoints and watchpoints of the session.
+      ********************************************************************************/
+      void clear(void)
+      {
+         while (!breakpoints_.empty()) clear_breakpoint(breakpoints_.back());
+         while (!watchpoints_.empty()) unwatch(watchpoints_.back().first, watchpoints_.back().last);
+         return;
+      }
+
+      /********************************************************************************
+      * breakpoints: Returns the addresses of the breakpoints.
+      ********************************************************************************/
+      const std::vector<std::uint16_t>& breakpoints(void) const
+      {
+         return breakpoints_;
+      }
+
+      /********************************************************************************
+      * run: Resumes execution until HALT, a breakpoint or watchpoint, or until
+      *      specified number of instructions has been executed. If the CPU is
+      *      stopped at a breakpoint, the instruction there is executed first.
+      *      Returns the reason the CPU stopped, or event::none for HALT and
+      *      the limit.
+      *
+      *      - limit: Maximum number of instructions (default = no limit).
+      ********************************************************************************/
+      event run(const std::uint64_t limit = ~0ULL)
+      {
+         if (machine_.stopped != event::none)
+         {
+            machine_.halted = false;
+            machine_.stopped = event::none;
+         }
+
+         if (limit == 0 || machine_.halted) return event::none;
+         const auto& ins = machine_.program[machine_.pc];
+
+         if (ins.execute == trap_breakpoint)
+         {
+            machine_.run_end = machine_.instructions + 1;
+            execute(machine_.pc);
+            ++machine_.instructions;
+            if (limit > 1 && !machine_.halted) machine_.run(limit - 1);
+         }
+         else
+         {
+            machine_.run(limit);
+         }
+         return machine_.stopped;
+      }
+
+      /********************************************************************************
+      * step: Executes one instruction, see run.
+      ********************************************************************************/
+      event step(void)
+      {
+         return run(1);
+      }
+
+   private:
+
+      /********************************************************************************
+      * patch: Replaces the handler of the instruction at specified address and
+      *        saves the replaced one, unless there is a breakpoint already.
+      ********************************************************************************/
+      void patch(const std::uint16_t address,
+                 const handler trap,
+                 const std::uint8_t mask,
+                 const std::uint8_t value)
+      {
+         auto& ins = machine_.program[address];
+
+         if (std::find(breakpoints_.begin(), breakpoints_.end(), address) == breakpoints_.end())
+         {
+            replaced_[address] = ins.execute;
+            breakpoints_.push_back(address);
+         }
+
+         ins.execute = trap;
+         ins.mask = mask;
+         ins.value = value;
+         return;
+      }
+
+      /********************************************************************************
+      * execute: Executes the instruction at specified address with the handler
+      *          replaced by the breakpoint there. A handler putting another one
+      *          in its place, such as a probe of coverage.hpp removing itself,
+      *          replaces the saved handler instead, and the trap is kept.
+      ********************************************************************************/
+      void execute(const std::uint16_t address)
+      {
+         auto& ins = machine_.program[address];
+         const auto trap = ins.execute;
+         replaced_[address](machine_, ins);
+
+         if (ins.execute != trap)
+         {
+            replaced_[address] = ins.execute;
+            ins.execute = trap;
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * trap_condition: Executes the instruction and stops the CPU if the status
+      *                 flags selected by mask of the instruction equal value.
+      ********************************************************************************/
+      static void trap_condition(machine& m, const instruction& ins)
+      {
+         const auto address = m.pc;
+         static_cast<session*>(m.debugger)->execute(address);
+
+         if ((m.sreg & ins.mask) == ins.value)
+         {
+            m.halted = true;
+            m.stopped = event::condition;
+            m.event_address = address;
+         }
+         return;
+      }
+
+      machine& machine_;                      /* The debugged machine. */
+      std::vector<std::uint16_t> breakpoints_; /* Addresses of the breakpoints. */
+      std::vector<handler> replaced_;         /* Handler replaced by the breakpoint per address. */
+      std::vector<watchpoint> watchpoints_;   /* Watched ranges of data memory. */
+   };
+}
+
+#endif /* DEBUGGER_HPP_ */
\ No newline at end of file
@@ -0,0 +1,397 @@
+/********************************************************************************
+* disassembler.hpp: Contains a disassembler and trace printer for programs of
+*                   the CPU in emulator.hpp. Mnemonics, operator strings and
+*                   operand formats are looked up by OP code in tables of 256
+*                   entries, precomputed once from CPU_INSTRUCTIONS,
+*                   EMULATOR_INSTRUCTIONS and EMULATOR_BRANCHES, and the text
+*                   is produced by a buffered writer, which passes large blocks
+*                   to the output stream. The output of the disassembler can be
+*                   assembled again by the assembler; the operation of binary
+*                   ALU and multiply and divide instructions is appended with
+*                   its operator as comment, e.g. "; R16 = R16 + 0x01".
+********************************************************************************/
+#ifndef DISASSEMBLER_HPP_
+#define DISASSEMBLER_HPP_
+
+/* Include directives: */
+#include <cstring>
+#include "emulator.hpp"
+
+/********************************************************************************
+* disassembler: Namespace containing the disassembler and trace printer.
+********************************************************************************/
+namespace disassembler
+{
+   using namespace emulator; /* Brings all content of the emulator namespace into current scope. */
+
+   /********************************************************************************
+   * tables: Lookup tables indexed by OP code. Unused OP codes are named "???".
+   *
+   *         - names    : Mnemonic of each OP code.
+   *         - operators: Operator string of each ALU and MDU OP code.
+   *         - formats  : Operand format of each OP code.
+   *         - branches : Alias of BRBC (row 0) and BRBS (row 1) per status flag,
+   *                      or nullptr if the flag has no alias.
+   ********************************************************************************/
+   struct tables
+   {
+      std::array<const char*, 256> names;
+      std::array<const char*, 256> operators;
+      std::array<format, 256> formats;
+      const char* branches[2][8];
+   };
+
+   /********************************************************************************
+   * get_tables: Returns the lookup tables, computed on first use.
+   ********************************************************************************/
+   static const tables& get_tables(void)
+   {
+      static const tables t = []()
+      {
+         tables result;
+         result.names.fill("???");
+         result.operators.fill("");
+         result.formats.fill(format::none);
+         for (auto& row : result.branches) for (auto& alias : row) alias = nullptr;
+
+         result.names[NOP] = "NOP";
+#define DISASSEMBLER_CPU(name, code, symbol, form, comment) \
+         result.names[name] = #name; result.operators[name] = symbol; result.formats[name] = get_format(name);
+         CPU_INSTRUCTIONS(DISASSEMBLER_CPU)
+#undef DISASSEMBLER_CPU
+#define DISASSEMBLER_EMULATOR(name, code, format_, comment) \
+         result.names[name] = #name; result.formats[name] = format::format_;
+         EMULATOR_INSTRUCTIONS(DISASSEMBLER_EMULATOR)
+#undef DISASSEMBLER_EMULATOR
+         result.names[LDX] = "LD"; /* Written as in the assembler, e.g. LD R0, [R26]. */
+         result.names[STX] = "ST";
+#define DISASSEMBLER_BRANCH(name, op, flag) \
+         if (!result.branches[op == BRBS][flag]) result.branches[op == BRBS][flag] = #name;
+         EMULATOR_BRANCHES(DISASSEMBLER_BRANCH)
+#undef DISASSEMBLER_BRANCH
+         return result;
+      }();
+      return t;
+   }
+
+   /********************************************************************************
+   * writer: Buffered text writer. The text is collected in a buffer, which is
+   *         passed to the output stream when full, on flush and on destruction.
+   ********************************************************************************/
+   class writer
+   {
+   public:
+
+      /********************************************************************************
+      * writer: Creates a writer for specified output stream.
+      *
+      *         - ostream : Reference to output stream.
+      *         - capacity: Size of the buffer in bytes (default = 64 KiB).
+      ********************************************************************************/
+      explicit writer(std::ostream& ostream,
+                      const std::size_t capacity = 65536)
+         : ostream_{ ostream }, buffer_(capacity) {}
+
+      writer(const writer&) = delete;
+      writer& operator=(const writer&) = delete;
+
+      ~writer(void)
+      {
+         flush();
+      }
+
+      /********************************************************************************
+      * put: Appends a character.
+      ********************************************************************************/
+      writer& put(const char c)
+      {
+         if (size_ == buffer_.size()) flush();
+         buffer_[size_++] = c;
+         return *this;
+      }
+
+      /********************************************************************************
+      * write: Appends a null terminated string.
+      ********************************************************************************/
+      writer& write(const char* s)
+      {
+         return write(s, std::strlen(s));
+      }
+
+      /********************************************************************************
+      * write: Appends specified number of characters.
+      ********************************************************************************/
+      writer& write(const char* s,
+                    const std::size_t n)
+      {
+         if (size_ + n > buffer_.size()) flush();
+
+         if (n > buffer_.size())
+         {
+            ostream_.write(s, static_cast<std::streamsize>(n));
+            flushed_ += n;
+            return *this;
+         }
+
+         std::memcpy(&buffer_[size_], s, n);
+         size_ += n;
+         return *this;
+      }
+
+      /********************************************************************************
+      * decimal: Appends an unsigned number in decimal notation, right aligned
+      *          in specified width (default = no alignment).
+      ********************************************************************************/
+      writer& decimal(std::uint64_t value,
+                      const std::size_t width = 0)
+      {
+         char digits[20];
+         std::size_t n = 0;
+         do { digits[n++] = static_cast<char>('0' + value % 10); value /= 10; } while (value);
+         for (auto i = n; i < width; ++i) put(' ');
+         while (n) put(digits[--n]);
+         return *this;
+      }
+
+      /********************************************************************************
+      * hex: Appends a number as 0x followed by specified number of hexadecimal
+      *      digits.
+      ********************************************************************************/
+      writer& hex(const std::uint32_t value,
+                  const std::size_t digits)
+      {
+         static constexpr char symbols[] = "0123456789ABCDEF";
+         put('0').put('x');
+         for (auto i = digits; i-- > 0;) put(symbols[(value >> (4 * i)) & 0x0F]);
+         return *this;
+      }
+
+      /********************************************************************************
+      * binary: Appends the lowest specified number of bits of a number.
+      ********************************************************************************/
+      writer& binary(const std::uint32_t value,
+                     const std::size_t bits)
+      {
+         for (auto i = bits; i-- > 0;) put(((value >> i) & 1) ? '1' : '0');
+         return *this;
+      }
+
+      /********************************************************************************
+      * reg: Appends a register name, e.g. R16.
+      ********************************************************************************/
+      writer& reg(const std::uint8_t r)
+      {
+         put('R');
+         return decimal(r);
+      }
+
+      /********************************************************************************
+      * position: Returns the number of characters written so far.
+      ********************************************************************************/
+      std::size_t position(void) const
+      {
+         return flushed_ + size_;
+      }
+
+      /********************************************************************************
+      * pad: Appends spaces until specified position (see position).
+      ********************************************************************************/
+      writer& pad(const std::size_t target)
+      {
+         for (auto n = position(); n < target; ++n) put(' ');
+         return *this;
+      }
+
+      /********************************************************************************
+      * flush: Passes the buffered text to the output stream.
+      ********************************************************************************/
+      void flush(void)
+      {
+         ostream_.write(buffer_.data(), static_cast<std::streamsize>(size_));
+         flushed_ += size_;
+         size_ = 0;
+         return;
+      }
+
+   private:
+      std::ostream& ostream_;       /* The output stream. */
+      std::vector<char> buffer_;    /* The buffer. */
+      std::size_t size_ = 0;        /* Number of buffered characters. */
+      std::size_t flushed_ = 0;     /* Number of characters passed to the stream. */
+   };
+
+   /********************************************************************************
+   * disassemble: Appends the assembly text of specified instruction, e.g.
+   *              "ADD R16, R17", "LD R0, [R26]" or "BRNE 0x0004".
+   *
+   *              - ins: The instruction.
+   *              - out: Reference to the writer.
+   ********************************************************************************/
+   static void disassemble(const instruction& ins,
+                           writer& out)
+   {
+      const auto& t = get_tables();
+      const auto f = t.formats[ins.op];
+
+      if (f == format::bit_target)
+      {
+         const auto alias = ins.rd < 8 ? t.branches[ins.op == BRBS][ins.rd] : nullptr;
+         if (alias) out.write(alias).put(' ');
+         else       out.write(t.names[ins.op]).put(' ').decimal(ins.rd).write(", ", 2);
+         out.hex(ins.k, 4);
+         return;
+      }
+
+      out.write(t.names[ins.op]);
+
+      switch (f)
+      {
+      case format::rd: case format::alu_unary:
+         out.put(' ').reg(ins.rd);
+         break;
+      case format::rr:
+         out.put(' ').reg(ins.rr);
+         break;
+      case format::rd_rr: case format::mdu:
+         out.put(' ').reg(ins.rd).write(", ", 2).reg(ins.rr);
+         break;
+      case format::rd_k:
+         out.put(' ').reg(ins.rd).write(", ", 2).hex(ins.k, 2);
+         break;
+      case format::rd_address:
+         out.put(' ').reg(ins.rd).write(", ", 2).hex(ins.k, 4);
+         break;
+      case format::rd_pointer:
+         out.put(' ').reg(ins.rd).write(", [", 3).reg(ins.rr).put(']');
+         break;
+      case format::address_rr:
+         out.put(' ').hex(ins.k, 4).write(", ", 2).reg(ins.rr);
+         break;
+      case format::pointer_rr:
+         out.write(" [", 2).reg(ins.rd).write("], ", 3).reg(ins.rr);
+         break;
+      case format::target:
+         out.put(' ').hex(ins.k, 4);
+         break;
+      case format::alu:
+      {
+         out.put(' ').reg(ins.rd).write(", ", 2);
+         if (ins.rr == immediate) out.hex(ins.k, 2);
+         else                     out.reg(ins.rr);
+         break;
+      }
+      default:
+         break;
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * annotate: Appends the operation of specified binary ALU or multiply and
+   *           divide instruction as comment with the operator of the tables,
+   *           e.g. "; R16 = R16 + 0x01" or "; R1:R0 = R16 * R17". Other
+   *           instructions are left without comment.
+   *
+   *           - ins   : The instruction.
+   *           - column: Position the comment is aligned to (see writer::pad).
+   *           - out   : Reference to the writer.
+   ********************************************************************************/
+   static void annotate(const instruction& ins,
+                        const std::size_t column,
+                        writer& out)
+   {
+      const auto& t = get_tables();
+      const auto f = t.formats[ins.op];
+
+      if (f == format::alu)
+      {
+         out.pad(column).write("; ", 2).reg(ins.rd).write(" = ", 3).reg(ins.rd).write(t.operators[ins.op]);
+         if (ins.rr == immediate) out.hex(ins.k, 2);
+         else                     out.reg(ins.rr);
+      }
+      else if (f == format::mdu)
+      {
+         out.pad(column).write("; ", 2).write(ins.op == DIV || ins.op == MOD ? "R0 = " : "R1:R0 = ")
+            .reg(ins.rd).write(t.operators[ins.op]).reg(ins.rr);
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * disassemble: Writes the assembly text of the instructions from address
+   *              first to last (exclusive) of specified program, one line per
+   *              instruction preceded by the address and followed by the
+   *              operation as comment (see annotate).
+   *
+   *              - program: The program.
+   *              - first  : Address of the first instruction.
+   *              - last   : End address.
+   *              - out    : Reference to the writer.
+   ********************************************************************************/
+   static void disassemble(const std::vector<instruction>& program,
+                           const std::size_t first,
+                           const std::size_t last,
+                           writer& out)
+   {
+      const auto end = std::min(last, program.size());
+
+      for (auto address = first; address < end; ++address)
+      {
+         const auto line = out.position();
+         out.hex(static_cast<std::uint32_t>(address), 4).write(":  ", 3);
+         disassemble(program[address], out);
+         annotate(program[address], line + 32, out);
+         out.put('\n');
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * trace: Executes up to specified number of instructions and prints one line
+   *        per instruction with the instruction count, address, assembly text,
+   *        the destination register(s) after execution and SNZVC. A pending
+   *        interrupt is accepted before the address is read, so that the
+   *        first line after it shows the instruction at the vector.
+   *
+   *        - m    : Reference to the machine.
+   *        - limit: Maximum number of instructions to execute.
+   *        - out  : Reference to the writer.
+   ********************************************************************************/
+   static void trace(machine& m,
+                     const std::uint64_t limit,
+                     writer& out)
+   {
+      const auto& t = get_tables();
+
+      for (std::uint64_t i = 0; i < limit && !m.halted; ++i)
+      {
+         if (m.cycles >= m.next_event) m.interrupt();
+         const auto pc = m.pc;
+         const auto& ins = m.program[pc];
+         const auto line = out.position();
+         m.step();
+
+         out.decimal(m.instructions, 10).write("  ", 2).hex(pc, 4).write("  ", 2);
+         disassemble(ins, out);
+         out.pad(line + 44);
+
+         switch (t.formats[ins.op])
+         {
+         case format::rd: case format::rd_rr: case format::rd_k: case format::rd_address:
+         case format::rd_pointer: case format::alu: case format::alu_unary:
+            out.reg(ins.rd).put('=').hex(m.r[ins.rd], 2).write("  ", 2);
+            break;
+         case format::mdu:
+            out.write("R1:R0=", 6).hex(static_cast<std::uint32_t>((m.r[1] << 8) | m.r[0]), 4).write("  ", 2);
+            break;
+         default:
+            break;
+         }
+
+         out.pad(line + 62).write("SNZVC=", 6).binary(m.sreg, 5).put('\n');
+      }
+      return;
+   }
+}
+
+#endif /* DISASSEMBLER_HPP_ */
\ No newline at end of file
@@ -0,0 +1,935 @@
+/********************************************************************************
+* emulator.hpp: Contains a minimal CPU built around the ALU and the multiply
+*               and divide unit. The CPU has 32 8-bit registers R0 - R31, a
+*               status register SREG (with SNZVC in bits 4 - 0 as in the ALU),
+*               a stack pointer, 64 KiB of data memory and a program memory of
+*               65 536 instructions.
+*
+*               The program memory holds pre-decoded instructions, each with a
+*               pointer to the handler executing it, so that the execution loop
+*               consists of one indirect call per instruction without any
+*               decoding. Programs are produced by the assembler, see
+*               assembler.hpp. Unused program memory holds HALT.
+*
+*               The instructions besides those in CPU_INSTRUCTIONS are listed in
+*               EMULATOR_INSTRUCTIONS. ALU instructions take a register or an
+*               immediate as second operand (e.g. ADD R16, R17 or ADD R16, 5),
+*               while the multiply and divide instructions place their 16-bit
+*               result in R1:R0.
+*
+*               The data memory is divided into pages of 256 bytes, which are
+*               shared by the machine and its snapshots (see machine::save)
+*               and copied on the first write after a snapshot. Saving the
+*               state therefore copies no memory, and restoring it copies only
+*               the pages written afterwards, on their next write.
+*
+*               Data addresses 0x00 - 0xFF hold the I/O registers, of which the
+*               ones of Timer/Counter0 (see timer.hpp) are implemented, while
+*               the other addresses in this range behave as memory.
+*
+*               Interrupts are enabled by the I flag in bit 7 of SREG (SEI and
+*               CLI). The cycle of the next interrupt is kept in
+*               machine::next_event, which is recomputed whenever the timer
+*               registers or the I flag change, so that the execution loop
+*               only compares it with the clock. An accepted interrupt pushes
+*               the program counter, clears I and jumps to the vector, RETI
+*               returns and sets I again. As on the AVR, one more instruction
+*               is executed after SEI and RETI before the next interrupt.
+*
+*               SLEEP advances the clock to the next interrupt in one step,
+*               which is then accepted at once. The skipped cycles are counted
+*               in machine::skipped (together with those of idle loops, see
+*               idle.hpp). If no interrupt can occur, the CPU sleeps forever
+*               and is halted with sleeping set.
+********************************************************************************/
+#ifndef EMULATOR_HPP_
+#define EMULATOR_HPP_
+
+/* Include directives: */
+#include <vector>
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <iomanip>
+#include "alu.hpp"
+#include "timer.hpp"
+
+/********************************************************************************
+* EMULATOR_INSTRUCTIONS: Instructions of the CPU besides the ALU and multiply
+*                        and divide instructions. Each entry holds:
+*
+*                        - name    : Mnemonic of the instruction.
+*                        - code    : OP code of the instruction.
+*                        - format  : Operand format, see emulator::format.
+*                        - comment : Short description of the instruction.
+********************************************************************************/
+#define EMULATOR_INSTRUCTIONS(X) \
+   X(LDI,   0x40, rd_k,       "Load immediate, Rd = K.") \
+   X(MOV,   0x41, rd_rr,      "Copy register, Rd = Rr.") \
+   X(LD,    0x42, rd_address, "Load direct, Rd = data[k].") \
+   X(LDX,   0x43, rd_pointer, "Load indirect, Rd = data[Rr+1:Rr], written LD Rd, [Rr].") \
+   X(ST,    0x44, address_rr, "Store direct, data[k] = Rr.") \
+   X(STX,   0x45, pointer_rr, "Store indirect, data[Rd+1:Rd] = Rr, written ST [Rd], Rr.") \
+   X(PUSH,  0x46, rr,         "Push register onto the stack.") \
+   X(POP,   0x47, rd,         "Pop register from the stack.") \
+   X(JMP,   0x48, target,     "Jump to address k.") \
+   X(CALL,  0x49, target,     "Call subroutine at address k.") \
+   X(RET,   0x4A, none,       "Return from subroutine.") \
+   X(BRBS,  0x4B, bit_target, "Branch to k if status flag s is set.") \
+   X(BRBC,  0x4C, bit_target, "Branch to k if status flag s is cleared.") \
+   X(SLEEP, 0x4D, none,       "Sleep until the next interrupt.") \
+   X(HALT,  0x4E, none,       "Stop the execution.") \
+   X(SEI,   0x4F, none,       "Enable interrupts, I = 1.") \
+   X(CLI,   0x50, none,       "Disable interrupts, I = 0.") \
+   X(RETI,  0x51, none,       "Return from interrupt, I = 1.")
+
+/********************************************************************************
+* EMULATOR_BRANCHES: Conditional branches, being aliases of BRBS and BRBC for
+*                    one status flag. Each entry holds the mnemonic, the
+*                    instruction (BRBS or BRBC) and the status flag.
+********************************************************************************/
+#define EMULATOR_BRANCHES(X) \
+   X(BREQ, BRBS, Z) \
+   X(BRNE, BRBC, Z) \
+   X(BRCS, BRBS, C) \
+   X(BRCC, BRBC, C) \
+   X(BRLO, BRBS, C) \
+   X(BRSH, BRBC, C) \
+   X(BRMI, BRBS, N) \
+   X(BRPL, BRBC, N) \
+   X(BRVS, BRBS, V) \
+   X(BRVC, BRBC, V) \
+   X(BRLT, BRBS, S) \
+   X(BRGE, BRBC, S)
+
+/********************************************************************************
+* emulator: Namespace containing the CPU.
+********************************************************************************/
+namespace emulator
+{
+   using namespace cpu; /* Brings all content of the cpu namespace into current scope. */
+
+   /********************************************************************************
+   * Instructions (OP codes generated from EMULATOR_INSTRUCTIONS):
+   ********************************************************************************/
+#define EMULATOR_OP_CODE(name, code, format, comment) static constexpr std::uint8_t name = code;
+   EMULATOR_INSTRUCTIONS(EMULATOR_OP_CODE)
+#undef EMULATOR_OP_CODE
+
+   static constexpr std::size_t program_size = 65536; /* Number of instructions. */
+   static constexpr std::size_t data_size = 65536;    /* Bytes of data memory. */
+   static constexpr std::uint8_t immediate = 0xFF;    /* rr of ALU instructions using k. */
+   static constexpr std::size_t page_size = 256;      /* Bytes per page of data memory. */
+   static constexpr std::size_t page_count = data_size / page_size;
+   static constexpr std::uint16_t io_size = 0x100;    /* Data addresses of the I/O registers. */
+   static constexpr std::uint8_t I = 7;               /* Global interrupt enable flag of SREG. */
+
+   /********************************************************************************
+   * format: Operand formats of the instructions, where Rd is the destination
+   *         register, Rr the source register, K an 8-bit immediate, k a
+   *         16-bit address and s a status flag.
+   ********************************************************************************/
+   enum class format { none, rd, rr, rd_rr, rd_k, rd_address, rd_pointer, address_rr, pointer_rr,
+                       target, bit_target, alu, alu_unary, mdu };
+
+   struct machine;
+   struct instruction;
+
+   /********************************************************************************
+   * handler: Function executing a pre-decoded instruction.
+   ********************************************************************************/
+   using handler = void (*)(machine&, const instruction&);
+
+   /********************************************************************************
+   * instruction: A pre-decoded instruction.
+   *
+   *              - execute: The handler executing the instruction.
+   *              - op     : OP code of the instruction.
+   *              - rd     : Destination register (or status flag for branches).
+   *              - rr     : Source register, or immediate for ALU instructions
+   *                         using k as second operand.
+   *              - k      : Immediate or address.
+   *              - mask   : Status flags tested by a conditional breakpoint.
+   *              - value  : Expected value of the tested status flags.
+   ********************************************************************************/
+   struct instruction
+   {
+      handler execute = nullptr;
+      std::uint8_t op = HALT;
+      std::uint8_t rd = 0;
+      std::uint8_t rr = 0;
+      std::uint8_t mask = 0;
+      std::uint16_t k = 0;
+      std::uint8_t value = 0;
+   };
+
+   /********************************************************************************
+   * event: Reason why the CPU was stopped by the debugger (see debugger.hpp),
+   *        or illegal if it reached an instruction its configuration doesn't
+   *        support, such as DIV or MOD without the divide unit.
+   ********************************************************************************/
+   enum class event { none, breakpoint, condition, watchpoint, illegal };
+
+   /********************************************************************************
+   * watchpoint: Range of data addresses from first to last (inclusive), where
+   *             a write stops the CPU.
+   ********************************************************************************/
+   struct watchpoint
+   {
+      std::uint16_t first;
+      std::uint16_t last;
+   };
+
+   /********************************************************************************
+   * image: Program and initial data memory produced by the assembler.
+   *
+   *        - program: The pre-decoded instructions from address 0.
+   *        - data   : Initial content of the data memory from address 0.
+   *        - lines  : Source line of each instruction (0 = none), or empty if
+   *                   the source is unknown.
+   ********************************************************************************/
+   struct image
+   {
+      std::vector<instruction> program;
+      std::vector<std::uint8_t> data;
+      std::vector<std::uint32_t> lines;
+   };
+
+   /********************************************************************************
+   * page: A page of data memory.
+   ********************************************************************************/
+   using page = std::array<std::uint8_t, page_size>;
+
+   /********************************************************************************
+   * page_table: The pages of the data memory. A page table or page referenced
+   *             by more than one owner is never modified, but copied first.
+   ********************************************************************************/
+   using page_table = std::array<std::shared_ptr<page>, page_count>;
+
+   /********************************************************************************
+   * snapshot: Saved state of the CPU, see machine::save and machine::restore.
+   *           The data memory is held as a reference to the page table.
+   ********************************************************************************/
+   struct snapshot
+   {
+      std::array<std::uint8_t, 32> r{};
+      std::uint8_t sreg = 0;
+      std::uint16_t pc = 0;
+      std::uint16_t sp = data_size - 1;
+      std::uint64_t cycles = 0;
+      std::uint64_t instructions = 0;
+      std::uint64_t interrupts = 0;
+      bool halted = false;
+      bool sleeping = false;
+      mdu::config mdu_config;
+      timer::timer0 timer0;
+      std::uint64_t next_event = timer::never;
+      std::uint64_t skipped = 0;
+      std::shared_ptr<page_table> pages;
+   };
+
+   /********************************************************************************
+   * machine: State of the CPU.
+   ********************************************************************************/
+   struct machine
+   {
+      std::array<std::uint8_t, 32> r{};           /* Registers R0 - R31. */
+      std::uint8_t sreg = 0;                      /* Status register. */
+      std::uint16_t pc = 0;                       /* Program counter. */
+      std::uint16_t sp = data_size - 1;           /* Stack pointer. */
+      std::uint64_t cycles = 0;                   /* Elapsed clock cycles. */
+      std::uint64_t instructions = 0;             /* Executed instructions. */
+      std::uint64_t interrupts = 0;               /* Accepted interrupts. */
+      bool halted = false;                        /* Indicates if HALT was executed. */
+      bool sleeping = false;                      /* Indicates if SLEEP was executed. */
+      event stopped = event::none;                /* Reason the CPU was stopped (sets halted), see event. */
+      std::uint16_t event_address = 0;            /* Program or data address of the event. */
+      mdu::config mdu_config;                     /* Configuration of the multiply and divide unit. */
+      timer::timer0 timer0;                       /* Timer/Counter0. */
+      std::uint64_t next_event = timer::never;    /* Cycle of the next interrupt, see schedule. */
+      std::uint64_t skipped = 0;                  /* Cycles skipped by SLEEP and idle loops. */
+      std::uint64_t run_end = ~0ULL;              /* Instruction count at which run stops, see idle.hpp. */
+      std::vector<instruction> program;           /* Program memory. */
+      std::shared_ptr<page_table> pages;          /* Data memory. */
+      std::shared_ptr<page_table> origin;         /* Shared page table the pages were copied from. */
+      std::vector<std::size_t> dirty;             /* Pages differing from those of origin. */
+      std::array<std::uint8_t*, page_count> page_data{};   /* Bytes of each page. */
+      std::array<std::uint64_t, page_count> page_owner{};  /* Generation each page was made writable in. */
+      std::uint64_t generation = 0;               /* Incremented whenever the pages get shared. */
+      std::uint64_t page_copies = 0;              /* Pages copied on write since load. */
+      std::array<std::uint64_t, page_count / 64> watched{};  /* One bit per page holding a watchpoint. */
+      std::vector<watchpoint> watchpoints;        /* Watched ranges of data memory. */
+      void* instrumentation = nullptr;            /* State of the handlers installed by the profiler or coverage. */
+      void* debugger = nullptr;                   /* Session of the breakpoints, see debugger.hpp. */
+
+      /********************************************************************************
+      * machine: Creates a CPU with program memory filled with HALT.
+      ********************************************************************************/
+      machine(void);
+
+      machine(const machine&) = delete;
+      machine& operator=(const machine&) = delete;
+
+      /********************************************************************************
+      * load: Loads specified image into program and data memory and resets the
+      *       CPU.
+      ********************************************************************************/
+      void load(const image& img);
+
+      /********************************************************************************
+      * reset: Resets registers, status register, program counter, stack pointer
+      *        and counters, leaving the memories unchanged.
+      ********************************************************************************/
+      void reset(void)
+      {
+         r.fill(0);
+         sreg = 0;
+         pc = 0;
+         sp = static_cast<std::uint16_t>(data_size - 1);
+         cycles = 0;
+         instructions = 0;
+         interrupts = 0;
+         halted = false;
+         sleeping = false;
+         stopped = event::none;
+         timer0 = timer::timer0{};
+         next_event = timer::never;
+         skipped = 0;
+         return;
+      }
+
+      /********************************************************************************
+      * read: Returns the byte at specified data address.
+      ********************************************************************************/
+      std::uint8_t read(const std::uint16_t address)
+      {
+         if (address < io_size && timer::is_register(address)) return timer0.read(address, cycles);
+         return page_data[address / page_size][address % page_size];
+      }
+
+      /********************************************************************************
+      * write: Writes specified byte to specified data address. The first write
+      *        to a page since the pages were shared makes the page writable.
+      *        Pages holding I/O registers or a watchpoint are never marked as
+      *        owned, so that only writes to those pages are passed to the
+      *        registers and checked against the watchpoints.
+      ********************************************************************************/
+      void write(const std::uint16_t address,
+                 const std::uint8_t value)
+      {
+         const auto index = address / page_size;
+
+         if (page_owner[index] != generation)
+         {
+            own(index);
+
+            if (page_owner[index] != generation)
+            {
+               if (address < io_size && timer::is_register(address))
+               {
+                  timer0.write(address, value, cycles);
+                  schedule();
+               }
+               check(address);
+            }
+         }
+
+         page_data[index][address % page_size] = value;
+         return;
+      }
+
+      /********************************************************************************
+      * own: Makes specified page writable by copying the page table and the
+      *      page, if they are shared with a snapshot. A copied page is marked
+      *      as dirty.
+      ********************************************************************************/
+      void own(const std::size_t index);
+
+      /********************************************************************************
+      * is_special: Returns true if specified page holds I/O registers or a
+      *             watchpoint.
+      ********************************************************************************/
+      bool is_special(const std::size_t index) const
+      {
+         return index < io_size / page_size || ((watched[index / 64] >> (index % 64)) & 1);
+      }
+
+      /********************************************************************************
+      * watch: Adds a watchpoint for data addresses first to last (inclusive).
+      ********************************************************************************/
+      void watch(const std::uint16_t first,
+                 const std::uint16_t last);
+
+      /********************************************************************************
+      * unwatch: Removes the watchpoint for data addresses first to last.
+      ********************************************************************************/
+      void unwatch(const std::uint16_t first,
+                   const std::uint16_t last);
+
+      /********************************************************************************
+      * check: Stops the CPU if specified data address is watched.
+      ********************************************************************************/
+      void check(const std::uint16_t address);
+
+      /********************************************************************************
+      * save: Returns a snapshot of the current state. The page table is shared
+      *       with the snapshot, so no memory is copied.
+      ********************************************************************************/
+      snapshot save(void);
+
+      /********************************************************************************
+      * restore: Restores the state of specified snapshot. If the page table was
+      *          copied from the snapshot, only the dirty pages are set back to
+      *          those of the snapshot, otherwise the page table is copied. The
+      *          pages are copied again on their next write.
+      ********************************************************************************/
+      void restore(const snapshot& s);
+
+      /********************************************************************************
+      * schedule: Sets next_event to the cycle of the next interrupt, or never
+      *           if interrupts are disabled. Must be called after the I flag
+      *           or the timer registers were changed other than by write.
+      ********************************************************************************/
+      void schedule(void)
+      {
+         next_event = cpu::read(sreg, I) ? timer0.next_interrupt(cycles) : timer::never;
+         return;
+      }
+
+      /********************************************************************************
+      * interrupt: Accepts the pending interrupt of highest priority, if any,
+      *            and schedules the next one. Called at next_event.
+      ********************************************************************************/
+      void interrupt(void);
+
+      /********************************************************************************
+      * step: Executes one instruction, unless the CPU is halted.
+      ********************************************************************************/
+      void step(void)
+      {
+         if (halted) return;
+         run_end = instructions + 1;
+         if (cycles >= next_event) interrupt();
+         const auto& ins = program[pc];
+         ins.execute(*this, ins);
+         ++instructions;
+         return;
+      }
+
+      /********************************************************************************
+      * run: Executes instructions until HALT or until specified number of
+      *      instructions has been executed. Interrupts are accepted between
+      *      instructions once the clock reaches next_event. The number of
+      *      executed instructions is returned, including iterations of idle
+      *      loops skipped within the limit (see run_end).
+      *
+      *      - limit: Maximum number of instructions (default = no limit).
+      ********************************************************************************/
+      std::uint64_t run(const std::uint64_t limit = ~0ULL)
+      {
+         const auto start = instructions;
+         run_end = limit < ~0ULL - start ? start + limit : ~0ULL;
+
+         while (!halted && instructions < run_end)
+         {
+            if (cycles >= next_event) interrupt();
+            const auto& ins = program[pc];
+            ins.execute(*this, ins);
+            ++instructions;
+         }
+         return instructions - start;
+      }
+   };
+
+   /********************************************************************************
+   * Handlers: One per instruction format and OP code. Each handler performs
+   *           the instruction, adds its cycles and advances the program counter.
+   ********************************************************************************/
+   static void execute_NOP(machine& m, const instruction&)
+   {
+      m.cycles += 1;
+      m.pc++;
+      return;
+   }
+
+   static void execute_alu(machine& m, const instruction& ins)
+   {
+      m.r[ins.rd] = alu::calculate(ins.op, m.r[ins.rd], m.r[ins.rr], m.sreg);
+      m.cycles += 1;
+      m.pc++;
+      return;
+   }
+
+   static void execute_alu_immediate(machine& m, const instruction& ins)
+   {
+      m.r[ins.rd] = alu::calculate(ins.op, m.r[ins.rd], static_cast<std::uint8_t>(ins.k), m.sreg);
+      m.cycles += 1;
+      m.pc++;
+      return;
+   }
+
+   static void execute_mdu(machine& m, const instruction& ins)
+   {
+      if (!mdu::available(ins.op, m.mdu_config))
+      {
+         m.halted = true;
+         m.stopped = event::illegal;
+         m.event_address = m.pc;
+         return;
+      }
+
+      const auto result = mdu::calculate(ins.op, m.r[ins.rd], m.r[ins.rr], m.sreg, m.mdu_config);
+      const auto cycles = mdu::cycles(ins.op, m.mdu_config);
+      m.r[0] = static_cast<std::uint8_t>(result);
+      m.r[1] = static_cast<std::uint8_t>(result >> 8);
+      m.cycles += cycles ? cycles : 1;
+      m.pc++;
+      return;
+   }
+
+   static void execute_LDI(machine& m, const instruction& ins)
+   {
+      m.r[ins.rd] = static_cast<std::uint8_t>(ins.k);
+      m.cycles += 1;
+      m.pc++;
+      return;
+   }
+
+   static void execute_MOV(machine& m, const instruction& ins)
+   {
+      m.r[ins.rd] = m.r[ins.rr];
+      m.cycles += 1;
+      m.pc++;
+      return;
+   }
+
+   static void execute_LD(machine& m, const instruction& ins)
+   {
+      m.r[ins.rd] = m.read(ins.k);
+      m.cycles += 2;
+      m.pc++;
+      return;
+   }
+
+   static void execute_LDX(machine& m, const instruction& ins)
+   {
+      m.r[ins.rd] = m.read(static_cast<std::uint16_t>(m.r[ins.rr] | (m.r[(ins.rr + 1) & 31] << 8)));
+      m.cycles += 2;
+      m.pc++;
+      return;
+   }
+
+   static void execute_ST(machine& m, const instruction& ins)
+   {
+      m.write(ins.k, m.r[ins.rr]);
+      m.cycles += 2;
+      m.pc++;
+      return;
+   }
+
+   static void execute_STX(machine& m, const instruction& ins)
+   {
+      m.write(static_cast<std::uint16_t>(m.r[ins.rd] | (m.r[(ins.rd + 1) & 31] << 8)), m.r[ins.rr]);
+      m.cycles += 2;
+      m.pc++;
+      return;
+   }
+
+   static void execute_PUSH(machine& m, const instruction& ins)
+   {
+      m.write(m.sp--, m.r[ins.rr]);
+      m.cycles += 2;
+      m.pc++;
+      return;
+   }
+
+   static void execute_POP(machine& m, const instruction& ins)
+   {
+      m.r[ins.rd] = m.read(++m.sp);
+      m.cycles += 2;
+      m.pc++;
+      return;
+   }
+
+   static void execute_JMP(machine& m, const instruction& ins)
+   {
+      m.pc = ins.k;
+      m.cycles += 3;
+      return;
+   }
+
+   static void execute_CALL(machine& m, const instruction& ins)
+   {
+      const auto ret = static_cast<std::uint16_t>(m.pc + 1);
+      m.write(m.sp--, static_cast<std::uint8_t>(ret));
+      m.write(m.sp--, static_cast<std::uint8_t>(ret >> 8));
+      m.pc = ins.k;
+      m.cycles += 4;
+      return;
+   }
+
+   static void execute_RET(machine& m, const instruction&)
+   {
+      const auto high = m.read(++m.sp);
+      const auto low = m.read(++m.sp);
+      m.pc = static_cast<std::uint16_t>((high << 8) | low);
+      m.cycles += 4;
+      return;
+   }
+
+   static void execute_BRBS(machine& m, const instruction& ins)
+   {
+      const auto taken = read(m.sreg, ins.rd);
+      m.pc = taken ? ins.k : static_cast<std::uint16_t>(m.pc + 1);
+      m.cycles += taken ? 2 : 1;
+      return;
+   }
+
+   static void execute_BRBC(machine& m, const instruction& ins)
+   {
+      const auto taken = !read(m.sreg, ins.rd);
+      m.pc = taken ? ins.k : static_cast<std::uint16_t>(m.pc + 1);
+      m.cycles += taken ? 2 : 1;
+      return;
+   }
+
+   static void execute_RETI(machine& m, const instruction& ins)
+   {
+      execute_RET(m, ins);
+      set(m.sreg, I);
+      m.schedule();
+      m.next_event = std::max(m.next_event, m.cycles + 1);
+      return;
+   }
+
+   static void execute_SEI(machine& m, const instruction&)
+   {
+      set(m.sreg, I);
+      m.cycles += 1;
+      m.pc++;
+      m.schedule();
+      m.next_event = std::max(m.next_event, m.cycles + 1);
+      return;
+   }
+
+   static void execute_CLI(machine& m, const instruction&)
+   {
+      clr(m.sreg, I);
+      m.cycles += 1;
+      m.pc++;
+      m.next_event = timer::never;
+      return;
+   }
+
+   static void execute_SLEEP(machine& m, const instruction&)
+   {
+      m.sleeping = true;
+      m.cycles += 1;
+      m.pc++;
+
+      if (m.next_event == timer::never)
+      {
+         m.halted = true;
+      }
+      else if (m.next_event > m.cycles)
+      {
+         m.skipped += m.next_event - m.cycles;
+         m.cycles = m.next_event;
+      }
+      return;
+   }
+
+   static void execute_HALT(machine& m, const instruction&)
+   {
+      m.halted = true;
+      return;
+   }
+
+   /********************************************************************************
+   * get_format: Returns the operand format of specified instruction.
+   ********************************************************************************/
+   static format get_format(const std::uint8_t op)
+   {
+      switch (op)
+      {
+      case NOP: return format::none;
+#define EMULATOR_FORMAT(name, code, format_, comment) case name: return format::format_;
+      EMULATOR_INSTRUCTIONS(EMULATOR_FORMAT)
+#undef EMULATOR_FORMAT
+      default: break;
+      }
+
+      if (is_wide(op))  return format::mdu;
+      if (is_unary(op)) return format::alu_unary;
+      return format::alu;
+   }
+
+   /********************************************************************************
+   * get_name: Returns the mnemonic of specified instruction.
+   ********************************************************************************/
+   static const char* get_name(const std::uint8_t op)
+   {
+      switch (op)
+      {
+      case NOP: return "NOP";
+#define EMULATOR_NAME(name, code, format, comment) case name: return #name;
+      EMULATOR_INSTRUCTIONS(EMULATOR_NAME)
+#undef EMULATOR_NAME
+      default: return get_instruction_name(op);
+      }
+   }
+
+   /********************************************************************************
+   * make: Returns a pre-decoded instruction with the handler selected from
+   *       specified OP code and operands.
+   *
+   *       - op: OP code of the instruction.
+   *       - rd: Destination register (or status flag for branches).
+   *       - rr: Source register, or immediate for ALU instructions using k.
+   *       - k : Immediate or address.
+   ********************************************************************************/
+   static instruction make(const std::uint8_t op,
+                           const std::uint8_t rd = 0,
+                           const std::uint8_t rr = 0,
+                           const std::uint16_t k = 0)
+   {
+      instruction ins;
+      ins.op = op;
+      ins.rd = rd;
+      ins.rr = rr;
+      ins.k = k;
+
+      switch (op)
+      {
+      case NOP: ins.execute = execute_NOP; break;
+#define EMULATOR_HANDLER(name, code, format, comment) case name: ins.execute = execute_##name; break;
+      EMULATOR_INSTRUCTIONS(EMULATOR_HANDLER)
+#undef EMULATOR_HANDLER
+      default:
+      {
+         if (is_wide(op))          ins.execute = execute_mdu;
+         else if (rr == immediate) ins.execute = execute_alu_immediate;
+         else                      ins.execute = execute_alu;
+         break;
+      }
+      }
+      return ins;
+   }
+
+   /********************************************************************************
+   * print: Prints the registers, status register, program counter with the
+   *        mnemonic of the instruction there, stack pointer and counters of
+   *        specified machine.
+   *
+   *        - m      : Reference to the machine.
+   *        - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static inline void print(const machine& m,
+                            std::ostream& ostream = std::cout)
+   {
+      ostream << "--------------------------------------------------------------------------------\n";
+
+      for (std::uint8_t i = 0; i < 32; ++i)
+      {
+         ostream << (i < 10 ? " R" : "R") << static_cast<int>(i) << " = " << std::setw(3)
+            << static_cast<int>(m.r[i]) << ((i % 8) == 7 ? "\n" : "  ");
+      }
+
+      ostream << "SNZVC = " << std::bitset<5>(m.sreg) << ", PC = " << m.pc << " (" << get_name(m.program[m.pc].op)
+         << "), SP = " << m.sp
+         << ", instructions = " << m.instructions << ", cycles = " << m.cycles
+         << (m.halted ? (m.stopped == event::illegal ? " (illegal instruction)" : m.sleeping ? " (sleeping)" : " (halted)") : "")
+         << "\n";
+
+      if (m.skipped)
+      {
+         ostream << "Skipped cycles = " << m.skipped << " (" << std::fixed << std::setprecision(1)
+            << 100.0 * m.skipped / m.cycles << " % of the emulated time)\n";
+      }
+      ostream << "--------------------------------------------------------------------------------\n\n";
+      return;
+   }
+
+   inline machine::machine(void)
+      : program(program_size)
+   {
+      load(image{});
+   }
+
+   inline void machine::load(const image& img)
+   {
+      std::fill(program.begin(), program.end(), make(HALT));
+      std::copy(img.program.begin(), img.program.begin() + std::min(img.program.size(), program_size), program.begin());
+
+      const auto zero = std::make_shared<page>();
+      zero->fill(0);
+      pages = std::make_shared<page_table>();
+      pages->fill(zero);
+      page_data.fill(zero->data());
+      origin.reset();
+      dirty.clear();
+      ++generation;
+
+      for (std::size_t address = 0; address < std::min(img.data.size(), data_size); ++address)
+      {
+         if (img.data[address]) write(static_cast<std::uint16_t>(address), img.data[address]);
+      }
+
+      page_copies = 0;
+      reset();
+      return;
+   }
+
+   inline void machine::own(const std::size_t index)
+   {
+      if (pages.use_count() > 1)
+      {
+         origin = pages;
+         pages = std::make_shared<page_table>(*pages);
+         dirty.clear();
+      }
+
+      auto& slot = (*pages)[index];
+
+      if (slot.use_count() > 1)
+      {
+         slot = std::make_shared<page>(*slot);
+         page_data[index] = slot->data();
+         dirty.push_back(index);
+         ++page_copies;
+      }
+
+      page_owner[index] = is_special(index) ? ~0ULL : generation;
+      return;
+   }
+
+   inline void machine::interrupt(void)
+   {
+      const auto vector = cpu::read(sreg, I) ? timer0.acknowledge(cycles) : 0;
+
+      if (vector)
+      {
+         write(sp--, static_cast<std::uint8_t>(pc));
+         write(sp--, static_cast<std::uint8_t>(pc >> 8));
+         pc = vector;
+         clr(sreg, I);
+         cycles += 4;
+         sleeping = false;
+         ++interrupts;
+      }
+
+      schedule();
+      return;
+   }
+
+   inline void machine::watch(const std::uint16_t first,
+                              const std::uint16_t last)
+   {
+      watchpoints.push_back(watchpoint{ first, last });
+
+      for (auto index = first / page_size; index <= last / page_size; ++index)
+      {
+         watched[index / 64] |= 1ULL << (index % 64);
+         page_owner[index] = ~0ULL;
+      }
+      return;
+   }
+
+   inline void machine::unwatch(const std::uint16_t first,
+                                const std::uint16_t last)
+   {
+      watchpoints.erase(std::remove_if(watchpoints.begin(), watchpoints.end(),
+         [&](const watchpoint& w) { return w.first == first && w.last == last; }), watchpoints.end());
+      watched.fill(0);
+
+      for (const auto& w : watchpoints)
+      {
+         for (auto index = w.first / page_size; index <= w.last / page_size; ++index)
+         {
+            watched[index / 64] |= 1ULL << (index % 64);
+         }
+      }
+
+      for (std::size_t index = 0; index < page_count; ++index)
+      {
+         if (!is_special(index) && page_owner[index] == ~0ULL) page_owner[index] = 0;
+      }
+      return;
+   }
+
+   inline void machine::check(const std::uint16_t address)
+   {
+      for (const auto& w : watchpoints)
+      {
+         if (address >= w.first && address <= w.last)
+         {
+            halted = true;
+            stopped = event::watchpoint;
+            event_address = address;
+            return;
+         }
+      }
+      return;
+   }
+
+   inline snapshot machine::save(void)
+   {
+      snapshot s;
+      s.r = r;
+      s.sreg = sreg;
+      s.pc = pc;
+      s.sp = sp;
+      s.cycles = cycles;
+      s.instructions = instructions;
+      s.interrupts = interrupts;
+      s.halted = halted;
+      s.sleeping = sleeping;
+      s.mdu_config = mdu_config;
+      s.timer0 = timer0;
+      s.next_event = next_event;
+      s.skipped = skipped;
+      s.pages = pages;
+      ++generation;
+      return s;
+   }
+
+   inline void machine::restore(const snapshot& s)
+   {
+      r = s.r;
+      sreg = s.sreg;
+      pc = s.pc;
+      sp = s.sp;
+      cycles = s.cycles;
+      instructions = s.instructions;
+      interrupts = s.interrupts;
+      halted = s.halted;
+      sleeping = s.sleeping;
+      stopped = event::none;
+      mdu_config = s.mdu_config;
+      timer0 = s.timer0;
+      next_event = s.next_event;
+      skipped = s.skipped;
+
+      if (pages != s.pages && origin == s.pages && pages.use_count() == 1)
+      {
+         for (const auto i : dirty)
+         {
+            (*pages)[i] = (*origin)[i];
+            page_data[i] = (*pages)[i]->data();
+         }
+      }
+      else if (pages != s.pages)
+      {
+         if (pages.use_count() == 1) *pages = *s.pages;
+         else                        pages = std::make_shared<page_table>(*s.pages);
+         origin = s.pages;
+         for (std::size_t i = 0; i < page_count; ++i) page_data[i] = (*pages)[i]->data();
+      }
+
+      dirty.clear();
+      ++generation;
+      return;
+   }
+}
+
+#endif /* EMULATOR_HPP_ */
\ No newline at end of file
@@ -0,0 +1,613 @@
+/********************************************************************************
+* expr.hpp: Contains a compiler of infix expressions into sequences of ALU
+*           operations, for instance (a + b) & 0x0F ^ c. The expressions may
+*           contain the following:
+*
+*           - Numbers in decimal, hexadecimal (0x) or binary (0b) notation in
+*             the range 0 - 255.
+*           - Variables, i.e. names starting with a letter or underscore.
+*           - The binary operators +, -, &, ^ and | (ADD, SUB, AND, XOR and
+*             OR), with the precedence of C, i.e. + and - bind tightest and |
+*             loosest. Operators of equal precedence are left associative.
+*           - The unary operators - (0 - x) and ~ (x ^ 0xFF) and parentheses.
+*
+*           The expression is parsed into an AST, where identical subtrees are
+*           shared so that each is computed once. When the program is emitted,
+*           operations on constants are folded with the constexpr ALU kernels
+*           and identities such as x + 0 and x & 0xFF are removed, except for
+*           the last operation, whose status flags SNZVC are the flags of the
+*           expression. The result is a minimal sequence of OR, AND, XOR, ADD
+*           and SUB operations, which is evaluated either for one binding of
+*           the variables or for many bindings at once via batch::calculate.
+********************************************************************************/
+#ifndef EXPR_HPP_
+#define EXPR_HPP_
+
+/* Include directives: */
+#include <map>
+#include <algorithm>
+#include <tuple>
+#include <vector>
+#include <string>
+#include <cctype>
+#include <stdexcept>
+#include "batch.hpp"
+
+/********************************************************************************
+* expr: Namespace containing the expression compiler.
+********************************************************************************/
+namespace expr
+{
+   using namespace cpu; /* Brings all content of the cpu namespace into current scope. */
+
+   /********************************************************************************
+   * fold: Performs OR, AND, XOR, ADD or SUB at compile time when the operands
+   *       are constant, exactly as alu::calculate. Other operations return 0
+   *       and leave the status register unchanged.
+   *
+   *       - operation: The operation to perform.
+   *       - a        : First operand.
+   *       - b        : Second operand.
+   *       - sr       : Reference to status register containing SNZVC flags.
+   ********************************************************************************/
+   static constexpr std::uint8_t fold(const std::uint8_t operation,
+                                      const std::uint8_t a,
+                                      const std::uint8_t b,
+                                      std::uint8_t& sr)
+   {
+      switch (operation)
+      {
+      case OR:  return alu::finish(alu::kernel<OR>(a, b, 0), sr);
+      case AND: return alu::finish(alu::kernel<AND>(a, b, 0), sr);
+      case XOR: return alu::finish(alu::kernel<XOR>(a, b, 0), sr);
+      case ADD: return alu::finish(alu::kernel<ADD>(a, b, 0), sr);
+      case SUB: return alu::finish(alu::kernel<SUB>(a, b, 0), sr);
+      default:  return 0;
+      }
+   }
+
+   /********************************************************************************
+   * folded_flags: Returns the status flags of a folded operation.
+   ********************************************************************************/
+   static constexpr std::uint8_t folded_flags(const std::uint8_t operation,
+                                              const std::uint8_t a,
+                                              const std::uint8_t b)
+   {
+      std::uint8_t sr = 0;
+      fold(operation, a, b, sr);
+      return sr;
+   }
+
+   static_assert(folded_flags(ADD, 0x80, 0x80) == ((1 << S) | (1 << Z) | (1 << V) | (1 << C)), "");
+   static_assert(folded_flags(SUB, 0x05, 0x05) == ((1 << Z) | (1 << C)), "");
+
+   /********************************************************************************
+   * operand: Operand of an instruction, being a constant, a variable (index
+   *          into the bindings) or a temporary (index of the instruction
+   *          producing it).
+   ********************************************************************************/
+   struct operand
+   {
+      enum class kind { constant, variable, temporary };
+      kind type = kind::constant;
+      std::uint32_t index = 0;
+      std::uint8_t value = 0;
+
+      bool operator==(const operand& other) const
+      {
+         return type == other.type && index == other.index && value == other.value;
+      }
+   };
+
+   /********************************************************************************
+   * instruction: An ALU operation of the compiled program.
+   ********************************************************************************/
+   struct instruction
+   {
+      std::uint8_t operation;
+      operand a;
+      operand b;
+   };
+
+   /********************************************************************************
+   * expression: A compiled expression.
+   ********************************************************************************/
+   class expression
+   {
+   public:
+
+      /********************************************************************************
+      * expression: Compiles specified expression. An exception of type
+      *             std::invalid_argument is thrown on syntax errors.
+      *
+      *             - source: The expression, e.g. "(a + b) & 0x0F ^ c".
+      ********************************************************************************/
+      explicit expression(const std::string& source)
+         : source_{ source }
+      {
+         const auto root = parse_or();
+         skip_spaces();
+         if (position_ < source_.size()) throw std::invalid_argument("Unexpected character in expression!");
+
+         result_ = emit(root, true);
+         nodes_.clear();
+         shared_.clear();
+         emitted_.clear();
+      }
+
+      /********************************************************************************
+      * variables: Returns the names of the variables in order of appearance,
+      *            which is the order of the bindings.
+      ********************************************************************************/
+      const std::vector<std::string>& variables(void) const
+      {
+         return variables_;
+      }
+
+      /********************************************************************************
+      * program: Returns the instructions of the compiled program.
+      ********************************************************************************/
+      const std::vector<instruction>& program(void) const
+      {
+         return program_;
+      }
+
+      /********************************************************************************
+      * evaluate: Evaluates the expression and returns the result. The status
+      *           flags of the referenced status register are set as by the
+      *           last operation. An expression without operations, e.g. a
+      *           single variable, leaves the status register unchanged.
+      *
+      *           - bindings: Pointer to the values of the variables.
+      *           - sr      : Reference to status register containing SNZVC flags.
+      ********************************************************************************/
+      std::uint8_t evaluate(const std::uint8_t* bindings,
+                            std::uint8_t& sr) const
+      {
+         std::vector<std::uint8_t> temporaries(program_.size());
+
+         for (std::size_t i = 0; i < program_.size(); ++i)
+         {
+            const auto& ins = program_[i];
+            temporaries[i] = alu::calculate(ins.operation, value(ins.a, bindings, temporaries),
+                                            value(ins.b, bindings, temporaries), sr);
+         }
+
+         if (folded_) sr = static_cast<std::uint8_t>((sr & ~0x1F) | flags_);
+         return value(result_, bindings, temporaries);
+      }
+
+      /********************************************************************************
+      * evaluate: Evaluates the expression for n bindings of the variables at
+      *           once. The program is executed in blocks of elements, each
+      *           instruction processing a whole block via batch::calculate.
+      *
+      *           - bindings: Pointers to the n values of each variable.
+      *           - result  : Pointer to storage for the n results.
+      *           - sr      : Pointer to the n status registers.
+      *           - n       : The number of bindings.
+      ********************************************************************************/
+      void evaluate(const std::uint8_t* const* bindings,
+                    std::uint8_t* result,
+                    std::uint8_t* sr,
+                    const std::size_t n) const
+      {
+         std::vector<std::uint8_t> temporaries(program_.size() * block);
+         std::vector<std::uint8_t> constants[2] = { std::vector<std::uint8_t>(block), std::vector<std::uint8_t>(block) };
+
+         for (std::size_t first = 0; first < n; first += block)
+         {
+            const auto count = std::min(block, n - first);
+
+            for (std::size_t i = 0; i < program_.size(); ++i)
+            {
+               const auto& ins = program_[i];
+               const auto a = column(ins.a, bindings, temporaries, constants[0], first, count);
+               const auto b = column(ins.b, bindings, temporaries, constants[1], first, count);
+               batch::calculate(ins.operation, a, b, &temporaries[i * block], sr + first, count);
+            }
+
+            const auto r = column(result_, bindings, temporaries, constants[0], first, count);
+            std::copy(r, r + count, result + first);
+
+            if (folded_)
+            {
+               for (std::size_t i = first; i < first + count; ++i)
+               {
+                  sr[i] = static_cast<std::uint8_t>((sr[i] & ~0x1F) | flags_);
+               }
+            }
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * print: Prints the compiled program, one instruction per line, with
+      *        temporaries named t0, t1 and so on.
+      *
+      *        - ostream: Reference to output stream (default = std::cout).
+      ********************************************************************************/
+      void print(std::ostream& ostream = std::cout) const
+      {
+         for (std::size_t i = 0; i < program_.size(); ++i)
+         {
+            const auto& ins = program_[i];
+            ostream << "t" << i << " = " << get_instruction_name(ins.operation) << " "
+               << name(ins.a) << ", " << name(ins.b) << "\n";
+         }
+
+         ostream << "result = " << name(result_);
+         if (folded_) ostream << " (folded, SNZVC = " << std::bitset<5>(flags_).to_string() << ")";
+         ostream << "\n";
+         return;
+      }
+
+   private:
+
+      static constexpr std::size_t block = 4096; /* Elements per block in batch evaluation. */
+
+      /********************************************************************************
+      * node: A node of the AST, being a constant, a variable or an operation.
+      ********************************************************************************/
+      struct node
+      {
+         operand::kind type;
+         std::uint8_t operation;
+         std::uint32_t left;
+         std::uint32_t right;
+         std::uint8_t value;
+      };
+
+      /********************************************************************************
+      * make: Returns the index of a node with specified content, reusing an
+      *       identical node if one exists. The operands of the commutative
+      *       operations are ordered, so that a + b and b + a are shared, with
+      *       constants as second operand.
+      ********************************************************************************/
+      std::uint32_t make(const operand::kind type,
+                         const std::uint8_t operation,
+                         std::uint32_t left,
+                         std::uint32_t right,
+                         const std::uint8_t value)
+      {
+         if (type == operand::kind::temporary && operation != SUB)
+         {
+            const auto left_constant = nodes_[left].type == operand::kind::constant;
+            const auto right_constant = nodes_[right].type == operand::kind::constant;
+            if (left_constant != right_constant ? left_constant : left > right) std::swap(left, right);
+         }
+
+         const auto key = std::make_tuple(static_cast<int>(type), operation, left, right, value);
+         const auto shared = shared_.find(key);
+         if (shared != shared_.end()) return shared->second;
+
+         const auto index = static_cast<std::uint32_t>(nodes_.size());
+         nodes_.push_back(node{ type, operation, left, right, value });
+         shared_[key] = index;
+         return index;
+      }
+
+      /********************************************************************************
+      * constant: Returns the index of a constant node.
+      ********************************************************************************/
+      std::uint32_t constant(const std::uint8_t value)
+      {
+         return make(operand::kind::constant, NOP, 0, 0, value);
+      }
+
+      /********************************************************************************
+      * skip_spaces: Advances the position past white space.
+      ********************************************************************************/
+      void skip_spaces(void)
+      {
+         while (position_ < source_.size() && std::isspace(static_cast<unsigned char>(source_[position_])))
+         {
+            ++position_;
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * accept: Advances past specified character and returns true if it's the
+      *         next character, otherwise false is returned.
+      ********************************************************************************/
+      bool accept(const char c)
+      {
+         skip_spaces();
+         if (position_ >= source_.size() || source_[position_] != c) return false;
+         ++position_;
+         return true;
+      }
+
+      /********************************************************************************
+      * parse_or, parse_xor, parse_and, parse_sum: Parse the binary operators
+      *                                            from lowest to highest
+      *                                            precedence.
+      ********************************************************************************/
+      std::uint32_t parse_or(void)
+      {
+         auto left = parse_xor();
+         while (accept('|')) left = make(operand::kind::temporary, OR, left, parse_xor(), 0);
+         return left;
+      }
+
+      std::uint32_t parse_xor(void)
+      {
+         auto left = parse_and();
+         while (accept('^')) left = make(operand::kind::temporary, XOR, left, parse_and(), 0);
+         return left;
+      }
+
+      std::uint32_t parse_and(void)
+      {
+         auto left = parse_sum();
+         while (accept('&')) left = make(operand::kind::temporary, AND, left, parse_sum(), 0);
+         return left;
+      }
+
+      std::uint32_t parse_sum(void)
+      {
+         auto left = parse_unary();
+
+         while (true)
+         {
+            if (accept('+'))      left = make(operand::kind::temporary, ADD, left, parse_unary(), 0);
+            else if (accept('-')) left = make(operand::kind::temporary, SUB, left, parse_unary(), 0);
+            else                  return left;
+         }
+      }
+
+      /********************************************************************************
+      * parse_unary: Parses unary operators, parentheses, numbers and variables.
+      ********************************************************************************/
+      std::uint32_t parse_unary(void)
+      {
+         if (accept('-'))
+         {
+            const auto zero = constant(0x00);
+            return make(operand::kind::temporary, SUB, zero, parse_unary(), 0);
+         }
+
+         if (accept('~'))
+         {
+            const auto x = parse_unary();
+            return make(operand::kind::temporary, XOR, x, constant(0xFF), 0);
+         }
+
+         if (accept('('))
+         {
+            const auto inner = parse_or();
+            if (!accept(')')) throw std::invalid_argument("Missing closing parenthesis in expression!");
+            return inner;
+         }
+
+         skip_spaces();
+         if (position_ >= source_.size()) throw std::invalid_argument("Unexpected end of expression!");
+         const auto c = static_cast<unsigned char>(source_[position_]);
+
+         if (std::isdigit(c)) return constant(parse_number());
+
+         if (std::isalpha(c) || c == '_')
+         {
+            const auto first = position_;
+            while (position_ < source_.size() && (std::isalnum(static_cast<unsigned char>(source_[position_])) ||
+                   source_[position_] == '_')) ++position_;
+            const auto name = source_.substr(first, position_ - first);
+            const auto found = std::find(variables_.begin(), variables_.end(), name);
+            const auto index = static_cast<std::uint8_t>(found - variables_.begin());
+            if (found == variables_.end()) variables_.push_back(name);
+            if (variables_.size() > 256) throw std::invalid_argument("Too many variables in expression!");
+            return make(operand::kind::variable, NOP, 0, 0, index);
+         }
+
+         throw std::invalid_argument("Unexpected character in expression!");
+      }
+
+      /********************************************************************************
+      * parse_number: Parses a decimal, hexadecimal or binary number.
+      ********************************************************************************/
+      std::uint8_t parse_number(void)
+      {
+         unsigned base = 10;
+
+         if (source_[position_] == '0' && position_ + 1 < source_.size())
+         {
+            const auto prefix = std::tolower(static_cast<unsigned char>(source_[position_ + 1]));
+            if (prefix == 'x')      base = 16;
+            else if (prefix == 'b') base = 2;
+            if (base != 10) position_ += 2;
+         }
+
+         unsigned value = 0, digits = 0;
+
+         for (; position_ < source_.size(); ++position_, ++digits)
+         {
+            const auto c = std::tolower(static_cast<unsigned char>(source_[position_]));
+            unsigned digit = base;
+            if (c >= '0' && c <= '9')      digit = static_cast<unsigned>(c - '0');
+            else if (c >= 'a' && c <= 'f') digit = static_cast<unsigned>(c - 'a' + 10);
+            if (digit >= base) break;
+            value = value * base + digit;
+            if (value > 255) throw std::invalid_argument("Number out of range 0 - 255 in expression!");
+         }
+
+         if (!digits) throw std::invalid_argument("Invalid number in expression!");
+         return static_cast<std::uint8_t>(value);
+      }
+
+      /********************************************************************************
+      * simplify: Returns the operand equal to operation(a, b) if an identity
+      *           applies, e.g. x + 0 = x, otherwise false is returned.
+      ********************************************************************************/
+      static bool simplify(const std::uint8_t operation,
+                           const operand& a,
+                           const operand& b,
+                           operand& result)
+      {
+         const auto is = [](const operand& x, const std::uint8_t value)
+         {
+            return x.type == operand::kind::constant && x.value == value;
+         };
+
+         const auto constant = [](const std::uint8_t value)
+         {
+            operand x;
+            x.value = value;
+            return x;
+         };
+
+         switch (operation)
+         {
+         case OR:
+         {
+            if (is(a, 0x00) || a == b) result = b;
+            else if (is(b, 0x00))      result = a;
+            else if (is(a, 0xFF) || is(b, 0xFF)) result = constant(0xFF);
+            else return false;
+            return true;
+         }
+         case AND:
+         {
+            if (is(a, 0xFF) || a == b) result = b;
+            else if (is(b, 0xFF))      result = a;
+            else if (is(a, 0x00) || is(b, 0x00)) result = constant(0x00);
+            else return false;
+            return true;
+         }
+         case XOR: case ADD:
+         {
+            if (is(a, 0x00))                      result = b;
+            else if (is(b, 0x00))                 result = a;
+            else if (operation == XOR && a == b)  result = constant(0x00);
+            else return false;
+            return true;
+         }
+         default:
+         {
+            if (is(b, 0x00))  result = a;
+            else if (a == b)  result = constant(0x00);
+            else return false;
+            return true;
+         }
+         }
+      }
+
+      /********************************************************************************
+      * logic_constant: Returns true if specified simplified root is a constant
+      *                 result of OR, AND or XOR, whose flags only depend on
+      *                 the result (C and V are cleared) and are hence folded.
+      ********************************************************************************/
+      bool logic_constant(const std::uint8_t operation,
+                          const operand& result)
+      {
+         if (result.type != operand::kind::constant || operation == ADD || operation == SUB) return false;
+         folded_ = true;
+         flags_ = folded_flags(OR, result.value, result.value);
+         return true;
+      }
+
+      /********************************************************************************
+      * emit: Emits the instructions computing specified node and returns the
+      *       operand holding its value. Each node is emitted once. Operations
+      *       on constants are folded, and identities are removed except for
+      *       the root, whose status flags must be produced (unless they are
+      *       known, see logic_constant).
+      ********************************************************************************/
+      operand emit(const std::uint32_t index,
+                   const bool root)
+      {
+         const auto emitted = emitted_.find(index);
+         if (emitted != emitted_.end() && !root) return emitted->second;
+
+         const auto n = nodes_[index];
+         operand result;
+         result.type = n.type;
+         result.value = n.value;
+
+         if (n.type == operand::kind::variable)
+         {
+            result.index = n.value;
+            result.value = 0;
+         }
+         else if (n.type == operand::kind::temporary)
+         {
+            const auto a = emit(n.left, false);
+            const auto b = emit(nodes_[index].right, false);
+
+            if (a.type == operand::kind::constant && b.type == operand::kind::constant)
+            {
+               std::uint8_t sr = 0;
+               result.type = operand::kind::constant;
+               result.value = fold(n.operation, a.value, b.value, sr);
+               folded_ = root;
+               flags_ = sr;
+            }
+            else if (!simplify(n.operation, a, b, result) || (root && !logic_constant(n.operation, result)))
+            {
+               result.type = operand::kind::temporary;
+               result.index = static_cast<std::uint32_t>(program_.size());
+               result.value = 0;
+               program_.push_back(instruction{ n.operation, a, b });
+            }
+         }
+
+         emitted_[index] = result;
+         return result;
+      }
+
+      /********************************************************************************
+      * value: Returns the value of specified operand.
+      ********************************************************************************/
+      static std::uint8_t value(const operand& x,
+                                const std::uint8_t* bindings,
+                                const std::vector<std::uint8_t>& temporaries)
+      {
+         if (x.type == operand::kind::constant) return x.value;
+         if (x.type == operand::kind::variable) return bindings[x.index];
+         return temporaries[x.index];
+      }
+
+      /********************************************************************************
+      * column: Returns a pointer to the values of specified operand for the
+      *         elements of the current block. Constants are broadcast into
+      *         specified scratch storage.
+      ********************************************************************************/
+      static const std::uint8_t* column(const operand& x,
+                                        const std::uint8_t* const* bindings,
+                                        const std::vector<std::uint8_t>& temporaries,
+                                        std::vector<std::uint8_t>& scratch,
+                                        const std::size_t first,
+                                        const std::size_t count)
+      {
+         if (x.type == operand::kind::variable) return bindings[x.index] + first;
+         if (x.type == operand::kind::temporary) return &temporaries[x.index * block];
+         std::fill(scratch.begin(), scratch.begin() + count, x.value);
+         return scratch.data();
+      }
+
+      /********************************************************************************
+      * name: Returns the printable name of specified operand.
+      ********************************************************************************/
+      std::string name(const operand& x) const
+      {
+         if (x.type == operand::kind::constant) return std::to_string(x.value);
+         if (x.type == operand::kind::variable) return variables_[x.index];
+         return "t" + std::to_string(x.index);
+      }
+
+      using key = std::tuple<int, std::uint8_t, std::uint32_t, std::uint32_t, std::uint8_t>;
+
+      std::string source_;                         /* The source of the expression. */
+      std::size_t position_ = 0;                   /* Parse position in the source. */
+      std::vector<node> nodes_;                    /* Nodes of the AST (during compilation). */
+      std::map<key, std::uint32_t> shared_;        /* Index of each unique node. */
+      std::map<std::uint32_t, operand> emitted_;   /* Operand of each emitted node. */
+      std::vector<std::string> variables_;         /* Names of the variables. */
+      std::vector<instruction> program_;           /* The compiled program. */
+      operand result_;                             /* The operand holding the result. */
+      bool folded_ = false;                        /* Indicates a folded last operation. */
+      std::uint8_t flags_ = 0;                     /* Status flags of a folded last operation. */
+   };
+}
+
+#endif /* EXPR_HPP_ */
\ No newline at end of file
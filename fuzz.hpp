@@ -0,0 +1,666 @@
+/********************************************************************************
+* fuzz.hpp: Contains a differential fuzzer for the ALU backends listed in
+*           FUZZ_BACKENDS. A test is a sequence of up to max_steps operations
+*           run side by side in 64 lanes, each lane being a test case with its
+*           own operands and status register. The OP code is shared by the
+*           lanes of a step, so that the batch backend processes the step in
+*           one call and the netlists in one bit-parallel simulation. The
+*           first operand of a chained step is the result of the previous
+*           step in the same lane, and the status register of each lane is
+*           carried from step to step, so that the incoming carry flag of
+*           ROL, ROR and the unaffected status register of SWAP are tested.
+*
+*           Every test is run through all backends and the result and status
+*           register of every step and lane are compared with alu::calculate.
+*           Tests are either generated at random or mutated from a corpus of
+*           earlier tests. A test joins the corpus if its reference run
+*           reached a feature not seen before, a feature being an operation
+*           combined with the incoming carry flag and the outgoing SNZVC, with
+*           the classes of its operands (zero, small, 0x7F, 0x80, 0xFF, ...) or
+*           with the operation before it, so that generation is steered
+*           towards untested flag and operand combinations.
+*
+*           The first mismatch of a backend is minimized automatically: the
+*           failing lane is copied to all lanes, after which steps are removed,
+*           chained operands are replaced by their values and bits of the
+*           operands and status register are cleared as long as the backend
+*           still fails. Later mismatches of the same backend are skipped.
+********************************************************************************/
+#ifndef FUZZ_HPP_
+#define FUZZ_HPP_
+
+/* Include directives: */
+#include <vector>
+#include <random>
+#include <bitset>
+#include "alu.hpp"
+#include "table.hpp"
+#include "batch.hpp"
+#include "netlist.hpp"
+
+/********************************************************************************
+* FUZZ_BACKENDS: The ALU backends compared by the fuzzer. Each entry holds:
+*
+*                - name   : Name of the backend.
+*                - comment: Description of the backend.
+********************************************************************************/
+#define FUZZ_BACKENDS(X) \
+   X(scalar,    "alu::calculate, the reference.") \
+   X(table,     "Lookup tables, see table.hpp.") \
+   X(batch,     "Batch operations with SIMD, see batch.hpp.") \
+   X(ripple,    "Gate netlist with ripple-carry adder, see netlist.hpp.") \
+   X(lookahead, "Gate netlist with carry-lookahead adder, see netlist.hpp.")
+
+/********************************************************************************
+* fuzz: Namespace containing the differential fuzzer.
+********************************************************************************/
+namespace fuzz
+{
+   using namespace cpu; /* Brings all content of the cpu namespace into current scope. */
+
+   static constexpr std::size_t lanes = 64;        /* Test cases per test, one bit-parallel netlist word. */
+   static constexpr std::size_t max_steps = 16;    /* Maximum number of operations per test. */
+   static constexpr std::size_t op_count = 64;     /* OP codes covered by the feature map. */
+   static constexpr std::size_t feature_count = 3 * op_count * op_count; /* Bits of the feature map. */
+   static constexpr std::size_t max_corpus = 1024; /* Maximum number of tests in the corpus. */
+
+   /********************************************************************************
+   * backend: The ALU backends (generated from FUZZ_BACKENDS).
+   ********************************************************************************/
+   enum class backend
+   {
+#define FUZZ_ENUM(name, comment) name,
+      FUZZ_BACKENDS(FUZZ_ENUM)
+#undef FUZZ_ENUM
+   };
+
+   /********************************************************************************
+   * get_name: Returns the name of specified backend.
+   ********************************************************************************/
+   static const char* get_name(const backend which)
+   {
+      switch (which)
+      {
+#define FUZZ_NAME(name, comment) case backend::name: return #name;
+      FUZZ_BACKENDS(FUZZ_NAME)
+#undef FUZZ_NAME
+      default: return "";
+      }
+   }
+
+   /********************************************************************************
+   * supports: Returns true if specified backend implements specified operation.
+   *           The netlists only implement OR, AND, XOR, ADD and SUB; other
+   *           operations are calculated by alu::calculate in their place.
+   ********************************************************************************/
+   static bool supports(const backend which,
+                        const std::uint8_t operation)
+   {
+      if (which != backend::ripple && which != backend::lookahead) return true;
+      return operation == OR || operation == AND || operation == XOR || operation == ADD || operation == SUB;
+   }
+
+   /********************************************************************************
+   * step: One operation of a test.
+   *
+   *       - operation: OP code of the operation, shared by all lanes.
+   *       - chained  : True if the first operand is the result of the
+   *                    previous step (ignored for the first step).
+   *       - a        : First operand of each lane.
+   *       - b        : Second operand of each lane.
+   ********************************************************************************/
+   struct step
+   {
+      std::uint8_t operation = NOP;
+      bool chained = false;
+      std::uint8_t a[lanes]{};
+      std::uint8_t b[lanes]{};
+   };
+
+   /********************************************************************************
+   * test: A sequence of operations with the initial status register of each
+   *       lane.
+   ********************************************************************************/
+   struct test
+   {
+      std::vector<step> steps;
+      std::uint8_t sr[lanes]{};
+   };
+
+   /********************************************************************************
+   * trace: Result and status register after each step in each lane.
+   ********************************************************************************/
+   struct trace
+   {
+      std::uint8_t result[max_steps][lanes];
+      std::uint8_t sr[max_steps][lanes];
+   };
+
+   /********************************************************************************
+   * failure: A minimized test on which a backend differs from alu::calculate.
+   *
+   *          - which  : The failing backend.
+   *          - minimal: The minimized test, with the same values in all lanes.
+   *          - step   : The first step with a differing result or status
+   *                     register.
+   ********************************************************************************/
+   struct failure
+   {
+      backend which = backend::scalar;
+      test minimal;
+      std::size_t step = 0;
+   };
+
+   /********************************************************************************
+   * fuzzer: Generates tests, runs them through all backends and collects the
+   *         minimized failures, see the file header.
+   ********************************************************************************/
+   class fuzzer
+   {
+   public:
+
+      /********************************************************************************
+      * fuzzer: Creates a fuzzer with an empty corpus, generating the lookup
+      *         tables and netlists of the backends.
+      *
+      *         - seed: Seed of the random number generator (default = 1).
+      ********************************************************************************/
+      explicit fuzzer(const std::uint64_t seed = 1)
+         : random_{ seed }, tables_(op_count), ripple_{ gates::adder_type::ripple_carry },
+           lookahead_{ gates::adder_type::carry_lookahead }
+      {
+#define FUZZ_TABLE(name, code, symbol, form, comment) \
+         tables_[name] = table::generate(name); \
+         operations_.push_back(name);
+         CPU_ALU_INSTRUCTIONS(FUZZ_TABLE)
+#undef FUZZ_TABLE
+      }
+
+      /********************************************************************************
+      * run: Generates and runs specified number of tests.
+      ********************************************************************************/
+      void run(const std::uint64_t count)
+      {
+         trace expected, actual;
+
+         for (std::uint64_t i = 0; i < count; ++i)
+         {
+            const auto t = corpus_.empty() || random_() % 4 == 0 ? generate() : mutate(corpus_[random_() % corpus_.size()]);
+            execute(backend::scalar, t, expected);
+            if (record(t, expected)) add(t);
+
+#define FUZZ_CHECK(name, comment) \
+            if (backend::name != backend::scalar && !failed(backend::name)) \
+            { \
+               execute(backend::name, t, actual); \
+               std::size_t step = 0, lane = 0; \
+               if (differs(t, expected, actual, step, lane)) minimize(backend::name, t, lane); \
+            }
+            FUZZ_BACKENDS(FUZZ_CHECK)
+#undef FUZZ_CHECK
+
+            ++tests_;
+            operations_run_ += t.steps.size() * lanes;
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * execute: Runs specified test through specified backend and stores the
+      *          result and status register of every step and lane in out.
+      ********************************************************************************/
+      void execute(const backend which,
+                   const test& t,
+                   trace& out)
+      {
+         std::uint8_t a[lanes], sr[lanes];
+         std::copy(t.sr, t.sr + lanes, sr);
+
+         for (std::size_t s = 0; s < t.steps.size(); ++s)
+         {
+            const auto& st = t.steps[s];
+            const auto first = st.chained && s > 0 ? out.result[s - 1] : st.a;
+            std::copy(first, first + lanes, a);
+
+            if (which == backend::batch)
+            {
+               batch::calculate(st.operation, a, st.b, out.result[s], sr, lanes);
+            }
+            else if (which == backend::table)
+            {
+               for (std::size_t i = 0; i < lanes; ++i)
+               {
+                  out.result[s][i] = table::calculate(tables_[st.operation], a[i], st.b[i], sr[i]);
+               }
+            }
+            else if (which == backend::scalar || !supports(which, st.operation))
+            {
+               for (std::size_t i = 0; i < lanes; ++i)
+               {
+                  out.result[s][i] = alu::calculate(st.operation, a[i], st.b[i], sr[i]);
+               }
+            }
+            else
+            {
+               simulate(which == backend::ripple ? ripple_ : lookahead_, st.operation, a, st.b, out.result[s], sr);
+            }
+
+            std::copy(sr, sr + lanes, out.sr[s]);
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * tests: Returns the number of tests run.
+      ********************************************************************************/
+      std::uint64_t tests(void) const
+      {
+         return tests_;
+      }
+
+      /********************************************************************************
+      * operations: Returns the number of operations run per backend, i.e. the
+      *             sum of the steps times the lanes of all tests.
+      ********************************************************************************/
+      std::uint64_t operations(void) const
+      {
+         return operations_run_;
+      }
+
+      /********************************************************************************
+      * features: Returns the number of features reached.
+      ********************************************************************************/
+      std::size_t features(void) const
+      {
+         std::size_t count = 0;
+         for (const auto word : feature_map_) count += std::bitset<64>(word).count();
+         return count;
+      }
+
+      /********************************************************************************
+      * corpus_size: Returns the number of tests in the corpus.
+      ********************************************************************************/
+      std::size_t corpus_size(void) const
+      {
+         return corpus_.size();
+      }
+
+      /********************************************************************************
+      * failures: Returns the minimized failures, at most one per backend.
+      ********************************************************************************/
+      const std::vector<failure>& failures(void) const
+      {
+         return failures_;
+      }
+
+      /********************************************************************************
+      * print: Prints specified failure, one line per step with the operands,
+      *        the result and SNZVC of the backend and of alu::calculate.
+      *
+      *        - f      : The failure.
+      *        - ostream: Reference to output stream (default = std::cout).
+      ********************************************************************************/
+      void print(const failure& f,
+                 std::ostream& ostream = std::cout)
+      {
+         trace expected, actual;
+         execute(backend::scalar, f.minimal, expected);
+         execute(f.which, f.minimal, actual);
+
+         ostream << "Backend " << get_name(f.which) << " differs from alu::calculate at step " << f.step + 1
+            << ", initial SNZVC = " << std::bitset<5>(f.minimal.sr[0]) << ":\n";
+
+         for (std::size_t s = 0; s < f.minimal.steps.size(); ++s)
+         {
+            const auto& st = f.minimal.steps[s];
+            const auto a = st.chained && s > 0 ? expected.result[s - 1][0] : st.a[0];
+            ostream << "   " << get_instruction_name(st.operation) << " " << static_cast<int>(a) << ", "
+               << static_cast<int>(st.b[0]) << " = " << static_cast<int>(actual.result[s][0]) << ", SNZVC = "
+               << std::bitset<5>(actual.sr[s][0]) << " (expected " << static_cast<int>(expected.result[s][0])
+               << ", SNZVC = " << std::bitset<5>(expected.sr[s][0]) << ")\n";
+         }
+         return;
+      }
+
+   private:
+
+      /********************************************************************************
+      * simulate: Calculates one step of all lanes with specified netlist.
+      ********************************************************************************/
+      static void simulate(gates::netlist& netlist,
+                           const std::uint8_t operation,
+                           const std::uint8_t* a,
+                           const std::uint8_t* b,
+                           std::uint8_t* result,
+                           std::uint8_t* sr)
+      {
+         std::uint64_t inputs[gates::input_count] = {}, outputs[gates::output_count];
+
+         for (std::uint32_t i = 0; i < lanes; ++i)
+         {
+            gates::netlist::set_vector(inputs, i, a[i], b[i], operation);
+         }
+
+         netlist.simulate(inputs, outputs);
+
+         for (std::size_t i = 0; i < lanes; ++i)
+         {
+            std::uint8_t value = 0, flags = 0;
+            for (std::uint8_t bit = 0; bit < 8; ++bit) value |= ((outputs[bit] >> i) & 1) << bit;
+            for (std::uint8_t bit = 0; bit < 5; ++bit) flags |= ((outputs[8 + bit] >> i) & 1) << bit;
+            result[i] = value;
+            sr[i] = static_cast<std::uint8_t>((sr[i] & ~0x1F) | flags);
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * differs: Returns true if the traces of specified test differ, with the
+      *          first differing step and lane stored in step and lane.
+      ********************************************************************************/
+      static bool differs(const test& t,
+                          const trace& expected,
+                          const trace& actual,
+                          std::size_t& step,
+                          std::size_t& lane)
+      {
+         for (step = 0; step < t.steps.size(); ++step)
+         {
+            for (lane = 0; lane < lanes; ++lane)
+            {
+               if (expected.result[step][lane] != actual.result[step][lane] ||
+                   expected.sr[step][lane] != actual.sr[step][lane]) return true;
+            }
+         }
+         return false;
+      }
+
+      /********************************************************************************
+      * fails: Returns true if specified backend differs from alu::calculate on
+      *        specified test, with the first differing step stored in step.
+      ********************************************************************************/
+      bool fails(const backend which,
+                 const test& t,
+                 std::size_t& step)
+      {
+         trace expected, actual;
+         std::size_t lane = 0;
+         execute(backend::scalar, t, expected);
+         execute(which, t, actual);
+         return differs(t, expected, actual, step, lane);
+      }
+
+      /********************************************************************************
+      * failed: Returns true if a failure of specified backend was recorded.
+      ********************************************************************************/
+      bool failed(const backend which) const
+      {
+         for (const auto& f : failures_)
+         {
+            if (f.which == which) return true;
+         }
+         return false;
+      }
+
+      /********************************************************************************
+      * minimize: Minimizes the failing lane of specified test for specified
+      *           backend and records the failure, see the file header.
+      ********************************************************************************/
+      void minimize(const backend which,
+                    const test& t,
+                    const std::size_t lane)
+      {
+         failure f;
+         f.which = which;
+         f.minimal.steps = t.steps;
+         std::fill(f.minimal.sr, f.minimal.sr + lanes, t.sr[lane]);
+
+         for (auto& st : f.minimal.steps)
+         {
+            std::fill(st.a, st.a + lanes, st.a[lane]);
+            std::fill(st.b, st.b + lanes, st.b[lane]);
+         }
+
+         auto& m = f.minimal;
+         const auto accept = [&](const test& candidate)
+         {
+            std::size_t step = 0;
+            if (!fails(which, candidate, step)) return false;
+            m = candidate;
+            return true;
+         };
+
+         const auto simplify = [&](std::uint8_t* value, test& candidate)
+         {
+            auto changed = false;
+
+            for (int bit = 7; bit >= 0; --bit)
+            {
+               if (!read(*value, static_cast<std::uint8_t>(bit))) continue;
+               const auto old = *value;
+               std::fill(value, value + lanes, static_cast<std::uint8_t>(old & ~(1 << bit)));
+               if (accept(candidate)) changed = true;
+               else std::fill(value, value + lanes, old);
+            }
+            return changed;
+         };
+
+         for (auto changed = true; changed;)
+         {
+            changed = false;
+
+            for (auto s = m.steps.size(); s-- > 0 && m.steps.size() > 1;)
+            {
+               auto candidate = m;
+               candidate.steps.erase(candidate.steps.begin() + s);
+               if (accept(candidate)) changed = true;
+            }
+
+            for (std::size_t s = 1; s < m.steps.size(); ++s)
+            {
+               if (!m.steps[s].chained) continue;
+               trace expected;
+               execute(backend::scalar, m, expected);
+               auto candidate = m;
+               candidate.steps[s].chained = false;
+               std::fill(candidate.steps[s].a, candidate.steps[s].a + lanes, expected.result[s - 1][0]);
+               if (accept(candidate)) changed = true;
+            }
+
+            for (std::size_t s = 0; s < m.steps.size(); ++s)
+            {
+               auto candidate = m;
+               if (simplify(candidate.steps[s].a, candidate)) changed = true;
+               candidate = m;
+               if (simplify(candidate.steps[s].b, candidate)) changed = true;
+            }
+
+            auto candidate = m;
+            if (simplify(candidate.sr, candidate)) changed = true;
+         }
+
+         fails(which, m, f.step);
+         failures_.push_back(f);
+         return;
+      }
+
+      /********************************************************************************
+      * operand_class: Returns the class of specified operand for the feature
+      *                map (0 - 6).
+      ********************************************************************************/
+      static std::size_t operand_class(const std::uint8_t x)
+      {
+         return x == 0 ? 0 : x <= 8 ? 1 : x < 0x7F ? 2 : x == 0x7F ? 3 : x == 0x80 ? 4 : x < 0xFF ? 5 : 6;
+      }
+
+      /********************************************************************************
+      * mark: Sets the bit of specified feature and returns true if it was new.
+      ********************************************************************************/
+      bool mark(const std::size_t feature)
+      {
+         auto& word = feature_map_[feature / 64];
+         const auto old = word;
+         word |= 1ULL << (feature % 64);
+         return word != old;
+      }
+
+      /********************************************************************************
+      * record: Marks the features reached by specified reference trace of
+      *         specified test and returns true if any of them was new.
+      ********************************************************************************/
+      bool record(const test& t,
+                  const trace& expected)
+      {
+         auto found = false;
+
+         for (std::size_t s = 0; s < t.steps.size(); ++s)
+         {
+            const auto& st = t.steps[s];
+            const std::size_t op = st.operation % op_count;
+            if (s > 0) found |= mark(op_count * op_count + (t.steps[s - 1].operation % op_count) * op_count + op);
+
+            for (std::size_t i = 0; i < lanes; ++i)
+            {
+               const auto carry = (s > 0 ? expected.sr[s - 1][i] : t.sr[i]) & 1;
+               const auto a = st.chained && s > 0 ? expected.result[s - 1][i] : st.a[i];
+               found |= mark(op * op_count + (carry << 5) + (expected.sr[s][i] & 0x1F));
+               found |= mark(2 * op_count * op_count + op * op_count + operand_class(a) * 8 + operand_class(st.b[i]));
+            }
+         }
+         return found;
+      }
+
+      /********************************************************************************
+      * add: Adds specified test to the corpus, replacing a random test when the
+      *      corpus is full.
+      ********************************************************************************/
+      void add(const test& t)
+      {
+         if (corpus_.size() < max_corpus) corpus_.push_back(t);
+         else corpus_[random_() % max_corpus] = t;
+         return;
+      }
+
+      /********************************************************************************
+      * operand: Returns an operand drawn from specified 32 random bits, often an
+      *          edge value, and for the second operand of shifts often a step
+      *          count 0 - 9.
+      ********************************************************************************/
+      static std::uint8_t operand(const std::uint32_t r,
+                                  const bool steps)
+      {
+         static constexpr std::uint8_t edges[] = { 0x00, 0x01, 0x02, 0x07, 0x08, 0x0F, 0x10, 0x55,
+                                                   0x7F, 0x80, 0x81, 0xAA, 0xF0, 0xFE, 0xFF, 0x09 };
+         if (steps && r % 4 != 0) return static_cast<std::uint8_t>((r >> 8) % 10);
+         if (r % 4 == 0) return edges[(r >> 8) % 16];
+         return static_cast<std::uint8_t>(r >> 16);
+      }
+
+      /********************************************************************************
+      * randomize_lane: Gives specified lane of specified step random operands.
+      ********************************************************************************/
+      void randomize_lane(step& st,
+                          const std::size_t lane)
+      {
+         const auto r = random_();
+         st.a[lane] = operand(static_cast<std::uint32_t>(r), false);
+         st.b[lane] = operand(static_cast<std::uint32_t>(r >> 32), get_form(st.operation) == form::shift);
+         return;
+      }
+
+      /********************************************************************************
+      * randomize: Gives specified step a random operation and random operands.
+      ********************************************************************************/
+      void randomize(step& st)
+      {
+         st.operation = operations_[random_() % operations_.size()];
+         st.chained = random_() % 2 == 0;
+         for (std::size_t i = 0; i < lanes; ++i) randomize_lane(st, i);
+         return;
+      }
+
+      /********************************************************************************
+      * generate: Returns a random test of 1 - 8 steps.
+      ********************************************************************************/
+      test generate(void)
+      {
+         test t;
+         t.steps.resize(1 + random_() % 8);
+         for (auto& st : t.steps) randomize(st);
+         for (auto& sr : t.sr) sr = static_cast<std::uint8_t>(random_());
+         return t;
+      }
+
+      /********************************************************************************
+      * mutate: Returns a copy of specified test with one to four random
+      *         mutations: a new operation, a toggled chain, new or bit-flipped
+      *         operands in some lanes, an inserted or removed step, or new
+      *         status registers.
+      ********************************************************************************/
+      test mutate(const test& original)
+      {
+         auto t = original;
+
+         for (auto n = 1 + random_() % 4; n > 0; --n)
+         {
+            auto& st = t.steps[random_() % t.steps.size()];
+
+            switch (random_() % 7)
+            {
+            case 0: st.operation = operations_[random_() % operations_.size()]; break;
+            case 1: st.chained = !st.chained; break;
+            case 2:
+            {
+               for (std::size_t i = random_() % lanes; i < lanes; i += 1 + random_() % 8)
+               {
+                  randomize_lane(st, i);
+               }
+               break;
+            }
+            case 3:
+            {
+               for (std::size_t i = random_() % lanes; i < lanes; i += 1 + random_() % 8)
+               {
+                  (random_() % 2 ? st.a[i] : st.b[i]) ^= static_cast<std::uint8_t>(1 << random_() % 8);
+               }
+               break;
+            }
+            case 4:
+            {
+               if (t.steps.size() < max_steps)
+               {
+                  step inserted;
+                  randomize(inserted);
+                  t.steps.insert(t.steps.begin() + random_() % (t.steps.size() + 1), inserted);
+               }
+               break;
+            }
+            case 5:
+            {
+               if (t.steps.size() > 1) t.steps.erase(t.steps.begin() + random_() % t.steps.size());
+               break;
+            }
+            default:
+            {
+               for (auto& sr : t.sr) sr = static_cast<std::uint8_t>(random_());
+               break;
+            }
+            }
+         }
+         return t;
+      }
+
+      std::mt19937_64 random_;                      /* Random number generator. */
+      std::vector<table::lookup_table> tables_;     /* Lookup table per OP code. */
+      gates::netlist ripple_;                       /* Netlist with ripple-carry adder. */
+      gates::netlist lookahead_;                    /* Netlist with carry-lookahead adder. */
+      std::vector<std::uint8_t> operations_;        /* OP codes of the ALU operations. */
+      std::vector<test> corpus_;                    /* Tests that reached new features. */
+      std::vector<failure> failures_;               /* Minimized failures. */
+      std::uint64_t feature_map_[feature_count / 64] = {}; /* One bit per feature reached. */
+      std::uint64_t tests_ = 0;                     /* Number of tests run. */
+      std::uint64_t operations_run_ = 0;            /* Number of operations run per backend. */
+   };
+}
+
+#endif /* FUZZ_HPP_ */
\ No newline at end of file
@@ -0,0 +1,567 @@
+/********************************************************************************
+* gdb.hpp: Contains a stub for the GDB remote serial protocol, which lets a
+*          debugger control the CPU in emulator.hpp over a Unix domain socket,
+*          e.g. with target remote /tmp/cpu.sock. The registers are exposed in
+*          the order R0 - R31, SREG (SNZVC in bits 4 - 0 as computed by the
+*          ALU), SP (16 bits) and PC (32 bits), as for avr-gdb, where program
+*          addresses are instruction numbers. Data memory is read and written
+*          at 0x800000 - 0x80FFFF, where addresses are also taken modulo 64 KiB.
+*
+*          Supported packets are ?, g, G, p, P, m, M, c, s, Z0/z0 and Z1/z1
+*          (breakpoints), Z2/z2 (write watchpoints), qSupported, qAttached,
+*          QStartNoAckMode, H, D and k. Other packets get an empty reply.
+*
+*          Packets are received by a separate thread, which checks and
+*          acknowledges them and queues them for the thread running the CPU.
+*          While the CPU runs, it only checks for an interrupt (Ctrl-C) from
+*          the debugger once per 65 536 instructions, so that it runs at full
+*          speed between commands. Memory reads are encoded a page at a time
+*          directly from the data memory, and each reply is sent with a
+*          single write.
+*
+*          The stub uses POSIX sockets and isn't available on Windows.
+********************************************************************************/
+#ifndef GDB_HPP_
+#define GDB_HPP_
+
+#ifndef _WIN32
+
+/* Include directives: */
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdexcept>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "debugger.hpp"
+
+/********************************************************************************
+* gdb: Namespace containing the GDB remote serial protocol stub.
+********************************************************************************/
+namespace gdb
+{
+   using namespace emulator; /* Brings all content of the emulator namespace into current scope. */
+
+   static constexpr std::uint32_t data_offset = 0x800000; /* Address of data memory for the debugger. */
+   static constexpr std::uint64_t chunk = 65536;          /* Instructions executed between interrupt checks. */
+   static constexpr std::size_t packet_size = 0x4000;     /* Maximum packet size. */
+
+   /********************************************************************************
+   * hex_value: Returns the value of specified hexadecimal digit, or -1 if the
+   *            character isn't a hexadecimal digit.
+   ********************************************************************************/
+   static int hex_value(const char c)
+   {
+      if (c >= '0' && c <= '9') return c - '0';
+      if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+      if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+      return -1;
+   }
+
+   /********************************************************************************
+   * parse_hex: Parses a hexadecimal number and advances the position past it.
+   ********************************************************************************/
+   static std::uint32_t parse_hex(const char*& s)
+   {
+      std::uint32_t value = 0;
+      for (; hex_value(*s) >= 0; ++s) value = (value << 4) | static_cast<std::uint32_t>(hex_value(*s));
+      return value;
+   }
+
+   /********************************************************************************
+   * parse_byte: Parses two hexadecimal digits and advances the position past
+   *             them. Returns 0 for invalid digits.
+   ********************************************************************************/
+   static std::uint8_t parse_byte(const char*& s)
+   {
+      const auto high = hex_value(s[0]);
+      const auto low = high >= 0 ? hex_value(s[1]) : -1;
+      if (low < 0) return 0;
+      s += 2;
+      return static_cast<std::uint8_t>((high << 4) | low);
+   }
+
+   /********************************************************************************
+   * hex_digits: Returns true if s holds exactly specified number of hexadecimal
+   *             digits, which is checked before a payload is parsed with
+   *             parse_byte, so that short or invalid payloads aren't written.
+   ********************************************************************************/
+   static bool hex_digits(const char* s,
+                          const std::size_t count)
+   {
+      std::size_t n = 0;
+      for (; hex_value(s[n]) >= 0; ++n);
+      return n == count && s[n] == '\0';
+   }
+
+   /********************************************************************************
+   * append_hex: Appends specified bytes as pairs of hexadecimal digits.
+   ********************************************************************************/
+   static void append_hex(std::string& out,
+                          const std::uint8_t* bytes,
+                          const std::size_t count)
+   {
+      static constexpr char digits[] = "0123456789abcdef";
+      const auto size = out.size();
+      out.resize(size + 2 * count);
+      auto p = &out[size];
+
+      for (std::size_t i = 0; i < count; ++i)
+      {
+         *p++ = digits[bytes[i] >> 4];
+         *p++ = digits[bytes[i] & 0x0F];
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * append_value: Appends the lowest specified number of bytes of a value in
+   *               little endian order as hexadecimal digits.
+   ********************************************************************************/
+   static void append_value(std::string& out,
+                            std::uint32_t value,
+                            const std::size_t bytes)
+   {
+      std::uint8_t buffer[4];
+      for (std::size_t i = 0; i < bytes; ++i, value >>= 8) buffer[i] = static_cast<std::uint8_t>(value);
+      append_hex(out, buffer, bytes);
+      return;
+   }
+
+   /********************************************************************************
+   * read_memory: Appends the content of specified range of data memory as
+   *              hexadecimal digits, one page at a time. The I/O registers are
+   *              read byte by byte with machine::read, as by LD, so that the
+   *              timer registers are brought up to date first.
+   *
+   *              - m      : Reference to the machine.
+   *              - address: Data address of the first byte.
+   *              - count  : The number of bytes.
+   *              - out    : Reference to the string to append to.
+   ********************************************************************************/
+   static void read_memory(machine& m,
+                           std::uint32_t address,
+                           std::size_t count,
+                           std::string& out)
+   {
+      out.reserve(out.size() + 2 * count);
+
+      while (count)
+      {
+         address %= data_size;
+         const auto offset = address % page_size;
+         const auto n = std::min(count, page_size - offset);
+
+         if (address < io_size)
+         {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+               const auto byte = m.read(static_cast<std::uint16_t>(address + i));
+               append_hex(out, &byte, 1);
+            }
+         }
+         else
+         {
+            append_hex(out, m.page_data[address / page_size] + offset, n);
+         }
+         address += static_cast<std::uint32_t>(n);
+         count -= n;
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * stub: GDB remote serial protocol stub for a machine, listening on a Unix
+   *       domain socket.
+   ********************************************************************************/
+   class stub
+   {
+   public:
+
+      /********************************************************************************
+      * stub: Creates a stub for specified machine listening on specified socket
+      *       path. An existing socket file at the path is replaced.
+      ********************************************************************************/
+      stub(machine& m,
+           const std::string& path)
+         : machine_{ m }, session_{ m }, path_{ path }
+      {
+         sockaddr_un address{};
+         if (path.size() >= sizeof(address.sun_path)) throw std::invalid_argument("gdb: Socket path too long!");
+
+         address.sun_family = AF_UNIX;
+         std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+         ::unlink(path.c_str());
+         listener_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+         if (listener_ < 0 || ::bind(listener_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 ||
+             ::listen(listener_, 1) < 0)
+         {
+            if (listener_ >= 0) ::close(listener_);
+            throw std::runtime_error("gdb: Could not listen on " + path + "!");
+         }
+      }
+
+      stub(const stub&) = delete;
+      stub& operator=(const stub&) = delete;
+
+      ~stub(void)
+      {
+         ::close(listener_);
+         ::unlink(path_.c_str());
+      }
+
+      /********************************************************************************
+      * serve: Waits for a debugger to connect and handles its packets until it
+      *        detaches, kills the program or closes the connection.
+      ********************************************************************************/
+      void serve(void)
+      {
+         connection_ = ::accept(listener_, nullptr, nullptr);
+         if (connection_ < 0) throw std::runtime_error("gdb: Could not accept connection!");
+
+         closed_ = false;
+         ack_ = true;
+         interrupt_ = false;
+         reader_ = std::thread{ &stub::receive, this };
+         std::string packet;
+
+         while (next(packet) && handle(packet));
+
+         ::shutdown(connection_, SHUT_RDWR);
+         reader_.join();
+         ::close(connection_);
+         connection_ = -1;
+         packets_.clear();
+         session_.clear();
+         return;
+      }
+
+   private:
+
+      /********************************************************************************
+      * receive: Reads packets from the connection until it is closed. Packets
+      *          with valid checksum are acknowledged and queued, while packets
+      *          with an invalid checksum or checksum digit are rejected. An
+      *          interrupt byte (0x03) is signaled to the running CPU at once.
+      ********************************************************************************/
+      void receive(void)
+      {
+         char buffer[4096];
+         std::string packet;
+         std::uint8_t checksum = 0;
+         int received = -1; /* First checksum digit, -1 if invalid. */
+         int state = 0; /* 0 = between packets, 1 = payload, 2 and 3 = checksum digits. */
+         ssize_t n;
+
+         while ((n = ::read(connection_, buffer, sizeof(buffer))) > 0)
+         {
+            for (ssize_t i = 0; i < n; ++i)
+            {
+               const auto c = buffer[i];
+
+               if (state == 0)
+               {
+                  if (c == '$') packet.clear(), checksum = 0, state = 1;
+                  else if (c == 0x03) interrupt_ = true;
+               }
+               else if (state == 1)
+               {
+                  if (c == '#') state = 2;
+                  else packet += c, checksum = static_cast<std::uint8_t>(checksum + c);
+               }
+               else if (state == 2)
+               {
+                  received = hex_value(c);
+                  state = 3;
+               }
+               else
+               {
+                  const auto low = hex_value(c);
+                  const auto valid = received >= 0 && low >= 0 && ((received << 4) | low) == checksum;
+                  if (ack_) write(valid ? "+" : "-", 1);
+                  state = 0;
+
+                  if (valid)
+                  {
+                     std::lock_guard<std::mutex> lock{ mutex_ };
+                     packets_.push_back(packet);
+                     ready_.notify_one();
+                  }
+               }
+            }
+         }
+
+         std::lock_guard<std::mutex> lock{ mutex_ };
+         closed_ = true;
+         ready_.notify_one();
+         return;
+      }
+
+      /********************************************************************************
+      * next: Waits for the next packet. Returns false if the connection was
+      *       closed.
+      ********************************************************************************/
+      bool next(std::string& packet)
+      {
+         std::unique_lock<std::mutex> lock{ mutex_ };
+         ready_.wait(lock, [this]() { return !packets_.empty() || closed_; });
+         if (packets_.empty()) return false;
+         packet.swap(packets_.front());
+         packets_.pop_front();
+         return true;
+      }
+
+      /********************************************************************************
+      * write: Writes specified bytes to the connection.
+      ********************************************************************************/
+      void write(const char* data,
+                 std::size_t size)
+      {
+         std::lock_guard<std::mutex> lock{ write_mutex_ };
+
+         while (size)
+         {
+            const auto n = ::send(connection_, data, size, MSG_NOSIGNAL);
+            if (n <= 0) return;
+            data += n;
+            size -= static_cast<std::size_t>(n);
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * send: Sends specified payload as a packet.
+      ********************************************************************************/
+      void send(const std::string& payload)
+      {
+         static constexpr char digits[] = "0123456789abcdef";
+         std::uint8_t checksum = 0;
+         for (const auto c : payload) checksum = static_cast<std::uint8_t>(checksum + c);
+
+         frame_.assign(1, '$');
+         frame_ += payload;
+         frame_ += '#';
+         frame_ += digits[checksum >> 4];
+         frame_ += digits[checksum & 0x0F];
+         write(frame_.data(), frame_.size());
+         return;
+      }
+
+      /********************************************************************************
+      * stop_reply: Returns the reply describing why the CPU stopped.
+      ********************************************************************************/
+      std::string stop_reply(void) const
+      {
+         if (machine_.stopped == event::watchpoint)
+         {
+            std::string reply = "T05watch:";
+            const auto address = data_offset + machine_.event_address;
+            static constexpr char digits[] = "0123456789abcdef";
+            for (auto shift = 20; shift >= 0; shift -= 4) reply += digits[(address >> shift) & 0x0F];
+            return reply + ";";
+         }
+         if (machine_.halted && machine_.stopped == event::none) return "W00";
+         if (machine_.stopped == event::illegal) return "S04";
+         return "S05";
+      }
+
+      /********************************************************************************
+      * resume: Executes one instruction or continues until a breakpoint,
+      *         watchpoint, HALT or an interrupt. Returns the stop reply. An
+      *         interrupt received while the CPU was stopped is discarded.
+      ********************************************************************************/
+      std::string resume(const bool step)
+      {
+         interrupt_.store(false);
+
+         if (step)
+         {
+            session_.step();
+            return stop_reply();
+         }
+
+         while (session_.run(chunk) == event::none && !machine_.halted)
+         {
+            if (interrupt_.exchange(false)) return "S02";
+         }
+         return stop_reply();
+      }
+
+      /********************************************************************************
+      * read_register: Appends register n (see the file header) as hexadecimal
+      *                digits. Returns false for an unknown register.
+      ********************************************************************************/
+      bool read_register(const std::uint32_t n,
+                         std::string& out) const
+      {
+         if (n < 32)       append_value(out, machine_.r[n], 1);
+         else if (n == 32) append_value(out, machine_.sreg, 1);
+         else if (n == 33) append_value(out, machine_.sp, 2);
+         else if (n == 34) append_value(out, machine_.pc, 4);
+         else return false;
+         return true;
+      }
+
+      /********************************************************************************
+      * write_register: Sets register n (see the file header) from hexadecimal
+      *                 digits and advances the position past them.
+      ********************************************************************************/
+      void write_register(const std::uint32_t n,
+                          const char*& s)
+      {
+         if (n < 32)       machine_.r[n] = parse_byte(s);
+         else if (n == 32)
+         {
+            machine_.sreg = parse_byte(s);
+            machine_.schedule();
+         }
+         else if (n == 33)
+         {
+            const auto low = parse_byte(s);
+            machine_.sp = static_cast<std::uint16_t>(low | (parse_byte(s) << 8));
+         }
+         else if (n == 34)
+         {
+            std::uint32_t value = 0;
+            for (auto i = 0; i < 4; ++i) value |= static_cast<std::uint32_t>(parse_byte(s)) << (8 * i);
+            machine_.pc = static_cast<std::uint16_t>(value);
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * handle: Handles specified packet and sends the reply. Returns false if the
+      *         debugger detached or killed the program.
+      ********************************************************************************/
+      bool handle(const std::string& packet)
+      {
+         const auto starts_with = [&](const char* prefix) { return packet.compare(0, std::strlen(prefix), prefix) == 0; };
+         auto p = packet.c_str() + 1;
+         reply_.clear();
+
+         switch (packet.empty() ? '\0' : packet[0])
+         {
+         case '?':
+            reply_ = stop_reply();
+            break;
+         case 'g':
+            for (std::uint32_t n = 0; n <= 34; ++n) read_register(n, reply_);
+            break;
+         case 'G':
+            if (!hex_digits(p, 2 * (32 + 1 + 2 + 4))) { reply_ = "E01"; break; }
+            for (std::uint32_t n = 0; n <= 34; ++n) write_register(n, p);
+            reply_ = "OK";
+            break;
+         case 'p':
+            if (!read_register(parse_hex(p), reply_)) reply_ = "E01";
+            break;
+         case 'P':
+         {
+            const auto n = parse_hex(p);
+            if (*p++ != '=' || n > 34) reply_ = "E01";
+            else write_register(n, p), reply_ = "OK";
+            break;
+         }
+         case 'm':
+         {
+            const auto address = parse_hex(p);
+            const auto count = *p == ',' ? parse_hex(++p) : 0;
+            read_memory(machine_, address, std::min<std::size_t>(count, packet_size / 2), reply_);
+            break;
+         }
+         case 'M':
+         {
+            auto address = parse_hex(p);
+            auto count = *p == ',' ? parse_hex(++p) : 0;
+            if (*p++ != ':' || !hex_digits(p, 2 * static_cast<std::size_t>(count))) { reply_ = "E01"; break; }
+
+            const auto halted = machine_.halted;
+            const auto stopped = machine_.stopped;
+            for (; count; --count, ++address) machine_.write(static_cast<std::uint16_t>(address), parse_byte(p));
+            machine_.halted = halted;
+            machine_.stopped = stopped;
+            reply_ = "OK";
+            break;
+         }
+         case 'c': case 's':
+            if (hex_value(*p) >= 0) machine_.pc = static_cast<std::uint16_t>(parse_hex(p));
+            reply_ = resume(packet[0] == 's');
+            break;
+         case 'Z': case 'z':
+         {
+            const auto type = parse_hex(p);
+            const auto address = *p == ',' ? parse_hex(++p) : 0;
+            const auto kind = *p == ',' ? parse_hex(++p) : 1;
+            const auto set = packet[0] == 'Z';
+
+            if (type <= 1)
+            {
+               if (set) session_.set_breakpoint(static_cast<std::uint16_t>(address));
+               else     session_.clear_breakpoint(static_cast<std::uint16_t>(address));
+               reply_ = "OK";
+            }
+            else if (type == 2 && kind > 0)
+            {
+               const auto first = static_cast<std::uint16_t>(address);
+               const auto last = static_cast<std::uint16_t>(std::min<std::uint32_t>(first + kind - 1, data_size - 1));
+               if (set) session_.watch(first, last);
+               else     session_.unwatch(first, last);
+               reply_ = "OK";
+            }
+            break;
+         }
+         case 'q':
+            if (starts_with("qSupported"))    reply_ = "PacketSize=4000;QStartNoAckMode+";
+            else if (starts_with("qAttached")) reply_ = "1";
+            break;
+         case 'Q':
+            if (starts_with("QStartNoAckMode"))
+            {
+               ack_ = false;
+               send("OK");
+               return true;
+            }
+            break;
+         case 'H':
+            reply_ = "OK";
+            break;
+         case 'D':
+            send("OK");
+            return false;
+         case 'k':
+            return false;
+         default:
+            break;
+         }
+
+         send(reply_);
+         return true;
+      }
+
+      machine& machine_;                   /* The debugged machine. */
+      debugger::session session_;          /* Breakpoints and watchpoints set by the debugger. */
+      std::string path_;                   /* Path of the socket. */
+      int listener_ = -1;                  /* Listening socket. */
+      int connection_ = -1;                /* Connection to the debugger. */
+      std::thread reader_;                 /* Thread receiving packets. */
+      std::mutex mutex_;                   /* Protects packets_ and closed_. */
+      std::mutex write_mutex_;             /* Serializes writes to the connection. */
+      std::condition_variable ready_;      /* Signals a queued packet or a closed connection. */
+      std::deque<std::string> packets_;    /* Received packets. */
+      bool closed_ = false;                /* Indicates if the connection was closed. */
+      std::atomic<bool> ack_{ true };      /* Indicates if packets are acknowledged. */
+      std::atomic<bool> interrupt_{ false }; /* Indicates if the debugger sent an interrupt. */
+      std::string reply_;                  /* Reply to the current packet. */
+      std::string frame_;                  /* Reply framed as packet. */
+   };
+}
+
+#endif /* _WIN32 */
+
+#endif /* GDB_HPP_ */
\ No newline at end of file
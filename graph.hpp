@@ -0,0 +1,320 @@
+/********************************************************************************
+* graph.hpp: Contains a dataflow graph executor for ALU operations. Each node
+*            of the graph performs one operation via alu::calculate, with its
+*            operands and incoming status register taken from the results or
+*            status registers of other nodes (edges). Nodes can only refer to
+*            nodes added before them, so the graph is always acyclic.
+*
+*            Each node has a level, one more than the highest level of the
+*            nodes it depends on, so that nodes of the same level are
+*            independent and are executed in parallel for large levels.
+*
+*            Evaluation is incremental: when an input is changed, only the
+*            nodes downstream of it are recomputed, and propagation stops at
+*            nodes whose result and status register are unchanged. The time
+*            of a recalculation hence scales with the size of the change
+*            rather than with the size of the graph.
+********************************************************************************/
+#ifndef GRAPH_HPP_
+#define GRAPH_HPP_
+
+/* Include directives: */
+#include <vector>
+#include <future>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include "alu.hpp"
+
+/********************************************************************************
+* graph: Namespace containing the dataflow graph executor.
+********************************************************************************/
+namespace graph
+{
+   /********************************************************************************
+   * port: Refers to an output of a node, either its result or its status
+   *       register. A port with no node refers to the constant 0.
+   ********************************************************************************/
+   struct port
+   {
+      static constexpr std::uint32_t none = 0xFFFFFFFF;
+      std::uint32_t node = none;
+      bool flags = false;
+   };
+
+   /********************************************************************************
+   * result: Returns a port referring to the result of specified node.
+   ********************************************************************************/
+   static port result(const std::uint32_t node)
+   {
+      return port{ node, false };
+   }
+
+   /********************************************************************************
+   * flags: Returns a port referring to the status register of specified node.
+   ********************************************************************************/
+   static port flags(const std::uint32_t node)
+   {
+      return port{ node, true };
+   }
+
+   /********************************************************************************
+   * dataflow_graph: Graph of ALU operations with incremental evaluation.
+   ********************************************************************************/
+   class dataflow_graph
+   {
+   public:
+
+      /********************************************************************************
+      * dataflow_graph: Creates an empty graph.
+      *
+      *                 - threads           : The number of threads to use, where 0
+      *                                       selects the number of hardware threads.
+      *                 - parallel_threshold: The minimum number of dirty nodes in a
+      *                                       level for parallel execution.
+      ********************************************************************************/
+      explicit dataflow_graph(const std::size_t threads = 0,
+                              const std::size_t parallel_threshold = 4096)
+         : threads_{ threads ? threads : std::max<std::size_t>(1, std::thread::hardware_concurrency()) },
+           parallel_threshold_{ parallel_threshold } {}
+
+      /********************************************************************************
+      * input: Adds an input node holding specified value and returns its index.
+      *        The status register of an input node is always 0.
+      ********************************************************************************/
+      std::uint32_t input(const std::uint8_t value)
+      {
+         const auto index = add(node{ cpu::NOP, port{}, port{}, port{}, 0, true });
+         values_[index] = value;
+         return index;
+      }
+
+      /********************************************************************************
+      * operation: Adds a node performing specified operation and returns its index.
+      *
+      *            - operation: The operation to perform.
+      *            - a        : The port of the first operand.
+      *            - b        : The port of the second operand.
+      *            - sr       : The port of the incoming status register (default =
+      *                         none, i.e. all flags cleared).
+      ********************************************************************************/
+      std::uint32_t operation(const std::uint8_t operation,
+                              const port a,
+                              const port b,
+                              const port sr = port{})
+      {
+         std::uint32_t level = 0;
+
+         for (const auto& p : { a, b, sr })
+         {
+            if (p.node == port::none) continue;
+            if (p.node >= nodes_.size()) throw std::out_of_range("graph: port refers to a node not yet added");
+            level = std::max(level, nodes_[p.node].level + 1);
+         }
+
+         const auto index = add(node{ operation, a, b, sr, level, false });
+
+         for (const auto& p : { a, b, sr })
+         {
+            if (p.node == port::none) continue;
+            auto& consumers = consumers_[p.node];
+            if (consumers.empty() || consumers.back() != index) consumers.push_back(index);
+         }
+         return index;
+      }
+
+      /********************************************************************************
+      * set: Changes the value of specified input node. The downstream nodes are
+      *      recomputed by the next call to evaluate.
+      ********************************************************************************/
+      void set(const std::uint32_t input,
+               const std::uint8_t value)
+      {
+         if (!nodes_.at(input).input) throw std::invalid_argument("graph: node is not an input");
+         if (values_[input] == value) return;
+         values_[input] = value;
+         for (const auto c : consumers_[input]) mark(c);
+         return;
+      }
+
+      /********************************************************************************
+      * value: Returns the result of specified node.
+      ********************************************************************************/
+      std::uint8_t value(const std::uint32_t node) const
+      {
+         return values_.at(node);
+      }
+
+      /********************************************************************************
+      * status: Returns the status register of specified node.
+      ********************************************************************************/
+      std::uint8_t status(const std::uint32_t node) const
+      {
+         return status_.at(node);
+      }
+
+      /********************************************************************************
+      * size: Returns the number of nodes in the graph.
+      ********************************************************************************/
+      std::size_t size(void) const
+      {
+         return nodes_.size();
+      }
+
+      /********************************************************************************
+      * recomputed: Returns the number of nodes recomputed by the last evaluation.
+      ********************************************************************************/
+      std::size_t recomputed(void) const
+      {
+         return recomputed_;
+      }
+
+      /********************************************************************************
+      * invalidate: Marks every operation node as dirty, so that the next call
+      *             to evaluate recomputes the whole graph.
+      ********************************************************************************/
+      void invalidate(void)
+      {
+         for (std::uint32_t i = 0; i < nodes_.size(); ++i)
+         {
+            if (!nodes_[i].input) mark(i);
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * evaluate: Recomputes the dirty nodes level by level. The nodes of a level
+      *           are independent and are split between the threads if there
+      *           are at least parallel_threshold of them. The consumers of a
+      *           node are only marked as dirty if its outputs changed.
+      ********************************************************************************/
+      void evaluate(void)
+      {
+         recomputed_ = 0;
+
+         for (std::size_t level = 0; level < dirty_.size(); ++level)
+         {
+            auto& bucket = dirty_[level];
+            if (bucket.empty()) continue;
+            changed_.assign(bucket.size(), 0);
+
+            if (bucket.size() >= parallel_threshold_ && threads_ > 1)
+            {
+               std::vector<std::future<void>> tasks;
+               const auto chunk = (bucket.size() + threads_ - 1) / threads_;
+
+               for (std::size_t first = 0; first < bucket.size(); first += chunk)
+               {
+                  const auto last = std::min(first + chunk, bucket.size());
+                  tasks.push_back(std::async(std::launch::async, [this, &bucket, first, last]()
+                  {
+                     compute(bucket, first, last);
+                  }));
+               }
+               for (auto& task : tasks) task.get();
+            }
+            else
+            {
+               compute(bucket, 0, bucket.size());
+            }
+
+            for (std::size_t i = 0; i < bucket.size(); ++i)
+            {
+               dirty_flag_[bucket[i]] = 0;
+               if (!changed_[i]) continue;
+               for (const auto c : consumers_[bucket[i]]) mark(c);
+            }
+
+            recomputed_ += bucket.size();
+            bucket.clear();
+         }
+         return;
+      }
+
+   private:
+
+      /********************************************************************************
+      * node: A node of the graph.
+      ********************************************************************************/
+      struct node
+      {
+         std::uint8_t operation;
+         port a;
+         port b;
+         port sr;
+         std::uint32_t level;
+         bool input;
+      };
+
+      /********************************************************************************
+      * add: Appends specified node and marks it as dirty unless it's an input.
+      ********************************************************************************/
+      std::uint32_t add(const node& n)
+      {
+         const auto index = static_cast<std::uint32_t>(nodes_.size());
+         nodes_.push_back(n);
+         values_.push_back(0);
+         status_.push_back(0);
+         dirty_flag_.push_back(0);
+         consumers_.emplace_back();
+         if (!n.input) mark(index);
+         return index;
+      }
+
+      /********************************************************************************
+      * mark: Marks specified node as dirty, unless it already is.
+      ********************************************************************************/
+      void mark(const std::uint32_t index)
+      {
+         if (dirty_flag_[index]) return;
+         dirty_flag_[index] = 1;
+         const auto level = nodes_[index].level;
+         if (dirty_.size() <= level) dirty_.resize(level + 1);
+         dirty_[level].push_back(index);
+         return;
+      }
+
+      /********************************************************************************
+      * read: Returns the value of specified port.
+      ********************************************************************************/
+      std::uint8_t read(const port p) const
+      {
+         if (p.node == port::none) return 0;
+         return p.flags ? status_[p.node] : values_[p.node];
+      }
+
+      /********************************************************************************
+      * compute: Recomputes the nodes bucket[first] to bucket[last - 1] and
+      *          records which of them got new outputs.
+      ********************************************************************************/
+      void compute(const std::vector<std::uint32_t>& bucket,
+                   const std::size_t first,
+                   const std::size_t last)
+      {
+         for (auto i = first; i < last; ++i)
+         {
+            const auto index = bucket[i];
+            const auto& n = nodes_[index];
+            auto sr = read(n.sr);
+            const auto result = alu::calculate(n.operation, read(n.a), read(n.b), sr);
+            changed_[i] = result != values_[index] || sr != status_[index];
+            values_[index] = result;
+            status_[index] = sr;
+         }
+         return;
+      }
+
+      std::size_t threads_;                                /* Number of threads. */
+      std::size_t parallel_threshold_;                     /* Minimum level size for threads. */
+      std::size_t recomputed_ = 0;                         /* Nodes recomputed by last evaluation. */
+      std::vector<node> nodes_;                            /* Nodes in order of addition. */
+      std::vector<std::uint8_t> values_;                   /* Result of each node. */
+      std::vector<std::uint8_t> status_;                   /* Status register of each node. */
+      std::vector<std::uint8_t> dirty_flag_;               /* Indicates dirty nodes. */
+      std::vector<std::uint8_t> changed_;                  /* Changed outputs in current level. */
+      std::vector<std::vector<std::uint32_t>> consumers_;  /* Nodes depending on each node. */
+      std::vector<std::vector<std::uint32_t>> dirty_;      /* Dirty nodes per level. */
+   };
+}
+
+#endif /* GRAPH_HPP_ */
\ No newline at end of file
@@ -0,0 +1,300 @@
+/********************************************************************************
+* history.hpp: Contains reverse execution for the CPU in emulator.hpp. While
+*              the CPU runs forward, a recorder takes a snapshot of the state
+*              (see machine::save) every interval instructions. Stepping
+*              backward restores the nearest checkpoint before the target and
+*              executes forward again from there, which gives the exact state,
+*              since execution is deterministic.
+*
+*              Instructions are executed again one at a time with the handlers
+*              selected by the decoder (see emulator::make), not those in the
+*              program memory, so that breakpoints and watchpoints don't stop
+*              the replay, idle loops (see idle.hpp) aren't fast-forwarded
+*              past the target and the profiler and coverage don't count the
+*              instructions twice.
+*
+*              The number of checkpoints is bounded: when the limit is
+*              exceeded, every other checkpoint is dropped and the interval is
+*              doubled, up to a maximum interval. Once the maximum is reached,
+*              the oldest checkpoint is dropped instead, so that the recorder
+*              keeps a sliding window of the latest checkpoints. Memory use is
+*              hence bounded by the number of checkpoints and the number of
+*              instructions executed again per reverse step by the maximum
+*              interval, while states older than the window can no longer be
+*              reached (see recorder::earliest).
+********************************************************************************/
+#ifndef HISTORY_HPP_
+#define HISTORY_HPP_
+
+/* Include directives: */
+#include <algorithm>
+#include <cassert>
+#include "emulator.hpp"
+
+/********************************************************************************
+* history: Namespace containing the reverse execution.
+********************************************************************************/
+namespace history
+{
+   using namespace emulator; /* Brings all content of the emulator namespace into current scope. */
+
+   /********************************************************************************
+   * recorder: Runs a machine forward while taking checkpoints and steps it
+   *           backward by deterministic re-execution. The state of the machine
+   *           must only be changed through the recorder while recording.
+   ********************************************************************************/
+   class recorder
+   {
+   public:
+
+      /********************************************************************************
+      * recorder: Creates a recorder for specified machine, with the current
+      *           state as the earliest reachable state.
+      *
+      *           - m              : Reference to the machine.
+      *           - max_checkpoints: Maximum number of checkpoints (default = 64).
+      *           - interval       : Initial number of instructions between
+      *                              checkpoints (default = 1024).
+      *           - max_interval   : Maximum number of instructions between
+      *                              checkpoints (default = 65536).
+      ********************************************************************************/
+      explicit recorder(machine& m,
+                        const std::size_t max_checkpoints = 64,
+                        const std::uint64_t interval = 1024,
+                        const std::uint64_t max_interval = 65536)
+         : machine_{ m }, max_checkpoints_{ std::max<std::size_t>(2, max_checkpoints) },
+           interval_{ std::max<std::uint64_t>(1, interval) }, initial_interval_{ interval_ },
+           max_interval_{ std::max(interval_, max_interval) }, original_(m.program.size())
+      {
+         for (std::size_t address = 0; address < machine_.program.size(); ++address)
+         {
+            const auto& ins = machine_.program[address];
+            original_[address] = make(ins.op, ins.rd, ins.rr, ins.k).execute;
+         }
+
+         checkpoints_.reserve(max_checkpoints_ + 1);
+         checkpoints_.push_back(machine_.save());
+      }
+
+      /********************************************************************************
+      * step: Executes one instruction, unless the CPU is halted.
+      ********************************************************************************/
+      void step(void)
+      {
+         run(1);
+         return;
+      }
+
+      /********************************************************************************
+      * run: Executes instructions until HALT or until specified number of
+      *      instructions has been executed, taking checkpoints on the way. The
+      *      number of executed instructions is returned.
+      *
+      *      - limit: Maximum number of instructions (default = no limit).
+      ********************************************************************************/
+      std::uint64_t run(const std::uint64_t limit = ~0ULL)
+      {
+         std::uint64_t count = 0;
+
+         while (count < limit && !machine_.halted)
+         {
+            const auto next = checkpoints_.back().instructions + interval_;
+            count += machine_.run(std::min(limit - count, next - machine_.instructions));
+            if (machine_.instructions >= next) checkpoint();
+         }
+         return count;
+      }
+
+      /********************************************************************************
+      * reverse_step: Steps back specified number of instructions (default = 1).
+      *               Returns false if the earliest reachable state was reached
+      *               before.
+      ********************************************************************************/
+      bool reverse_step(const std::uint64_t count = 1)
+      {
+         const auto earliest = checkpoints_.front().instructions;
+         const auto position = machine_.instructions;
+         const auto available = position - earliest;
+         seek(count > available ? earliest : position - count);
+         return count <= available;
+      }
+
+      /********************************************************************************
+      * reverse_continue: Steps back to the latest earlier state for which
+      *                   specified predicate returns true, such as a breakpoint
+      *                   address or a status flag. Returns false if there is
+      *                   no such state, in which case the earliest reachable
+      *                   state is restored.
+      *
+      *                   - predicate: Function taking a reference to the
+      *                                machine, called for each earlier state.
+      ********************************************************************************/
+      template<class Predicate>
+      bool reverse_continue(Predicate&& predicate)
+      {
+         auto end = machine_.instructions;
+         auto index = segment(end - (end > checkpoints_.front().instructions));
+
+         while (end > checkpoints_.front().instructions)
+         {
+            const auto& start = checkpoints_[index];
+            auto found = end;
+            machine_.restore(start);
+
+            while (machine_.instructions < end && !machine_.halted)
+            {
+               if (predicate(static_cast<const machine&>(machine_))) found = machine_.instructions;
+               replay();
+            }
+
+            if (found != end)
+            {
+               seek(found);
+               return true;
+            }
+
+            end = start.instructions;
+            if (index-- == 0) break;
+         }
+
+         seek(checkpoints_.front().instructions);
+         return false;
+      }
+
+      /********************************************************************************
+      * seek: Restores the state after specified number of instructions, which
+      *       must not be later than the current state, by restoring the
+      *       nearest checkpoint and executing forward from there. Checkpoints
+      *       later than the restored state are dropped, and the interval is
+      *       halved again while at most a quarter of the checkpoints remain.
+      ********************************************************************************/
+      void seek(const std::uint64_t instructions)
+      {
+         const auto target = std::max(instructions, checkpoints_.front().instructions);
+         const auto index = segment(target);
+         checkpoints_.erase(checkpoints_.begin() + index + 1, checkpoints_.end());
+
+         while (interval_ > initial_interval_ && checkpoints_.size() * 4 <= max_checkpoints_)
+         {
+            interval_ /= 2;
+         }
+
+         machine_.restore(checkpoints_.back());
+         while (machine_.instructions < target && !machine_.halted) replay();
+         assert(machine_.instructions == target);
+         return;
+      }
+
+      /********************************************************************************
+      * earliest: Returns the instruction count of the earliest reachable state,
+      *           which is the state the recorder was created with until the
+      *           maximum interval is reached. From then on it moves forward
+      *           with each checkpoint taken, so that only about
+      *           max_checkpoints * max_interval instructions can be stepped
+      *           back from the latest checkpoint.
+      ********************************************************************************/
+      std::uint64_t earliest(void) const
+      {
+         return checkpoints_.front().instructions;
+      }
+
+      /********************************************************************************
+      * checkpoints: Returns the number of checkpoints held.
+      ********************************************************************************/
+      std::size_t checkpoints(void) const
+      {
+         return checkpoints_.size();
+      }
+
+      /********************************************************************************
+      * interval: Returns the current number of instructions between checkpoints.
+      ********************************************************************************/
+      std::uint64_t interval(void) const
+      {
+         return interval_;
+      }
+
+      /********************************************************************************
+      * replayed: Returns the number of instructions executed again by reverse
+      *           steps since the recorder was created.
+      ********************************************************************************/
+      std::uint64_t replayed(void) const
+      {
+         return replayed_;
+      }
+
+   private:
+
+      /********************************************************************************
+      * replay: Executes the next instruction again with its original handler.
+      *         A watchpoint hit during the replay doesn't stop the CPU.
+      ********************************************************************************/
+      void replay(void)
+      {
+         if (machine_.cycles >= machine_.next_event) machine_.interrupt();
+         const auto& ins = machine_.program[machine_.pc];
+         original_[machine_.pc](machine_, ins);
+         ++machine_.instructions;
+         ++replayed_;
+
+         if (machine_.stopped == event::watchpoint)
+         {
+            machine_.halted = false;
+            machine_.stopped = event::none;
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * segment: Returns the index of the latest checkpoint taken at or before
+      *          specified instruction count.
+      ********************************************************************************/
+      std::size_t segment(const std::uint64_t instructions) const
+      {
+         const auto later = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), instructions,
+            [](const std::uint64_t value, const snapshot& s) { return value < s.instructions; });
+         return static_cast<std::size_t>(later - checkpoints_.begin()) - (later != checkpoints_.begin());
+      }
+
+      /********************************************************************************
+      * checkpoint: Takes a checkpoint of the current state. If the maximum number
+      *             of checkpoints is exceeded, every other checkpoint is dropped,
+      *             keeping the earliest and the latest, and the interval is
+      *             doubled. Once the interval has reached its maximum, the
+      *             earliest checkpoint is dropped instead.
+      ********************************************************************************/
+      void checkpoint(void)
+      {
+         checkpoints_.push_back(machine_.save());
+         if (checkpoints_.size() <= max_checkpoints_) return;
+
+         if (interval_ * 2 > max_interval_)
+         {
+            checkpoints_.erase(checkpoints_.begin());
+            return;
+         }
+
+         std::size_t kept = 0;
+
+         for (std::size_t i = 0; i < checkpoints_.size(); ++i)
+         {
+            if (i % 2 == 0 || i + 1 == checkpoints_.size()) checkpoints_[kept++] = std::move(checkpoints_[i]);
+         }
+
+         checkpoints_.resize(kept);
+         interval_ *= 2;
+         return;
+      }
+
+      machine& machine_;                  /* The recorded machine. */
+      std::vector<snapshot> checkpoints_; /* Checkpoints ordered by instruction count. */
+      std::size_t max_checkpoints_;       /* Maximum number of checkpoints. */
+      std::uint64_t interval_;            /* Instructions between checkpoints. */
+      std::uint64_t initial_interval_;    /* Initial instructions between checkpoints. */
+      std::uint64_t max_interval_;        /* Maximum instructions between checkpoints. */
+      std::uint64_t replayed_ = 0;        /* Instructions executed again. */
+      std::vector<handler> original_;     /* Handler selected by the decoder per address. */
+   };
+}
+
+#endif /* HISTORY_HPP_ */
\ No newline at end of file
@@ -0,0 +1,184 @@
+/********************************************************************************
+* idle.hpp: Contains detection and fast-forwarding of idle loops, such as
+*           firmware polling TOV0 or TCNT0 of the timer (see timer.hpp):
+*
+*           wait:   LD R16, TIFR0
+*                   AND R16, 1
+*                   BREQ wait
+*
+*           An idle loop is a backward conditional branch whose body only
+*           holds instructions without side effects (ALU instructions, LDI,
+*           MOV, LD from a fixed address and NOP) and reads at least one timer
+*           register. The branches of such loops are found when the program
+*           is loaded and their handler is replaced, as for breakpoints (see
+*           debugger.hpp), so that other code isn't affected.
+*
+*           When the branch is taken, one more iteration is executed. If it
+*           leaves the registers and SREG unchanged, each further iteration
+*           does the same until a value read in the body changes. Since the
+*           body reads memory and timer registers at fixed cycles into the
+*           iteration, the number of identical iterations before the next
+*           timer tick or flag change that affects a read is computed, and
+*           the clock and instruction counters are advanced past them in one
+*           step. No iteration is skipped past the next interrupt (see
+*           machine::next_event), so that it is accepted at the same
+*           instruction, nor past machine::run_end, so that machine::run
+*           keeps to its limit. The result is exactly the same as when
+*           executing every iteration. The skipped cycles are added to
+*           machine::skipped.
+********************************************************************************/
+#ifndef IDLE_HPP_
+#define IDLE_HPP_
+
+/* Include directives: */
+#include "emulator.hpp"
+
+/********************************************************************************
+* idle: Namespace containing the idle loop detection.
+********************************************************************************/
+namespace idle
+{
+   using namespace emulator; /* Brings all content of the emulator namespace into current scope. */
+
+   static constexpr std::size_t max_body = 16; /* Maximum number of instructions in a loop body. */
+
+   /********************************************************************************
+   * is_pure: Returns true if specified handler executes an instruction that only
+   *          changes registers and SREG, and whose cycles are constant.
+   ********************************************************************************/
+   static bool is_pure(const handler h)
+   {
+      return h == execute_alu || h == execute_alu_immediate || h == execute_LDI ||
+             h == execute_MOV || h == execute_LD || h == execute_NOP;
+   }
+
+   /********************************************************************************
+   * next_change: Returns a cycle no later than the first cycle after specified
+   *              cycle at which a read from specified data address can return
+   *              another value, provided that the CPU doesn't write to memory.
+   ********************************************************************************/
+   static std::uint64_t next_change(const machine& m,
+                                    const std::uint16_t address,
+                                    const std::uint64_t cycle)
+   {
+      if (address < io_size && timer::is_register(address)) return m.timer0.next_change(address, cycle);
+      return timer::never;
+   }
+
+   /********************************************************************************
+   * fast_forward: Executes one iteration of the loop from head to the branch at
+   *               specified address and skips the following iterations that
+   *               are identical to it, see the file header.
+   ********************************************************************************/
+   static void fast_forward(machine& m,
+                            const std::uint16_t head,
+                            const std::uint16_t branch)
+   {
+      const auto r = m.r;
+      const auto sreg = m.sreg;
+      const auto start = m.cycles;
+      std::uint64_t reads[max_body][2]; /* Cycle of each read and of the next change of its value. */
+      std::size_t read_count = 0;
+      std::uint64_t executed = 0;
+      const auto remaining = m.run_end - m.instructions - 1; /* The branch itself is counted by the caller. */
+      if (m.next_event <= m.cycles + 2 * (branch - head + 1) || remaining < branch - head + 1u) return;
+
+      for (auto address = head; address < branch; ++address)
+      {
+         if (!is_pure(m.program[address].execute)) return;
+      }
+
+      for (auto address = head; address < branch; ++address)
+      {
+         const auto& ins = m.program[address];
+
+         if (ins.execute == execute_LD)
+         {
+            reads[read_count][0] = m.cycles;
+            reads[read_count++][1] = next_change(m, ins.k, m.cycles);
+         }
+
+         ins.execute(m, ins);
+         ++executed;
+      }
+
+      const auto& ins = m.program[branch];
+      const auto taken = read(m.sreg, ins.rd) == (ins.op == BRBS);
+      m.pc = taken ? head : static_cast<std::uint16_t>(branch + 1);
+      m.cycles += taken ? 2 : 1;
+      m.instructions += ++executed;
+      if (!taken || m.r != r || m.sreg != sreg) return;
+
+      const auto period = m.cycles - start;
+      auto skipped = timer::never;
+
+      for (std::size_t i = 0; i < read_count; ++i)
+      {
+         if (reads[i][1] != timer::never) skipped = std::min(skipped, (reads[i][1] - reads[i][0] - 1) / period);
+      }
+
+      if (m.next_event != timer::never) skipped = std::min(skipped, (m.next_event - m.cycles) / period);
+      if (skipped == timer::never) return;
+      skipped = std::min(skipped, (remaining - executed) / executed);
+      m.cycles += skipped * period;
+      m.instructions += skipped * executed;
+      m.skipped += skipped * period;
+      return;
+   }
+
+   /********************************************************************************
+   * execute_idle: Handler of the branch of an idle loop, which fast-forwards the
+   *               loop when the branch is taken.
+   ********************************************************************************/
+   static void execute_idle(machine& m, const instruction& ins)
+   {
+      const auto branch = m.pc;
+      const auto taken = read(m.sreg, ins.rd) == (ins.op == BRBS);
+      m.pc = taken ? ins.k : static_cast<std::uint16_t>(m.pc + 1);
+      m.cycles += taken ? 2 : 1;
+      if (taken) fast_forward(m, ins.k, branch);
+      return;
+   }
+
+   /********************************************************************************
+   * is_idle_loop: Returns true if the instruction at specified address is the
+   *               branch of an idle loop, see the file header.
+   ********************************************************************************/
+   static bool is_idle_loop(const machine& m,
+                            const std::size_t address)
+   {
+      const auto& branch = m.program[address];
+      if ((branch.op != BRBS && branch.op != BRBC) || branch.k > address || address - branch.k > max_body) return false;
+      auto polls = false;
+
+      for (std::size_t i = branch.k; i < address; ++i)
+      {
+         const auto& ins = m.program[i];
+         if (!is_pure(ins.execute)) return false;
+         if (ins.execute == execute_LD && ins.k < io_size && timer::is_register(ins.k)) polls = true;
+      }
+      return polls;
+   }
+
+   /********************************************************************************
+   * optimize: Replaces the handler of the branch of each idle loop in the
+   *           program of specified machine and returns the number of loops.
+   *           Must be called after machine::load.
+   ********************************************************************************/
+   static std::size_t optimize(machine& m)
+   {
+      std::size_t loops = 0;
+
+      for (std::size_t address = 0; address < m.program.size(); ++address)
+      {
+         if (is_idle_loop(m, address))
+         {
+            m.program[address].execute = execute_idle;
+            ++loops;
+         }
+      }
+      return loops;
+   }
+}
+
+#endif /* IDLE_HPP_ */
\ No newline at end of file
@@ -5,27 +5,156 @@
 *           user input commences.
 ********************************************************************************/
 #include "alu.hpp"
+#include "repl.hpp"
+#include "assembler.hpp"
+#include "disassembler.hpp"
+#include "gdb.hpp"
+#include "idle.hpp"
+#include "profiler.hpp"
+#include "coverage.hpp"
+#include "fuzz.hpp"
+#include <fstream>
+#include <sstream>
+#include "benchmark.hpp"
 
 using namespace cpu; /* Brings all content of the cpu namespace into current scope. */
 
 /********************************************************************************
 * main: Prints five examples of ALU calculations in the terminal. Then the
-*       user is able to perform ALU calculations by entering OP code and
-*       operands in the terminal. The program is running continuously.
+*       user is able to perform ALU calculations by entering commands such as
+*       ADD 100 50 in the terminal (see repl.hpp) until end of input or quit.
+*       If the program is started with the argument -q, the examples are
+*       skipped and only the result and SNZVC are printed per command.
+*       If the program is started with the argument --benchmark, the
+*       benchmarks are run instead. If the program is started with the
+*       arguments --run <file>, the assembly program in the file is assembled
+*       and executed until HALT, with idle loops fast-forwarded (see idle.hpp),
+*       after which the CPU state is printed. The arguments --trace <file>
+*       print one line per executed instruction instead, and --disassemble
+*       <file> prints the assembled program. The arguments --profile <file>
+*       <stacks> run the program like --run while profiling it (see
+*       profiler.hpp), print the instructions taking the most cycles and
+*       write the call stacks in collapsed stack format to the file stacks.
+*       The arguments --coverage <file> <report> run the program like --run
+*       while recording its coverage (see coverage.hpp) and write the
+*       instruction and branch coverage as lcov tracefile to the file report.
+*       The arguments --gdb <file> <socket> load the program and wait for a
+*       debugger to connect to the socket (not available on Windows).
+*       The arguments --fuzz <tests> run the differential fuzzer over the ALU
+*       backends (see fuzz.hpp) for the specified number of tests and print
+*       the minimized failures.
 ********************************************************************************/
-int main(void)
+int main(const int argc, const char** argv)
 {
-   std::cout << "Five examples of ALU calculations are printed below!\n\n";
-   alu::print(ADD, 100, 50);
-   alu::print(SUB, -100, 50);
-   alu::print(AND, 0x24, (1 << 5));
-   alu::print(OR, 0x20, (1 << 0));
-   alu::print(ADD, -5, 10);
-   
-   while (1)
+   if (argc > 1 && std::string(argv[1]) == "--benchmark")
    {
-      alu::calculate_by_input();
+      benchmark::run();
+      return 0;
    }
 
+   if (argc > 2 && std::string(argv[1]) == "--fuzz")
+   {
+      fuzz::fuzzer fuzzer;
+      fuzzer.run(std::stoull(argv[2]));
+      std::cout << fuzzer.tests() << " tests (" << fuzzer.operations() << " operations per backend), "
+         << fuzzer.features() << " features, " << fuzzer.failures().size() << " failures\n";
+      for (const auto& f : fuzzer.failures()) fuzzer.print(f);
+      return fuzzer.failures().empty() ? 0 : 1;
+   }
+
+   const auto command = argc > 2 ? std::string(argv[1]) : std::string{};
+
+   if (command == "--run" || command == "--trace" || command == "--disassemble" || command == "--gdb" ||
+       command == "--profile" || command == "--coverage")
+   {
+      std::ifstream file{ argv[2] };
+      std::stringstream source;
+      source << file.rdbuf();
+
+      if (!file)
+      {
+         std::cerr << "Could not open " << argv[2] << "!\n";
+         return 1;
+      }
+
+      try
+      {
+         const auto image = assembler::assemble(source.str());
+         disassembler::writer out{ std::cout };
+         emulator::machine machine;
+         machine.load(image);
+
+         if (command == "--gdb")
+         {
+#ifndef _WIN32
+            if (argc < 4) throw std::invalid_argument("Socket path missing!");
+            gdb::stub stub{ machine, argv[3] };
+            stub.serve();
+#else
+            throw std::invalid_argument("The GDB stub isn't available on Windows!");
+#endif
+         }
+         else if (command == "--disassemble")
+         {
+            disassembler::disassemble(image.program, 0, image.program.size(), out);
+         }
+         else if (command == "--trace")
+         {
+            disassembler::trace(machine, UINT64_MAX, out);
+         }
+         else if (command == "--profile")
+         {
+            if (argc < 4) throw std::invalid_argument("Stack file missing!");
+            std::ofstream stacks{ argv[3] };
+            if (!stacks) throw std::invalid_argument(std::string{ "Could not open " } + argv[3] + "!");
+
+            idle::optimize(machine);
+            profiler::profile profile{ machine };
+            machine.run();
+            emulator::print(machine);
+            profile.print();
+            profile.write_collapsed(stacks);
+         }
+         else if (command == "--coverage")
+         {
+            if (argc < 4) throw std::invalid_argument("Report file missing!");
+            std::ofstream report{ argv[3] };
+            if (!report) throw std::invalid_argument(std::string{ "Could not open " } + argv[3] + "!");
+
+            idle::optimize(machine);
+            coverage::tracker tracker{ machine };
+            machine.run();
+            emulator::print(machine);
+            coverage::write_lcov(report, tracker.map(), image, argv[2]);
+         }
+         else
+         {
+            idle::optimize(machine);
+            machine.run();
+            emulator::print(machine);
+         }
+      }
+      catch (std::exception& e)
+      {
+         std::cerr << e.what() << "\n";
+         return 1;
+      }
+      return 0;
+   }
+
+   const auto quiet = argc > 1 && std::string(argv[1]) == "-q";
+   std::ios::sync_with_stdio(false);
+
+   if (!quiet)
+   {
+      std::cout << "Five examples of ALU calculations are printed below!\n\n";
+      alu::print(ADD, 100, 50);
+      alu::print(SUB, -100, 50);
+      alu::print(AND, 0x24, (1 << 5));
+      alu::print(OR, 0x20, (1 << 0));
+      alu::print(ADD, -5, 10);
+   }
+
+   repl::run(quiet);
    return 0;
 }
\ No newline at end of file
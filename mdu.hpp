@@ -0,0 +1,166 @@
+/********************************************************************************
+* mdu.hpp: Contains function definitions for implementation of a multiply and
+*          divide unit (MDU) working alongside the ALU. Each operation produces
+*          a 16-bit result in register pair R1:R0 and updates the status bits
+*          as described below:
+*
+*          MUL, MULS, MULSU: 8 x 8 bit multiplication of unsigned, signed
+*                            or signed with unsigned operands. The carry flag
+*                            is set to bit 15 of the product and the zero flag
+*                            is set if the product is zero.
+*
+*          FMUL, FMULS, FMULSU: Fractional multiplication of operands in 1.7
+*                               format. The product is shifted one bit to the
+*                               left to give a 1.15 result. The carry flag is
+*                               set to bit 15 of the product before the shift
+*                               and the zero flag is set if the result is zero.
+*
+*          DIV, MOD: Unsigned 8 / 8 bit division. DIV places the quotient in R0
+*                    and the remainder in R1, while MOD places the remainder
+*                    in R0 and the quotient in R1. The zero flag is set if R0
+*                    is zero. The overflow flag is set on division by zero,
+*                    in which case the quotient is 255 and the remainder is
+*                    equal to the dividend. The divide unit is optional and
+*                    can be disabled in the configuration, in which case the
+*                    emulated CPU stops at DIV and MOD (see emulator.hpp).
+*
+*          The multiplications leave the S, N and V flags unaffected, just as
+*          the multiply instructions of ATmega328P. Each operation is emulated
+*          by a single host multiplication or division rather than by a loop
+*          of additions and shifts.
+********************************************************************************/
+#ifndef MDU_HPP_
+#define MDU_HPP_
+
+/* Include directives: */
+#include "cpu.hpp"
+
+/********************************************************************************
+* mdu: Namespace containing the multiply and divide unit.
+********************************************************************************/
+namespace mdu
+{
+   using namespace cpu; /* Brings all content of the cpu namespace into current scope. */
+
+   /********************************************************************************
+   * config: Configuration of the multiply and divide unit. The cycle cost of
+   *         each operation can be configured, the default values corresponds
+   *         to ATmega328P for the multiplications.
+   *
+   *         - multiply_cycles  : Cycles per MUL, MULS and MULSU (default = 2).
+   *         - fractional_cycles: Cycles per FMUL, FMULS and FMULSU (default = 2).
+   *         - divide_cycles    : Cycles per DIV and MOD (default = 9).
+   *         - divider          : Indicates if the divide unit is present.
+   ********************************************************************************/
+   struct config
+   {
+      std::uint8_t multiply_cycles = 2;
+      std::uint8_t fractional_cycles = 2;
+      std::uint8_t divide_cycles = 9;
+      bool divider = true;
+   };
+
+   /********************************************************************************
+   * available: Returns true if the specified operation is supported by the
+   *            multiply and divide unit with specified configuration.
+   *
+   *            - operation: The operation to check.
+   *            - settings : The configuration of the unit (default = config{}).
+   ********************************************************************************/
+   static bool available(const std::uint8_t operation,
+                         const config& settings = config{})
+   {
+      if (operation >= MUL && operation <= FMULSU) return true;
+      if (operation == DIV || operation == MOD)    return settings.divider;
+      return false;
+   }
+
+   /********************************************************************************
+   * cycles: Returns the number of cycles of specified operation, or 0 if the
+   *         operation isn't supported.
+   *
+   *         - operation: The operation to check.
+   *         - settings : The configuration of the unit (default = config{}).
+   ********************************************************************************/
+   static std::uint8_t cycles(const std::uint8_t operation,
+                              const config& settings = config{})
+   {
+      if (!available(operation, settings)) return 0;
+      if (operation <= MULSU)              return settings.multiply_cycles;
+      if (operation <= FMULSU)             return settings.fractional_cycles;
+      return settings.divide_cycles;
+   }
+
+   /********************************************************************************
+   * calculate: Performs specified multiply or divide operation and returns the
+   *            16-bit result, where the high byte corresponds to R1 and the
+   *            low byte to R0. The status flags of the referenced status
+   *            register are updated in accordance with the result. If the
+   *            operation isn't supported, 0 is returned and the status
+   *            register is left unchanged.
+   *
+   *            - operation: The operation to perform (MUL, MULS, MULSU, FMUL,
+   *                         FMULS, FMULSU, DIV or MOD).
+   *            - a        : First operand.
+   *            - b        : Second operand.
+   *            - sr       : Reference to status register containing SNZVC flags.
+   *            - settings : The configuration of the unit (default = config{}).
+   ********************************************************************************/
+   static std::uint16_t calculate(const std::uint8_t operation,
+                                  const std::uint8_t a,
+                                  const std::uint8_t b,
+                                  std::uint8_t& sr,
+                                  const config& settings = config{})
+   {
+      if (!available(operation, settings)) return 0;
+
+      const auto sa = static_cast<std::int8_t>(a);
+      const auto sb = static_cast<std::int8_t>(b);
+      std::uint16_t product = 0;
+
+      switch (operation)
+      {
+      case MUL: case FMUL:
+      {
+         product = static_cast<std::uint16_t>(a * b);
+         break;
+      }
+      case MULS: case FMULS:
+      {
+         product = static_cast<std::uint16_t>(sa * sb);
+         break;
+      }
+      case MULSU: case FMULSU:
+      {
+         product = static_cast<std::uint16_t>(sa * b);
+         break;
+      }
+      default:
+      {
+         sr &= ~((1 << Z) | (1 << V) | (1 << C));
+
+         if (b == 0)
+         {
+            set(sr, V);
+            const auto result = static_cast<std::uint16_t>(operation == DIV ? (a << 8) | 0xFF : 0xFF00 | a);
+            if (!static_cast<std::uint8_t>(result)) set(sr, Z);
+            return result;
+         }
+
+         const auto quotient = static_cast<std::uint8_t>(a / b);
+         const auto remainder = static_cast<std::uint8_t>(a % b);
+         const auto low = operation == DIV ? quotient : remainder;
+         if (low == 0) set(sr, Z);
+         return static_cast<std::uint16_t>(((operation == DIV ? remainder : quotient) << 8) | low);
+      }
+      }
+
+      sr &= ~((1 << Z) | (1 << C));
+      if (read(product, 15)) set(sr, C);
+      if (operation >= FMUL) product = static_cast<std::uint16_t>(product << 1);
+      if (product == 0)      set(sr, Z);
+      return product;
+   }
+}
+
+#endif /* MDU_HPP_ */
\ No newline at end of file
@@ -0,0 +1,528 @@
+/********************************************************************************
+* netlist.hpp: Contains a gate-level model of the ALU, built from two-input
+*              AND, OR and XOR gates and inverters. The netlist consists of:
+*
+*              - An operation decoder, selecting OR, AND, XOR, ADD or SUB from
+*                the three least significant bits of the OP code.
+*              - An 8-bit adder (ripple-carry or carry-lookahead), where the
+*                second operand is inverted and the carry in is set during
+*                subtraction, i.e. a - b is calculated as a + ~b + 1, which
+*                equals a + (256 - b) as in alu::calculate.
+*              - A logic unit calculating a | b, a & b and a ^ b.
+*              - A result multiplexer and the flag logic for SNZVC.
+*
+*              The netlist reproduces alu::calculate exactly for OP codes 0 - 7
+*              (OP codes other than OR, AND, XOR, ADD and SUB give result 0).
+*
+*              Two simulation modes are provided:
+*
+*              - Bit-parallel: Every signal is a 64-bit word holding the value
+*                for 64 test vectors, so each gate is evaluated for 64 vectors
+*                by one host instruction. An exhaustive sweep of all OP codes
+*                and operands (524 288 vectors) takes a few milliseconds.
+*              - Event-driven: Every gate has a propagation delay. A change of
+*                the inputs is propagated as timed events, which gives the
+*                settling time of the outputs and the number of transitions,
+*                including glitches, for statistics.
+********************************************************************************/
+#ifndef NETLIST_HPP_
+#define NETLIST_HPP_
+
+/* Include directives: */
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "alu.hpp"
+
+/********************************************************************************
+* gates: Namespace containing the gate-level model of the ALU.
+********************************************************************************/
+namespace gates
+{
+   /********************************************************************************
+   * gate_type: Types of the gates in the netlist.
+   ********************************************************************************/
+   enum class gate_type : std::uint8_t { input, not_gate, and_gate, or_gate, xor_gate };
+
+   /********************************************************************************
+   * adder_type: Types of 8-bit adders.
+   ********************************************************************************/
+   enum class adder_type { ripple_carry, carry_lookahead };
+
+   /********************************************************************************
+   * gate: A gate in the netlist with up to two inputs (indices of other gates).
+   ********************************************************************************/
+   struct gate
+   {
+      gate_type type;
+      std::uint32_t in0;
+      std::uint32_t in1;
+      std::uint8_t delay;
+   };
+
+   /********************************************************************************
+   * delays: Propagation delays of the gates in time units.
+   ********************************************************************************/
+   struct delays
+   {
+      std::uint8_t not_gate = 1;
+      std::uint8_t and_gate = 2;
+      std::uint8_t or_gate = 2;
+      std::uint8_t xor_gate = 3;
+   };
+
+   /********************************************************************************
+   * statistics: Propagation delay statistics of the event-driven simulation.
+   *
+   *             - transitions     : Number of simulated input transitions.
+   *             - events          : Total number of output changes of gates.
+   *             - glitches        : Changes beyond those needed to reach the
+   *                                 final value, i.e. hazards.
+   *             - total_settle    : Sum of the settling times.
+   *             - max_settle      : Longest settling time observed.
+   *             - critical_path   : Longest static path through the netlist.
+   ********************************************************************************/
+   struct statistics
+   {
+      std::size_t transitions = 0;
+      std::size_t events = 0;
+      std::size_t glitches = 0;
+      std::size_t total_settle = 0;
+      std::uint32_t max_settle = 0;
+      std::uint32_t critical_path = 0;
+
+      /********************************************************************************
+      * average_settle: Returns the average settling time per transition.
+      ********************************************************************************/
+      double average_settle(void) const
+      {
+         return transitions ? static_cast<double>(total_settle) / transitions : 0.0;
+      }
+   };
+
+   static constexpr std::size_t input_count = 19;  /* a[0:7], b[0:7], op[0:2]. */
+   static constexpr std::size_t output_count = 13; /* result[0:7], C, V, Z, N, S. */
+
+   /********************************************************************************
+   * netlist: Gate-level netlist of the ALU. Gates are stored in topological
+   *          order, the first 19 being the inputs a[0:7], b[0:7] and op[0:2].
+   ********************************************************************************/
+   class netlist
+   {
+   public:
+
+      /********************************************************************************
+      * netlist: Builds the netlist with specified adder and gate delays.
+      *
+      *          - adder : The type of adder (default = ripple-carry).
+      *          - timing: The gate delays (default = delays{}).
+      ********************************************************************************/
+      explicit netlist(const adder_type adder = adder_type::ripple_carry,
+                       const delays& timing = delays{})
+         : timing_{ timing }
+      {
+         for (std::uint32_t i = 0; i < input_count; ++i)
+         {
+            gates_.push_back(gate{ gate_type::input, 0, 0, 0 });
+         }
+
+         build(adder);
+         build_fanout();
+      }
+
+      /********************************************************************************
+      * size: Returns the number of gates, excluding the inputs.
+      ********************************************************************************/
+      std::size_t size(void) const
+      {
+         return gates_.size() - input_count;
+      }
+
+      /********************************************************************************
+      * critical_path: Returns the longest static path from an input to an
+      *                output in time units.
+      ********************************************************************************/
+      std::uint32_t critical_path(void) const
+      {
+         std::vector<std::uint32_t> arrival(gates_.size(), 0);
+
+         for (auto i = input_count; i < gates_.size(); ++i)
+         {
+            const auto& g = gates_[i];
+            const auto in1 = g.type == gate_type::not_gate ? 0 : arrival[g.in1];
+            arrival[i] = std::max(arrival[g.in0], in1) + g.delay;
+         }
+
+         std::uint32_t path = 0;
+         for (const auto o : outputs_) path = std::max(path, arrival[o]);
+         return path;
+      }
+
+      /********************************************************************************
+      * simulate: Evaluates the netlist bit-parallel for 64 test vectors.
+      *
+      *           - inputs : The 19 input words, bit k of each word belonging
+      *                      to test vector k.
+      *           - outputs: Storage for the 13 output words (result[0:7], C,
+      *                      V, Z, N, S).
+      ********************************************************************************/
+      void simulate(const std::uint64_t* inputs,
+                    std::uint64_t* outputs)
+      {
+         values_.resize(gates_.size());
+         std::copy(inputs, inputs + input_count, values_.begin());
+
+         for (auto i = input_count; i < gates_.size(); ++i)
+         {
+            const auto& g = gates_[i];
+            const auto x = values_[g.in0], y = values_[g.in1];
+
+            switch (g.type)
+            {
+            case gate_type::not_gate: values_[i] = ~x;    break;
+            case gate_type::and_gate: values_[i] = x & y; break;
+            case gate_type::or_gate:  values_[i] = x | y; break;
+            case gate_type::xor_gate: values_[i] = x ^ y; break;
+            default: break;
+            }
+         }
+
+         for (std::size_t i = 0; i < output_count; ++i)
+         {
+            outputs[i] = values_[outputs_[i]];
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * sweep: Simulates every combination of OP code (0 - 7) and operands
+      *        bit-parallel and compares with alu::calculate. The number of
+      *        mismatching test vectors is returned.
+      ********************************************************************************/
+      std::size_t sweep(void)
+      {
+         std::size_t mismatches = 0;
+         std::uint64_t inputs[input_count], outputs[output_count];
+
+         for (std::uint32_t base = 0; base < (8u << 16); base += 64)
+         {
+            std::fill(inputs, inputs + input_count, 0);
+            std::uint64_t expected[output_count] = {};
+
+            for (std::uint32_t k = 0; k < 64; ++k)
+            {
+               const auto vector = base + k;
+               const auto a = static_cast<std::uint8_t>(vector);
+               const auto b = static_cast<std::uint8_t>(vector >> 8);
+               const auto op = static_cast<std::uint8_t>(vector >> 16);
+               set_vector(inputs, k, a, b, op);
+
+               std::uint8_t sr = 0x00;
+               const auto result = alu::calculate(op, a, b, sr);
+               for (std::uint8_t i = 0; i < 8; ++i) expected[i] |= static_cast<std::uint64_t>(cpu::read(result, i)) << k;
+               for (std::uint8_t i = 0; i < 5; ++i) expected[8 + i] |= static_cast<std::uint64_t>(cpu::read(sr, i)) << k;
+            }
+
+            simulate(inputs, outputs);
+            std::uint64_t differing = 0;
+            for (std::size_t i = 0; i < output_count; ++i) differing |= outputs[i] ^ expected[i];
+            mismatches += bitops::popcount(static_cast<std::uint32_t>(differing)) +
+                          bitops::popcount(static_cast<std::uint32_t>(differing >> 32));
+         }
+         return mismatches;
+      }
+
+      /********************************************************************************
+      * transition: Simulates a change of the inputs from one test vector to
+      *             another event by event and adds the result to specified
+      *             statistics. The netlist is first settled at the old inputs.
+      *
+      *             - from : The old input vector (bit i = input i).
+      *             - to   : The new input vector (bit i = input i).
+      *             - stats: Reference to the statistics to update.
+      ********************************************************************************/
+      void transition(const std::uint32_t from,
+                      const std::uint32_t to,
+                      statistics& stats)
+      {
+         std::uint64_t inputs[input_count], outputs[output_count];
+         for (std::size_t i = 0; i < input_count; ++i) inputs[i] = (from >> i) & 1 ? ~0ULL : 0;
+         simulate(inputs, outputs);
+
+         std::vector<std::uint8_t> state(gates_.size());
+         std::vector<std::uint32_t> changes(gates_.size(), 0);
+         for (std::size_t i = 0; i < gates_.size(); ++i) state[i] = values_[i] & 1;
+         const auto initial = state;
+
+         std::vector<std::vector<std::pair<std::uint32_t, std::uint8_t>>> wheel;
+         std::uint32_t now = 0, settle = 0;
+
+         const auto schedule = [&](const std::uint32_t g, const std::uint32_t time)
+         {
+            if (wheel.size() <= time) wheel.resize(time + 1);
+            wheel[time].push_back(std::make_pair(g, evaluate(g, state)));
+         };
+
+         for (std::uint32_t i = 0; i < input_count; ++i)
+         {
+            const auto value = static_cast<std::uint8_t>((to >> i) & 1);
+            if (value == state[i]) continue;
+            state[i] = value;
+            for (const auto f : fanout_[i]) schedule(f, gates_[f].delay);
+         }
+
+         for (now = 0; now < wheel.size(); ++now)
+         {
+            for (std::size_t e = 0; e < wheel[now].size(); ++e)
+            {
+               const auto g = wheel[now][e].first;
+               const auto value = wheel[now][e].second;
+               if (state[g] == value) continue;
+
+               state[g] = value;
+               changes[g]++;
+               stats.events++;
+               settle = now;
+
+               for (const auto f : fanout_[g]) schedule(f, now + gates_[f].delay);
+            }
+         }
+
+         for (auto i = input_count; i < gates_.size(); ++i)
+         {
+            stats.glitches += changes[i] - (state[i] != initial[i] ? 1 : 0);
+         }
+
+         stats.transitions++;
+         stats.total_settle += settle;
+         stats.max_settle = std::max(stats.max_settle, settle);
+         stats.critical_path = critical_path();
+         return;
+      }
+
+      /********************************************************************************
+      * measure_delays: Returns propagation delay statistics over specified
+      *                 number of random input transitions.
+      *
+      *                 - count: The number of transitions.
+      *                 - seed : Seed of the random number generator (default = 1).
+      ********************************************************************************/
+      statistics measure_delays(const std::size_t count,
+                                const std::uint32_t seed = 1)
+      {
+         statistics stats;
+         std::mt19937 generator{ seed };
+         auto from = random_vector(generator);
+
+         for (std::size_t i = 0; i < count; ++i)
+         {
+            const auto to = random_vector(generator);
+            transition(from, to, stats);
+            from = to;
+         }
+         return stats;
+      }
+
+      /********************************************************************************
+      * set_vector: Sets the inputs of test vector k in specified input words.
+      ********************************************************************************/
+      static void set_vector(std::uint64_t* inputs,
+                             const std::uint32_t k,
+                             const std::uint8_t a,
+                             const std::uint8_t b,
+                             const std::uint8_t op)
+      {
+         for (std::uint8_t i = 0; i < 8; ++i)
+         {
+            inputs[i] |= static_cast<std::uint64_t>(cpu::read(a, i)) << k;
+            inputs[8 + i] |= static_cast<std::uint64_t>(cpu::read(b, i)) << k;
+         }
+
+         for (std::uint8_t i = 0; i < 3; ++i)
+         {
+            inputs[16 + i] |= static_cast<std::uint64_t>(cpu::read(op, i)) << k;
+         }
+         return;
+      }
+
+   private:
+
+      /********************************************************************************
+      * random_vector: Returns a random input vector with a valid OP code
+      *                (OR, AND, XOR, ADD or SUB).
+      ********************************************************************************/
+      static std::uint32_t random_vector(std::mt19937& generator)
+      {
+         const auto operands = generator() & 0xFFFF;
+         const auto op = 1 + generator() % 5;
+         return operands | (op << 16);
+      }
+
+      /********************************************************************************
+      * evaluate: Returns the output of gate g for specified signal values.
+      ********************************************************************************/
+      std::uint8_t evaluate(const std::uint32_t g,
+                            const std::vector<std::uint8_t>& state) const
+      {
+         const auto& gt = gates_[g];
+         const auto x = state[gt.in0], y = state[gt.in1];
+
+         switch (gt.type)
+         {
+         case gate_type::not_gate: return static_cast<std::uint8_t>(!x);
+         case gate_type::and_gate: return static_cast<std::uint8_t>(x & y);
+         case gate_type::or_gate:  return static_cast<std::uint8_t>(x | y);
+         case gate_type::xor_gate: return static_cast<std::uint8_t>(x ^ y);
+         default:                  return state[g];
+         }
+      }
+
+      /********************************************************************************
+      * add: Appends a gate of specified type and returns its index. The helpers
+      *      inv, and2, or2 and xor2 append gates of the corresponding type.
+      ********************************************************************************/
+      std::uint32_t add(const gate_type type, const std::uint32_t in0, const std::uint32_t in1)
+      {
+         std::uint8_t delay = timing_.not_gate;
+         if (type == gate_type::and_gate)      delay = timing_.and_gate;
+         else if (type == gate_type::or_gate)  delay = timing_.or_gate;
+         else if (type == gate_type::xor_gate) delay = timing_.xor_gate;
+         gates_.push_back(gate{ type, in0, in1, delay });
+         return static_cast<std::uint32_t>(gates_.size() - 1);
+      }
+
+      std::uint32_t inv(const std::uint32_t x) { return add(gate_type::not_gate, x, x); }
+      std::uint32_t and2(const std::uint32_t x, const std::uint32_t y) { return add(gate_type::and_gate, x, y); }
+      std::uint32_t or2(const std::uint32_t x, const std::uint32_t y) { return add(gate_type::or_gate, x, y); }
+      std::uint32_t xor2(const std::uint32_t x, const std::uint32_t y) { return add(gate_type::xor_gate, x, y); }
+
+      /********************************************************************************
+      * tree: Combines specified signals with a balanced tree of gates.
+      ********************************************************************************/
+      std::uint32_t tree(const gate_type type,
+                         std::vector<std::uint32_t> signals)
+      {
+         while (signals.size() > 1)
+         {
+            std::vector<std::uint32_t> next;
+
+            for (std::size_t i = 0; i + 1 < signals.size(); i += 2)
+            {
+               next.push_back(add(type, signals[i], signals[i + 1]));
+            }
+
+            if (signals.size() % 2) next.push_back(signals.back());
+            signals.swap(next);
+         }
+         return signals[0];
+      }
+
+      /********************************************************************************
+      * build: Builds the decoder, adder, logic unit, multiplexer and flag logic.
+      ********************************************************************************/
+      void build(const adder_type adder)
+      {
+         const auto a = [](const std::uint32_t i) { return i; };
+         const auto b = [](const std::uint32_t i) { return 8 + i; };
+         const std::uint32_t op0 = 16, op1 = 17, op2 = 18;
+
+         /* Decoder: OR = 001, AND = 010, XOR = 011, ADD = 100, SUB = 101. */
+         const auto n0 = inv(op0), n1 = inv(op1), n2 = inv(op2);
+         const auto is_or = and2(and2(n2, n1), op0);
+         const auto is_and = and2(and2(n2, op1), n0);
+         const auto is_xor = and2(and2(n2, op1), op0);
+         const auto is_add = and2(and2(op2, n1), n0);
+         const auto is_sub = and2(and2(op2, n1), op0);
+         const auto is_arith = or2(is_add, is_sub);
+
+         /* Adder: a + (b ^ sub) + sub. */
+         std::vector<std::uint32_t> p(8), g(8), carry(9), sum(8);
+         carry[0] = is_sub;
+
+         for (std::uint32_t i = 0; i < 8; ++i)
+         {
+            const auto bi = xor2(b(i), is_sub);
+            p[i] = xor2(a(i), bi);
+            g[i] = and2(a(i), bi);
+         }
+
+         for (std::uint32_t i = 0; i < 8; ++i)
+         {
+            if (adder == adder_type::ripple_carry)
+            {
+               carry[i + 1] = or2(g[i], and2(p[i], carry[i]));
+            }
+            else
+            {
+               std::vector<std::uint32_t> terms{ g[i] };
+
+               for (std::uint32_t j = i + 1; j-- > 0;)
+               {
+                  std::vector<std::uint32_t> product(p.begin() + j, p.begin() + i + 1);
+                  product.push_back(j == 0 ? carry[0] : g[j - 1]);
+                  terms.push_back(tree(gate_type::and_gate, product));
+               }
+               carry[i + 1] = tree(gate_type::or_gate, terms);
+            }
+            sum[i] = xor2(p[i], carry[i]);
+         }
+
+         /* Logic unit and result multiplexer. */
+         std::vector<std::uint32_t> result(8);
+
+         for (std::uint32_t i = 0; i < 8; ++i)
+         {
+            const auto r_or = and2(is_or, or2(a(i), b(i)));
+            const auto r_and = and2(is_and, and2(a(i), b(i)));
+            const auto r_xor = and2(is_xor, xor2(a(i), b(i)));
+            const auto r_sum = and2(is_arith, sum[i]);
+            result[i] = or2(or2(r_or, r_and), or2(r_xor, r_sum));
+         }
+
+         /* Flags. The overflow during subtraction is based on the sign of the
+            negated second operand, whose bit 7 is ~b[7] ^ (b[6:0] == 0). */
+         const auto c = and2(is_arith, carry[8]);
+         const auto v_add = and2(inv(xor2(a(7), b(7))), xor2(a(7), result[7]));
+         std::vector<std::uint32_t> low_bits;
+         for (std::uint32_t i = 0; i < 7; ++i) low_bits.push_back(b(i));
+         const auto negated_b7 = xor2(inv(b(7)), inv(tree(gate_type::or_gate, low_bits)));
+         const auto v_sub = and2(inv(xor2(a(7), negated_b7)), xor2(a(7), result[7]));
+         const auto v = or2(and2(is_add, v_add), and2(is_sub, v_sub));
+         const auto n = result[7];
+         const auto z = inv(tree(gate_type::or_gate, result));
+         const auto s = xor2(n, v);
+
+         outputs_ = result;
+         outputs_.push_back(c);
+         outputs_.push_back(v);
+         outputs_.push_back(z);
+         outputs_.push_back(n);
+         outputs_.push_back(s);
+         return;
+      }
+
+      /********************************************************************************
+      * build_fanout: Builds the list of gates driven by each signal.
+      ********************************************************************************/
+      void build_fanout(void)
+      {
+         fanout_.assign(gates_.size(), std::vector<std::uint32_t>{});
+
+         for (auto i = input_count; i < gates_.size(); ++i)
+         {
+            const auto& g = gates_[i];
+            fanout_[g.in0].push_back(static_cast<std::uint32_t>(i));
+            if (g.type != gate_type::not_gate && g.in1 != g.in0) fanout_[g.in1].push_back(static_cast<std::uint32_t>(i));
+         }
+         return;
+      }
+
+      delays timing_;                                   /* Gate delays. */
+      std::vector<gate> gates_;                         /* Gates in topological order. */
+      std::vector<std::uint32_t> outputs_;              /* Output signals. */
+      std::vector<std::vector<std::uint32_t>> fanout_;  /* Gates driven by each signal. */
+      std::vector<std::uint64_t> values_;               /* Bit-parallel signal values. */
+   };
+}
+
+#endif /* NETLIST_HPP_ */
\ No newline at end of file
@@ -0,0 +1,721 @@
+/********************************************************************************
+* profiler.hpp: Contains a counting profiler for programs of the CPU in
+*               emulator.hpp. It records the executions and cycles of each
+*               instruction and the cycles spent in each emulated call stack,
+*               which are exported in the collapsed stack format read by flame
+*               graph tools, one stack per line with the addresses of the
+*               called functions and the cycles:
+*
+*               0x0000;0x0040;0x0052 1200
+*
+*               As for breakpoints (see debugger.hpp), handlers of the
+*               pre-decoded instructions are replaced, so that nothing is
+*               added to the execution loop and most instructions run
+*               unchanged:
+*
+*               - The first instruction of each basic block counts the entries
+*                 of the block, which gives the executions of all instructions
+*                 in the block. Blocks start at address 0, at the interrupt
+*                 vectors, at the targets of jumps, calls and branches, and
+*                 after each jump, return, branch and HALT. A call doesn't end
+*                 its block, as the instructions after it are executed once
+*                 per call when the function returns.
+*               - Instructions whose cycles vary (multiply and divide, SLEEP
+*                 and patched handlers, e.g. of idle loops) add the cycles they
+*                 take. The cycles of the other instructions are their
+*                 executions times their fixed cycles.
+*               - A branch takes 2 cycles when taken and 1 otherwise. If the
+*                 block after it is only entered from the branch, its entries
+*                 are the branches not taken, so the cycles of the branch are
+*                 derived from the entries. Other branches add their cycles.
+*               - CALL and accepted interrupts enter a frame of the call stack,
+*                 named by the address of the function or vector, RET and RETI
+*                 leave it. A vector only enters a frame if machine::interrupts
+*                 changed since, so that ordinary code at the vector addresses
+*                 enters none.
+*                 The cycles since the last change of the stack are charged to
+*                 the stack when it changes.
+*
+*               The first instruction of a block without other instrumentation
+*               gets a handler shared by all blocks, which counts the entry and
+*               calls the original handler. The handlers of the other common
+*               kinds of instrumentation are generated per kind and original
+*               handler, so that they only do what their instruction requires,
+*               without looking the kind up.
+*               The overhead depends on the share of instrumented instructions,
+*               as each adds a counter update. The call stack is only tracked
+*               in stacks mode (see profiler::mode), where calls and returns
+*               also change it and every block counts its entries. In counting
+*               mode, CALL and RET run unchanged, all cycles are charged to the
+*               root of the call stack, and the entries of a block are derived
+*               from other counts where the control flow allows it (see
+*               profile::derive), e.g. those of a function from the blocks
+*               calling it and those after a loop from the entries of the loop.
+*               This assumes that blocks are only entered through the jumps,
+*               calls and returns of the program, not by setting the program
+*               counter, and a derived block is counted once the block it is
+*               derived from is entered. The budget of counting mode is 5 %,
+*               which benchmark::profiling checks with the minimum of many runs
+*               of a loop and of short functions called in a loop.
+*
+*               Interrupts are accepted between instructions, so the cycles
+*               of accepting them are charged to the interrupted stack, but
+*               not to an instruction. Iterations of idle loops skipped by
+*               fast-forwarding (see idle.hpp) are only counted as cycles of
+*               the branch. When a run stops inside a block, the rest of the
+*               block is already counted.
+********************************************************************************/
+#ifndef PROFILER_HPP_
+#define PROFILER_HPP_
+
+/* Include directives: */
+#include <algorithm>
+#include "disassembler.hpp"
+
+/********************************************************************************
+* profiler: Namespace containing the profiler.
+********************************************************************************/
+namespace profiler
+{
+   using namespace emulator; /* Brings all content of the emulator namespace into current scope. */
+
+   /********************************************************************************
+   * mode: Modes of the profiler:
+   *
+   *       - counting: Executions and cycles per instruction only.
+   *       - stacks  : Also the cycles per call stack, changed by every CALL,
+   *                   RET, RETI and accepted interrupt.
+   ********************************************************************************/
+   enum class mode { counting, stacks };
+
+   /********************************************************************************
+   * fixed_cycles: Returns the cycles of specified instruction, provided that
+   *               they don't vary (see is_variable).
+   ********************************************************************************/
+   static std::uint64_t fixed_cycles(const std::uint8_t op)
+   {
+      switch (op)
+      {
+      case LD: case LDX: case ST: case STX: case PUSH: case POP: return 2;
+      case JMP:                                                   return 3;
+      case CALL: case RET: case RETI:                             return 4;
+      case HALT:                                                  return 0;
+      default:                                                    return 1;
+      }
+   }
+
+   /********************************************************************************
+   * is_variable: Returns true if the cycles of specified instruction vary, or
+   *              if its handler was replaced. Branches are handled by
+   *              find_blocks.
+   ********************************************************************************/
+   static bool is_variable(const instruction& ins)
+   {
+      return ins.op == SLEEP || (ins.op != NOP && is_wide(ins.op)) ||
+             ins.execute != make(ins.op, ins.rd, ins.rr, ins.k).execute;
+   }
+
+   /********************************************************************************
+   * profile: Profile of a machine, recorded while the profile exists. The
+   *          handlers are replaced in the loaded program, so the profile must
+   *          be created after machine::load and breakpoints must be set before
+   *          or after it exists. Only one profile per machine can exist.
+   ********************************************************************************/
+   class profile
+   {
+   public:
+
+      /********************************************************************************
+      * profile: Instruments the program of specified machine and starts the
+      *          profile with the current state, at the root of the call stack.
+      *
+      *          - m     : Reference to the machine.
+      *          - record: Mode of the profiler (default = mode::stacks).
+      ********************************************************************************/
+      explicit profile(machine& m,
+                       const mode record = mode::stacks)
+         : machine_{ m }, original_(m.program.size()), kinds_(m.program.size()), entries_(m.program.size()),
+           cycles_(m.program.size()), block_(m.program.size()), charged_{ m.cycles }, interrupts_{ m.interrupts }
+      {
+         if (machine_.instrumentation) throw std::invalid_argument("profiler: Machine is already profiled!");
+         nodes_.push_back(node{ 0, 0, 0, 0, 0 });
+         find_blocks(record);
+
+         for (std::size_t address = 0; address < machine_.program.size(); ++address)
+         {
+            auto& ins = machine_.program[address];
+            const auto kind = static_cast<std::uint8_t>(kinds_[address] & ~derived);
+            original_[address] = ins.execute;
+            if (kind) ins.execute = instrument(kind, ins.execute);
+         }
+         machine_.instrumentation = this;
+      }
+
+      profile(const profile&) = delete;
+      profile& operator=(const profile&) = delete;
+
+      /********************************************************************************
+      * ~profile: Restores the original handlers.
+      ********************************************************************************/
+      ~profile(void)
+      {
+         for (std::size_t address = 0; address < machine_.program.size(); ++address)
+         {
+            if (kinds_[address]) machine_.program[address].execute = original_[address];
+         }
+         machine_.instrumentation = nullptr;
+      }
+
+      /********************************************************************************
+      * executions: Returns the number of executions of the instruction at
+      *             specified program address.
+      ********************************************************************************/
+      std::uint64_t executions(const std::uint16_t address) const
+      {
+         return entries(block_[address]);
+      }
+
+      /********************************************************************************
+      * cycles: Returns the cycles taken by the instruction at specified program
+      *         address.
+      ********************************************************************************/
+      std::uint64_t cycles(const std::uint16_t address) const
+      {
+         const auto op = machine_.program[address].op;
+         if (kinds_[address] & variable) return cycles_[address];
+         if (op == BRBS || op == BRBC) return 2 * executions(address) - entries(static_cast<std::uint16_t>(address + 1));
+         return executions(address) * fixed_cycles(op);
+      }
+
+      /********************************************************************************
+      * write_collapsed: Writes the cycles of each call stack in collapsed stack
+      *                  format, see the file header.
+      *
+      *                  - ostream: Reference to output stream.
+      ********************************************************************************/
+      void write_collapsed(std::ostream& ostream)
+      {
+         disassembler::writer out{ ostream };
+         std::vector<std::uint16_t> path;
+         charge();
+
+         for (const auto& n : nodes_)
+         {
+            if (!n.cycles) continue;
+            path.clear();
+            for (auto i = static_cast<std::uint32_t>(&n - nodes_.data()); i; i = nodes_[i].parent) path.push_back(nodes_[i].function);
+
+            out.hex(0, 4);
+            for (auto i = path.rbegin(); i != path.rend(); ++i) out.put(';').hex(*i, 4);
+            out.put(' ').decimal(n.cycles).put('\n');
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * print: Prints the instructions taking the most cycles, with their
+      *        executions, cycles and share of the cycles of all instructions.
+      *
+      *        - ostream: Reference to output stream (default = std::cout).
+      *        - count  : Maximum number of instructions (default = 10).
+      ********************************************************************************/
+      void print(std::ostream& ostream = std::cout,
+                 const std::size_t count = 10) const
+      {
+         std::vector<std::uint16_t> addresses;
+         std::uint64_t total = 0;
+
+         for (std::size_t address = 0; address < machine_.program.size(); ++address)
+         {
+            const auto c = cycles(static_cast<std::uint16_t>(address));
+            if (!c) continue;
+            addresses.push_back(static_cast<std::uint16_t>(address));
+            total += c;
+         }
+
+         const auto shown = std::min(count, addresses.size());
+         std::partial_sort(addresses.begin(), addresses.begin() + shown, addresses.end(),
+            [&](const std::uint16_t a, const std::uint16_t b) { return cycles(a) > cycles(b); });
+
+         disassembler::writer out{ ostream };
+         out.write("--------------------------------------------------------------------------------\n");
+         out.write("Address     Executions          Cycles  Share  Instruction\n");
+
+         for (std::size_t i = 0; i < shown; ++i)
+         {
+            const auto address = addresses[i];
+            const auto permille = cycles(address) * 1000 / total;
+            out.hex(address, 4).decimal(executions(address), 15).decimal(cycles(address), 16)
+               .decimal(permille / 10, 5).put('.').decimal(permille % 10).write(" %  ");
+            disassembler::disassemble(machine_.program[address], out);
+            out.put('\n');
+         }
+
+         out.write("--------------------------------------------------------------------------------\n\n");
+         return;
+      }
+
+   private:
+
+      /********************************************************************************
+      * Kinds of instrumented instructions (bits of kinds_):
+      ********************************************************************************/
+      static constexpr std::uint8_t leader = 1;   /* First instruction of a block. */
+      static constexpr std::uint8_t variable = 2; /* Cycles are measured. */
+      static constexpr std::uint8_t call = 4;     /* CALL, enters a frame. */
+      static constexpr std::uint8_t leave = 8;    /* RET or RETI, leaves the frame. */
+      static constexpr std::uint8_t vector = 16;  /* Interrupt vector, enters a frame if accepted. */
+      static constexpr std::uint8_t derived = 32; /* First instruction of a block with derived entries. */
+
+      /********************************************************************************
+      * source: Instruction whose executions are entries of a block with derived
+      *         entries, see derive.
+      *
+      *         - block: First address of the block.
+      *         - site : Address of the instruction.
+      ********************************************************************************/
+      struct source
+      {
+         std::uint16_t block;
+         std::uint16_t site;
+      };
+
+      /********************************************************************************
+      * node: Frame of the call stack tree.
+      *
+      *       - function: Address of the called function or vector.
+      *       - parent  : Index of the calling frame (0 = root).
+      *       - child   : Index of the first frame called from this frame (0 = none).
+      *       - sibling : Index of the next frame with the same parent (0 = none).
+      *       - cycles  : Cycles charged to the stack ending in this frame.
+      ********************************************************************************/
+      struct node
+      {
+         std::uint16_t function;
+         std::uint32_t parent;
+         std::uint32_t child;
+         std::uint32_t sibling;
+         std::uint64_t cycles;
+      };
+
+      /********************************************************************************
+      * find_blocks: Marks the first instruction of each block and the
+      *              instructions with variable cycles or changing the call
+      *              stack, and assigns each address to its block. The cycles
+      *              of a branch are only measured if the block after it is
+      *              entered otherwise as well, see the file header. In
+      *              counting mode, the call stack isn't changed and entries
+      *              are derived where possible, see derive.
+      ********************************************************************************/
+      void find_blocks(const mode record)
+      {
+         const auto& program = machine_.program;
+         std::vector<bool> targets(program.size());
+         std::vector<std::uint32_t> lowest(program.size(), ~0U), highest(program.size(), 0);
+         std::vector<source> calls;
+         const auto mark = [&](const std::size_t address, const std::uint8_t kind)
+         {
+            if (address < program.size()) kinds_[address] |= kind;
+            return;
+         };
+         const auto target = [&](const std::size_t address, const std::uint8_t kind)
+         {
+            mark(address, kind);
+            if (address < program.size()) targets[address] = true;
+            return;
+         };
+
+         target(0, leader);
+         target(timer::TIMER0_COMPA_vect, leader | vector);
+         target(timer::TIMER0_COMPB_vect, leader | vector);
+         target(timer::TIMER0_OVF_vect, leader | vector);
+
+         for (std::size_t address = 0; address < program.size(); ++address)
+         {
+            const auto& ins = program[address];
+            if (is_variable(ins)) mark(address, variable);
+
+            switch (ins.op)
+            {
+            case BRBS: case BRBC: case JMP:
+               target(ins.k, leader);
+               mark(address + 1, leader);
+
+               if (ins.k < program.size())
+               {
+                  lowest[ins.k] = std::min<std::uint32_t>(lowest[ins.k], static_cast<std::uint32_t>(address));
+                  highest[ins.k] = std::max<std::uint32_t>(highest[ins.k], static_cast<std::uint32_t>(address));
+               }
+               break;
+            case CALL:
+               mark(address, call);
+               target(ins.k, leader);
+               if (ins.k < program.size()) calls.push_back(source{ ins.k, static_cast<std::uint16_t>(address) });
+               break;
+            case RET: case RETI:
+               mark(address, leave);
+               mark(address + 1, leader);
+               break;
+            case HALT:
+               mark(address + 1, leader);
+               break;
+            default:
+               break;
+            }
+         }
+
+         for (std::size_t address = 0; address < program.size(); ++address)
+         {
+            const auto op = program[address].op;
+            if ((op == BRBS || op == BRBC) && (address + 1 == program.size() || targets[address + 1])) mark(address, variable);
+         }
+
+         if (record == mode::counting)
+         {
+            for (auto& kind : kinds_) kind &= static_cast<std::uint8_t>(~(call | leave | vector));
+            derive(lowest, highest, calls);
+         }
+
+         std::uint16_t first = 0;
+
+         for (std::size_t address = 0; address < program.size(); ++address)
+         {
+            if (kinds_[address] & (leader | derived)) first = static_cast<std::uint16_t>(address);
+            block_[address] = first;
+         }
+
+         std::vector<std::uint8_t> state(program.size());
+         for (const auto& s : sources_) resolve(s.block, state);
+         return;
+      }
+
+      /********************************************************************************
+      * derive: Selects the blocks whose entries are derived from the executions
+      *         of other instructions, so that they need no counter. Execution
+      *         is assumed to enter blocks only through the program's own
+      *         jumps, branches, calls and returns:
+      *
+      *         - A block not entered by a jump, branch or from the instruction
+      *           before it is entered once per execution of the calls to it,
+      *           or never if there are none.
+      *         - The block after a loop ending in a backward branch, entered
+      *           only from the branch, is entered once per entry of the loop,
+      *           provided that the loop is only left by the branch and entered
+      *           from the instruction before it.
+      *         - The block a forward branch jumps to is entered once per
+      *           execution of the branch, provided that the instructions in
+      *           between are only left towards the block.
+      *
+      *         - lowest : Lowest address jumping or branching to each address.
+      *         - highest: Highest address jumping or branching to each address.
+      *         - calls  : Target (as block) and address of each CALL.
+      ********************************************************************************/
+      void derive(const std::vector<std::uint32_t>& lowest,
+                  const std::vector<std::uint32_t>& highest,
+                  std::vector<source> calls)
+      {
+         const auto& program = machine_.program;
+         const auto by_block = [](const source& a, const source& b) { return a.block < b.block; };
+         std::vector<bool> called(program.size());
+         for (const auto& c : calls) called[c.block] = true;
+         std::sort(calls.begin(), calls.end(), by_block);
+
+         const auto external = [](const std::size_t address)
+         {
+            return address == 0 || address == timer::TIMER0_COMPA_vect || address == timer::TIMER0_COMPB_vect ||
+                   address == timer::TIMER0_OVF_vect;
+         };
+         const auto entry = [&](const std::size_t address)
+         {
+            return external(address) || called[address];
+         };
+         const auto ends = [&](const std::size_t address)
+         {
+            const auto op = program[address].op;
+            return op == JMP || op == RET || op == RETI || op == HALT;
+         };
+         const auto is_branch = [&](const std::size_t address)
+         {
+            return program[address].op == BRBS || program[address].op == BRBC;
+         };
+         const auto closed = [&](const std::size_t first, const std::size_t last, const std::size_t exit)
+         {
+            for (auto address = first; address <= last; ++address)
+            {
+               const auto& ins = program[address];
+               if (entry(address) || ins.op == RET || ins.op == RETI || ins.op == HALT) return false;
+               if (lowest[address] != ~0U && (lowest[address] < first || highest[address] > last)) return false;
+               if ((ins.op == JMP || is_branch(address)) && (ins.k < first || (ins.k > last && ins.k != exit))) return false;
+            }
+            return true;
+         };
+         const auto add = [&](const std::size_t block, const std::size_t site)
+         {
+            sources_.push_back(source{ static_cast<std::uint16_t>(block), static_cast<std::uint16_t>(site) });
+            return;
+         };
+
+         for (std::size_t address = 1; address < program.size(); ++address)
+         {
+            if (!(kinds_[address] & leader) || external(address)) continue;
+            const auto before = address - 1;
+            const auto head = program[before].k;
+            const auto from = lowest[address];
+
+            if (from == ~0U && !called[address] && is_branch(before) && head > 0 && head <= before &&
+                !is_branch(head - 1u) && !ends(head - 1u) && closed(head, before, head))
+            {
+               add(address, head - 1u);
+            }
+            else if (from == ~0U && ends(before))
+            {
+               const auto range = std::equal_range(calls.begin(), calls.end(), source{ static_cast<std::uint16_t>(address), 0 }, by_block);
+               for (auto i = range.first; i != range.second; ++i) add(address, i->site);
+            }
+            else if (from != ~0U && !called[address] && from < address && highest[address] < address &&
+                     (is_branch(from) || program[from].op == JMP) && closed(from + 1, before, address))
+            {
+               add(address, from);
+            }
+            else
+            {
+               continue;
+            }
+
+            kinds_[address] = static_cast<std::uint8_t>((kinds_[address] & ~leader) | derived);
+         }
+
+         std::sort(sources_.begin(), sources_.end(), by_block);
+         return;
+      }
+
+      /********************************************************************************
+      * resolve: Checks that the entries of specified block don't depend on
+      *          themselves, as for recursive functions, in which case the block
+      *          gets a counter. Returns false if the block is being resolved.
+      *
+      *          - block: First address of the block.
+      *          - state: Per block 0 = unresolved, 1 = being resolved, 2 = resolved.
+      ********************************************************************************/
+      bool resolve(const std::uint16_t block,
+                   std::vector<std::uint8_t>& state)
+      {
+         if (state[block] == 1) return false;
+         if (state[block] == 2 || !(kinds_[block] & derived)) return true;
+         state[block] = 1;
+
+         for (auto i = first_source(block); i != sources_.end() && i->block == block; ++i)
+         {
+            if (!resolve(block_[i->site], state))
+            {
+               kinds_[block] = static_cast<std::uint8_t>((kinds_[block] & ~derived) | leader);
+               break;
+            }
+         }
+
+         state[block] = 2;
+         return true;
+      }
+
+      /********************************************************************************
+      * first_source: Returns the first source of specified block, see derive.
+      ********************************************************************************/
+      std::vector<source>::const_iterator first_source(const std::uint16_t block) const
+      {
+         return std::lower_bound(sources_.begin(), sources_.end(), block,
+            [](const source& s, const std::uint16_t value) { return s.block < value; });
+      }
+
+      /********************************************************************************
+      * entries: Returns the entries of the block starting at specified address,
+      *          counted or derived from the executions of its sources.
+      ********************************************************************************/
+      std::uint64_t entries(const std::uint16_t block) const
+      {
+         if (!(kinds_[block] & derived)) return entries_[block];
+         std::uint64_t sum = 0;
+
+         for (auto i = first_source(block); i != sources_.end() && i->block == block; ++i)
+         {
+            sum += entries(block_[i->site]);
+         }
+         return sum;
+      }
+
+      /********************************************************************************
+      * charge: Charges the cycles since the last change of the call stack to
+      *         the current stack. Nothing is charged if the clock was set back
+      *         by restoring a snapshot.
+      ********************************************************************************/
+      void charge(void)
+      {
+         const auto now = machine_.cycles;
+         if (now > charged_) nodes_[current_].cycles += now - charged_;
+         charged_ = now;
+         return;
+      }
+
+      /********************************************************************************
+      * enter: Enters the frame of specified function, which is added to the
+      *        frames called from the current frame on the first call.
+      ********************************************************************************/
+      void enter(const std::uint16_t function)
+      {
+         charge();
+         auto i = nodes_[current_].child;
+         while (i && nodes_[i].function != function) i = nodes_[i].sibling;
+
+         if (!i)
+         {
+            i = static_cast<std::uint32_t>(nodes_.size());
+            nodes_.push_back(node{ function, current_, 0, nodes_[current_].child, 0 });
+            nodes_[current_].child = i;
+         }
+
+         current_ = i;
+         return;
+      }
+
+      /********************************************************************************
+      * leave_frame: Returns to the calling frame, unless the stack is at its root.
+      ********************************************************************************/
+      void leave_frame(void)
+      {
+         charge();
+         current_ = nodes_[current_].parent;
+         return;
+      }
+
+      /********************************************************************************
+      * call_original: Executes the original handler of the instruction. Used
+      *                for handlers not known to instrument, e.g. of idle loops.
+      ********************************************************************************/
+      static void call_original(machine& m, const instruction& ins)
+      {
+         static_cast<profile*>(m.instrumentation)->original_[m.pc](m, ins);
+         return;
+      }
+
+      /********************************************************************************
+      * count_entry: Handler of the first instruction of a block without other
+      *              instrumentation, which counts the entry of the block and
+      *              executes the original handler. Sharing it among all
+      *              blocks keeps the code run per instruction as small as
+      *              without the profiler, which matters more than the call.
+      ********************************************************************************/
+      static void count_entry(machine& m, const instruction& ins)
+      {
+         auto& p = *static_cast<profile*>(m.instrumentation);
+         ++p.entries_[m.pc];
+         p.original_[m.pc](m, ins);
+         return;
+      }
+
+      /********************************************************************************
+      * count: Handler of an instruction of specified kind, which counts the
+      *        entry of a block, executes the instruction with specified
+      *        original handler, adds its cycles if they vary and enters or
+      *        leaves a frame, see the file header.
+      ********************************************************************************/
+      template<std::uint8_t kind, handler execute>
+      static void count(machine& m, const instruction& ins)
+      {
+         auto& p = *static_cast<profile*>(m.instrumentation);
+         const auto address = m.pc;
+         const auto start = m.cycles;
+
+         if ((kind & vector) && m.interrupts != p.interrupts_)
+         {
+            p.interrupts_ = m.interrupts;
+            p.enter(address);
+         }
+         if (kind & leader) ++p.entries_[address];
+         execute(m, ins);
+
+         if (kind & variable) p.cycles_[address] += m.cycles - start;
+         if (kind & call)     p.enter(ins.k);
+         if (kind & leave)    p.leave_frame();
+         return;
+      }
+
+      /********************************************************************************
+      * count_any: Handler of an instruction of another kind, which is looked up
+      *            per execution, e.g. of the interrupt vectors.
+      ********************************************************************************/
+      template<handler execute>
+      static void count_any(machine& m, const instruction& ins)
+      {
+         auto& p = *static_cast<profile*>(m.instrumentation);
+         const auto address = m.pc;
+         const auto kind = p.kinds_[address];
+         const auto start = m.cycles;
+
+         if ((kind & vector) && m.interrupts != p.interrupts_)
+         {
+            p.interrupts_ = m.interrupts;
+            p.enter(address);
+         }
+         if (kind & leader) ++p.entries_[address];
+         execute(m, ins);
+
+         if (kind & variable) p.cycles_[address] += m.cycles - start;
+         if (kind & call)     p.enter(ins.k);
+         if (kind & leave)    p.leave_frame();
+         return;
+      }
+
+      /********************************************************************************
+      * select: Returns the handler for an instruction of specified kind with
+      *         specified original handler.
+      ********************************************************************************/
+      template<handler execute>
+      static handler select(const std::uint8_t kind)
+      {
+         switch (kind)
+         {
+#define PROFILER_KIND(k) case k: return count<k, execute>;
+         PROFILER_KIND(variable) PROFILER_KIND(leader | variable)
+         PROFILER_KIND(call) PROFILER_KIND(leader | call) PROFILER_KIND(leave) PROFILER_KIND(leader | leave)
+#undef PROFILER_KIND
+         default: return count_any<execute>;
+         }
+      }
+
+      /********************************************************************************
+      * instrument: Returns the handler for an instruction of specified kind with
+      *             specified original handler. Block entries alone are counted
+      *             by count_entry. Otherwise, the handlers of the emulator are
+      *             called directly by the instrumented handler, others through
+      *             call_original.
+      ********************************************************************************/
+      static handler instrument(const std::uint8_t kind,
+                                const handler original)
+      {
+         if (kind == leader) return count_entry;
+#define PROFILER_HANDLER(execute) if (original == execute) return select<execute>(kind);
+#define PROFILER_EMULATOR(name, code, format, comment) PROFILER_HANDLER(execute_##name)
+         PROFILER_HANDLER(execute_NOP)
+         PROFILER_HANDLER(execute_alu)
+         PROFILER_HANDLER(execute_alu_immediate)
+         PROFILER_HANDLER(execute_mdu)
+         EMULATOR_INSTRUCTIONS(PROFILER_EMULATOR)
+#undef PROFILER_EMULATOR
+#undef PROFILER_HANDLER
+         return select<call_original>(kind);
+      }
+
+      machine& machine_;                           /* The profiled machine. */
+      std::vector<handler> original_;              /* Original handler per address. */
+      std::vector<std::uint8_t> kinds_;            /* Kind of instrumentation per address. */
+      std::vector<std::uint64_t> entries_;         /* Entries per block, at its first address. */
+      std::vector<std::uint64_t> cycles_;          /* Cycles per address with variable cycles. */
+      std::vector<std::uint16_t> block_;           /* First address of the block per address. */
+      std::vector<source> sources_;                /* Sources of blocks with derived entries, by block. */
+      std::vector<node> nodes_;                    /* Call stack tree, root first. */
+      std::uint32_t current_ = 0;                  /* Frame of the current stack. */
+      std::uint64_t charged_;                      /* Cycle up to which cycles were charged. */
+      std::uint64_t interrupts_;                   /* Interrupts accepted up to the last vector frame. */
+   };
+}
+
+#endif /* PROFILER_HPP_ */
\ No newline at end of file
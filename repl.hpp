@@ -0,0 +1,284 @@
+/********************************************************************************
+* repl.hpp: Contains the interactive front end of the ALU emulator, a read-
+*           eval-print loop where each command is entered on a single line:
+*
+*           - ADD 100 50       : Instruction followed by its operands (one
+*                                operand for unary instructions). Operands are
+*                                entered in decimal (-128 - 255), hexadecimal
+*                                (0x) or binary (0b) notation.
+*           - (100 + 50) & 0x0F: Constant expression (see expr.hpp), used when
+*                                the first word isn't an instruction.
+*           - help             : Lists the instructions with their descriptions.
+*           - quit             : Ends the loop (as does end of input).
+*
+*           Several commands can be entered on one line separated by ';'.
+*           In quiet mode only the result and the status flags SNZVC are
+*           printed per command, e.g. "150 01010", which suits scripted
+*           sessions. All lines are read into the same buffer and instruction
+*           commands are parsed in place, so that no memory is allocated per
+*           command once the buffer has grown to the longest line.
+********************************************************************************/
+#ifndef REPL_HPP_
+#define REPL_HPP_
+
+/* Include directives: */
+#include <iomanip>
+#include "alu.hpp"
+#include "expr.hpp"
+
+/********************************************************************************
+* repl: Namespace containing the read-eval-print loop.
+********************************************************************************/
+namespace repl
+{
+   using namespace cpu; /* Brings all content of the cpu namespace into current scope. */
+
+   /********************************************************************************
+   * is_space: Returns true if specified character is a space or a tab.
+   ********************************************************************************/
+   static bool is_space(const char c)
+   {
+      return c == ' ' || c == '\t' || c == '\r';
+   }
+
+   /********************************************************************************
+   * next_word: Returns a pointer to the next word in [begin, end) and stores
+   *            its size in the referenced variable. The position is advanced
+   *            past the word.
+   ********************************************************************************/
+   static const char* next_word(const char*& begin,
+                                const char* end,
+                                std::size_t& size)
+   {
+      while (begin < end && is_space(*begin)) ++begin;
+      const auto word = begin;
+      while (begin < end && !is_space(*begin)) ++begin;
+      size = static_cast<std::size_t>(begin - word);
+      return word;
+   }
+
+   /********************************************************************************
+   * parse_byte: Parses an operand in decimal (-128 - 255), hexadecimal (0x) or
+   *             binary (0b) notation. Returns true if the operand is valid.
+   *
+   *             - s    : Pointer to the operand.
+   *             - size : The number of characters of the operand.
+   *             - value: Reference to storage for the value.
+   ********************************************************************************/
+   static bool parse_byte(const char* s,
+                          std::size_t size,
+                          std::uint8_t& value)
+   {
+      const auto negative = size > 0 && *s == '-';
+      if (negative) ++s, --size;
+      unsigned base = 10;
+
+      if (size > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))      base = 16, s += 2, size -= 2;
+      else if (size > 2 && s[0] == '0' && (s[1] == 'b' || s[1] == 'B')) base = 2, s += 2, size -= 2;
+      if (size == 0) return false;
+
+      unsigned magnitude = 0;
+
+      for (std::size_t i = 0; i < size; ++i)
+      {
+         unsigned digit = base;
+         if (s[i] >= '0' && s[i] <= '9')      digit = static_cast<unsigned>(s[i] - '0');
+         else if (s[i] >= 'a' && s[i] <= 'f') digit = static_cast<unsigned>(s[i] - 'a' + 10);
+         else if (s[i] >= 'A' && s[i] <= 'F') digit = static_cast<unsigned>(s[i] - 'A' + 10);
+         if (digit >= base) return false;
+         magnitude = magnitude * base + digit;
+         if (magnitude > 255) return false;
+      }
+
+      if (negative && magnitude > 128) return false;
+      value = static_cast<std::uint8_t>(negative ? 256 - magnitude : magnitude);
+      return true;
+   }
+
+   /********************************************************************************
+   * print_quiet: Prints the result and status flags SNZVC on one line.
+   ********************************************************************************/
+   static void print_quiet(const unsigned result,
+                           const std::uint8_t sr,
+                           std::ostream& ostream)
+   {
+      char flags[7] = { ' ', 'S', 'N', 'Z', 'V', 'C', '\n' };
+      for (std::uint8_t i = 0; i < 5; ++i) flags[5 - i] = read(sr, i) ? '1' : '0';
+      ostream << result;
+      ostream.write(flags, sizeof(flags));
+      return;
+   }
+
+   /********************************************************************************
+   * print_help: Prints each instruction with its description, one per line.
+   ********************************************************************************/
+   static void print_help(std::ostream& ostream)
+   {
+#define REPL_OP_CODE(name, code, symbol, form, comment) name,
+      static constexpr std::uint8_t op_codes[] = { CPU_INSTRUCTIONS(REPL_OP_CODE) };
+#undef REPL_OP_CODE
+
+      for (const auto op_code : op_codes)
+      {
+         ostream << "   " << std::left << std::setw(8) << get_instruction_name(op_code)
+            << std::right << get_description(op_code) << "\n";
+      }
+      ostream << "\n";
+      return;
+   }
+
+   /********************************************************************************
+   * execute: Executes the command in [begin, end) and prints the result.
+   *          Returns false if the command is quit, otherwise true.
+   *
+   *          - begin  : Pointer to the first character of the command.
+   *          - end    : Pointer to the end of the command.
+   *          - quiet  : Indicates if only the result and SNZVC are printed.
+   *          - ostream: Reference to output stream.
+   ********************************************************************************/
+   static bool execute(const char* begin,
+                       const char* end,
+                       const bool quiet,
+                       std::ostream& ostream)
+   {
+      auto position = begin;
+      std::size_t size = 0;
+      const auto word = next_word(position, end, size);
+      if (size == 0) return true;
+      if (equals(word, size, "QUIT") || equals(word, size, "EXIT")) return false;
+
+      if (equals(word, size, "HELP"))
+      {
+         print_help(ostream);
+         return true;
+      }
+
+      const auto op_code = get_op_code(word, size);
+
+      if (op_code == NOP)
+      {
+         try
+         {
+            const expr::expression expression{ std::string(begin, end) };
+
+            if (!expression.variables().empty())
+            {
+               ostream << "Invalid instruction, try again!\n";
+               return true;
+            }
+
+            std::uint8_t sr = 0x00;
+            const auto result = expression.evaluate(nullptr, sr);
+
+            if (quiet)
+            {
+               print_quiet(result, sr, ostream);
+            }
+            else
+            {
+               ostream << "--------------------------------------------------------------------------------\n";
+               ostream << "Expression : ";
+               ostream.write(begin, end - begin) << "\n";
+               ostream << "Decimal\t   : " << static_cast<int>(result) << "\n";
+               ostream << "Binary\t   : " << std::bitset<8>(result) << "\n";
+               ostream << "Status bits: SNZVC = " << std::bitset<5>(sr) << "\n";
+               ostream << "--------------------------------------------------------------------------------\n\n";
+            }
+         }
+         catch (std::invalid_argument&)
+         {
+            ostream << "Invalid instruction, try again!\n";
+         }
+         return true;
+      }
+
+      std::uint8_t operands[2] = { 0, 0 };
+      const auto count = is_unary(op_code) ? 1 : 2;
+
+      for (auto i = 0; i < count; ++i)
+      {
+         const auto operand = next_word(position, end, size);
+
+         if (!parse_byte(operand, size, operands[i]))
+         {
+            ostream << "Invalid operand, try again!\n";
+            return true;
+         }
+      }
+
+      next_word(position, end, size);
+
+      if (size)
+      {
+         ostream << "Too many operands, try again!\n";
+         return true;
+      }
+
+      if (!quiet)
+      {
+         alu::print(op_code, operands[0], operands[1], ostream);
+      }
+      else if (is_wide(op_code))
+      {
+         std::uint8_t sr = 0x00;
+         const unsigned result = mdu::calculate(op_code, operands[0], operands[1], sr);
+         print_quiet(result, sr, ostream);
+      }
+      else
+      {
+         std::uint8_t sr = 0x00;
+         const unsigned result = alu::calculate(op_code, operands[0], operands[1], sr);
+         print_quiet(result, sr, ostream);
+      }
+      return true;
+   }
+
+   /********************************************************************************
+   * run: Reads commands line by line until end of input or quit. The output is
+   *      flushed whenever no more input is buffered, so that another program
+   *      can drive the loop line by line, while piped input isn't slowed down
+   *      by a flush per line.
+   *
+   *      - quiet  : Indicates if only the result and SNZVC are printed
+   *                 (default = false).
+   *      - istream: Reference to input stream (default = std::cin).
+   *      - ostream: Reference to output stream (default = std::cout).
+   ********************************************************************************/
+   static void run(const bool quiet = false,
+                   std::istream& istream = std::cin,
+                   std::ostream& ostream = std::cout)
+   {
+      std::string line;
+      line.reserve(256);
+
+      if (!quiet)
+      {
+         ostream << "Enter an instruction followed by its operands, e.g. ADD 100 50, or an\n"
+            << "expression, e.g. (100 + 50) & 0x0F. Separate commands with ';', enter help\n"
+            << "for descriptions and quit to exit. Instructions: " << get_instruction_list() << "\n\n";
+      }
+
+      while (std::getline(istream, line))
+      {
+         const auto end = line.data() + line.size();
+         auto begin = line.data();
+
+         while (begin <= end)
+         {
+            auto separator = begin;
+            while (separator < end && *separator != ';') ++separator;
+            if (!execute(begin, separator, quiet, ostream))
+            {
+               ostream.flush();
+               return;
+            }
+
+            begin = separator + 1;
+         }
+         if (istream.rdbuf()->in_avail() <= 0) ostream.flush();
+      }
+      return;
+   }
+}
+
+#endif /* REPL_HPP_ */
\ No newline at end of file
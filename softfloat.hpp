@@ -0,0 +1,824 @@
+/********************************************************************************
+* softfloat.hpp: Contains an IEEE-754 binary32 soft-float unit for estimating
+*                the cost of floating point arithmetic on 8-bit targets
+*                lacking a floating point unit, such as ATmega328P.
+*
+*                Each floating point operation is implemented once as a
+*                sequence of 32-bit integer primitives (addition, subtraction,
+*                comparison, shifts, the mantissa multiplication etc.),
+*                executed by a machine:
+*
+*                - host_machine: Executes the primitives on host words. This is
+*                                the fast path.
+*                - alu_machine : Executes the primitives byte by byte with
+*                                alu::calculate, propagating carry/borrow
+*                                between the bytes via the C flag, and
+*                                multiplies with the MUL of mdu.hpp.
+*
+*                Since both machines run the same algorithm, the results are
+*                bit-identical. Both machines also count the number of 8-bit
+*                operations the primitives correspond to on the target (e.g.
+*                a 32-bit addition is one ADD followed by three ADC). The
+*                alu_machine counts the byte operations it performs, so it
+*                checks the cost model, which the fast path provides without
+*                emulating the bytes.
+*
+*                Rounding is always round to nearest, ties to even. Subnormal
+*                numbers are supported. A NaN result is the first NaN operand
+*                quieted, or the default NaN 0xFFC00000 for invalid operations,
+*                which is the behavior of SSE on x86 hosts.
+********************************************************************************/
+#ifndef SOFTFLOAT_HPP_
+#define SOFTFLOAT_HPP_
+
+/* Include directives: */
+#include <cstring>
+#include "alu.hpp"
+
+/********************************************************************************
+* softfloat: Namespace containing the soft-float unit.
+********************************************************************************/
+namespace softfloat
+{
+   static constexpr std::uint32_t sign_mask = 0x80000000;     /* Sign bit. */
+   static constexpr std::uint32_t exponent_mask = 0x7F800000; /* Exponent field. */
+   static constexpr std::uint32_t fraction_mask = 0x007FFFFF; /* Fraction field. */
+   static constexpr std::uint32_t quiet_bit = 0x00400000;     /* Quiet bit of NaN. */
+   static constexpr std::uint32_t default_nan = 0xFFC00000;   /* Result of invalid operations. */
+   static constexpr std::uint32_t infinity = 0x7F800000;      /* Positive infinity. */
+
+   static constexpr int less = -1;     /* Compare result a < b. */
+   static constexpr int equal = 0;     /* Compare result a == b. */
+   static constexpr int greater = 1;   /* Compare result a > b. */
+   static constexpr int unordered = 2; /* Compare result if any operand is NaN. */
+
+   /********************************************************************************
+   * Cost of the primitives in 8-bit operations:
+   ********************************************************************************/
+   static constexpr std::size_t cost_word = 4;     /* 32-bit add, sub, compare, and, or. */
+   static constexpr std::size_t cost_shift = 4;    /* 32-bit shift by one bit. */
+   static constexpr std::size_t cost_sticky = 1;   /* Collecting a shifted out bit. */
+   static constexpr std::size_t cost_multiply = 27; /* 24 x 24 bit multiply (9 MUL, 18 ADD/ADC). */
+   static constexpr std::size_t cost_unpack = 8;   /* Splitting an operand into fields. */
+   static constexpr std::size_t cost_pack = 6;     /* Assembling the result. */
+   static constexpr std::size_t cost_test = 2;     /* Testing a special case. */
+
+   /********************************************************************************
+   * counter: Number of 8-bit operations the emulated operations correspond to.
+   ********************************************************************************/
+   struct counter
+   {
+      std::size_t operations = 0;
+
+      /********************************************************************************
+      * reset: Clears the accounted operations.
+      ********************************************************************************/
+      void reset(void)
+      {
+         operations = 0;
+         return;
+      }
+   };
+
+   /********************************************************************************
+   * host_machine: Executes the soft-float primitives on host words.
+   ********************************************************************************/
+   class host_machine
+   {
+   public:
+      explicit host_machine(counter* counter = nullptr) : counter_{ counter } {}
+
+      /********************************************************************************
+      * account: Accounts for specified number of 8-bit operations.
+      ********************************************************************************/
+      void account(const std::size_t operations)
+      {
+         if (counter_) counter_->operations += operations;
+         return;
+      }
+
+      std::uint32_t add(const std::uint32_t a, const std::uint32_t b)
+      {
+         account(cost_word);
+         return a + b;
+      }
+
+      std::uint32_t sub(const std::uint32_t a, const std::uint32_t b)
+      {
+         account(cost_word);
+         return a - b;
+      }
+
+      bool lower(const std::uint32_t a, const std::uint32_t b)
+      {
+         account(cost_word);
+         return a < b;
+      }
+
+      std::uint32_t bitwise_and(const std::uint32_t a, const std::uint32_t b)
+      {
+         account(cost_word);
+         return a & b;
+      }
+
+      std::uint32_t bitwise_or(const std::uint32_t a, const std::uint32_t b)
+      {
+         account(cost_word);
+         return a | b;
+      }
+
+      std::uint32_t shift_left(const std::uint32_t a, const std::uint32_t n)
+      {
+         account(cost_shift * n);
+         return n >= 32 ? 0 : a << n;
+      }
+
+      std::uint32_t shift_right(const std::uint32_t a, const std::uint32_t n)
+      {
+         account(cost_shift * n);
+         return n >= 32 ? 0 : a >> n;
+      }
+
+      /********************************************************************************
+      * shift_right_sticky: Shifts a right n bits. Bits shifted out are ORed into
+      *                     the least significant bit (the sticky bit), so that
+      *                     inexact results are still rounded correctly. Shifts
+      *                     of 27 bits or more leave only the sticky bit.
+      ********************************************************************************/
+      std::uint32_t shift_right_sticky(const std::uint32_t a, std::uint32_t n)
+      {
+         if (n > 27) n = 27;
+         account((cost_shift + cost_sticky) * n);
+         if (n == 0) return a;
+         const auto lost = (a & ((std::uint32_t{ 1 } << n) - 1)) != 0;
+         return (a >> n) | (lost ? 1 : 0);
+      }
+
+      /********************************************************************************
+      * multiply: Returns the 48-bit product of the 24-bit mantissas a and b.
+      ********************************************************************************/
+      std::uint64_t multiply(const std::uint32_t a, const std::uint32_t b)
+      {
+         account(cost_multiply);
+         return static_cast<std::uint64_t>(a) * b;
+      }
+
+   private:
+      counter* counter_;
+   };
+
+   /********************************************************************************
+   * alu_machine: Executes the soft-float primitives byte by byte with
+   *              alu::calculate. The carry between the bytes is taken from the
+   *              C flag, so an addition corresponds to ADD followed by ADC.
+   *              Since the ALU lacks ADC and SBC, these are performed as two
+   *              calculations, but accounted for as one operation. A shift by
+   *              one bit is LSL followed by ROL (or LSR followed by ROR), which
+   *              shift through C. Each byte operation performed is accounted
+   *              for, so the counts equal those of host_machine only if the
+   *              cost model holds.
+   ********************************************************************************/
+   class alu_machine
+   {
+   public:
+      explicit alu_machine(counter* counter = nullptr) : counter_{ counter } {}
+
+      void account(const std::size_t operations)
+      {
+         if (counter_) counter_->operations += operations;
+         return;
+      }
+
+      std::uint32_t add(const std::uint32_t a, const std::uint32_t b)
+      {
+         bool carry = false;
+         return chain(cpu::ADD, a, b, carry);
+      }
+
+      std::uint32_t sub(const std::uint32_t a, const std::uint32_t b)
+      {
+         bool carry = false;
+         return chain(cpu::SUB, a, b, carry);
+      }
+
+      bool lower(const std::uint32_t a, const std::uint32_t b)
+      {
+         bool carry = false;
+         chain(cpu::SUB, a, b, carry);
+         return carry;
+      }
+
+      std::uint32_t bitwise_and(const std::uint32_t a, const std::uint32_t b)
+      {
+         return logic(cpu::AND, a, b);
+      }
+
+      std::uint32_t bitwise_or(const std::uint32_t a, const std::uint32_t b)
+      {
+         return logic(cpu::OR, a, b);
+      }
+
+      std::uint32_t shift_left(std::uint32_t a, const std::uint32_t n)
+      {
+         bool carry = false;
+         for (std::uint32_t i = 0; i < n; ++i) a = shift(a, false, carry);
+         return a;
+      }
+
+      std::uint32_t shift_right(std::uint32_t a, const std::uint32_t n)
+      {
+         bool carry = false;
+         for (std::uint32_t i = 0; i < n; ++i) a = shift(a, true, carry);
+         return a;
+      }
+
+      /********************************************************************************
+      * shift_right_sticky: Shifts a right n bits (at most 27), ORing the bit
+      *                     shifted out by each step into the least significant
+      *                     byte, as host_machine::shift_right_sticky.
+      ********************************************************************************/
+      std::uint32_t shift_right_sticky(std::uint32_t a, std::uint32_t n)
+      {
+         if (n > 27) n = 27;
+
+         for (std::uint32_t i = 0; i < n; ++i)
+         {
+            bool carry = false;
+            std::uint8_t sr = 0x00;
+            a = shift(a, true, carry);
+            a = (a & ~std::uint32_t{ 0xFF }) | alu::calculate(cpu::OR, static_cast<std::uint8_t>(a), carry ? 1 : 0, sr);
+            account(cost_sticky);
+         }
+         return a;
+      }
+
+      /********************************************************************************
+      * multiply: Returns the 48-bit product of the 24-bit mantissas a and b,
+      *           by shifting and adding the 9 partial products of MUL. The
+      *           three products of each byte of b form a row with 3 ADD/ADC,
+      *           which is added at the offset of the byte with ADD/ADC, the
+      *           carry of the second row going into the top byte.
+      ********************************************************************************/
+      std::uint64_t multiply(const std::uint32_t a, const std::uint32_t b)
+      {
+         std::uint64_t product = 0;
+
+         for (std::uint8_t j = 0; j < 3; ++j)
+         {
+            std::uint32_t even = 0, odd = 0;
+            bool carry = false;
+
+            for (std::uint8_t i = 0; i < 3; ++i)
+            {
+               std::uint8_t sr = 0x00;
+               const auto partial = mdu::calculate(cpu::MUL, static_cast<std::uint8_t>(a >> (i * 8)),
+                                                   static_cast<std::uint8_t>(b >> (j * 8)), sr);
+               (i % 2 ? odd : even) |= static_cast<std::uint32_t>(partial) << (i * 8);
+               account(1);
+            }
+
+            const auto row = chain(cpu::ADD, even, odd, carry, 1);
+            if (j == 0)
+            {
+               product = row;
+               continue;
+            }
+
+            const auto low = product & ((std::uint64_t{ 1 } << (j * 8)) - 1);
+            const auto sum = chain(cpu::ADD, static_cast<std::uint32_t>(product >> (j * 8)), row, carry);
+            product = low | (static_cast<std::uint64_t>(sum) << (j * 8));
+
+            if (j == 1)
+            {
+               std::uint8_t sr = 0x00;
+               product |= static_cast<std::uint64_t>(alu::calculate(cpu::ADD, 0, carry ? 1 : 0, sr)) << 40;
+               account(1);
+            }
+         }
+         return product;
+      }
+
+   private:
+
+      /********************************************************************************
+      * chain: Adds or subtracts b from a byte by byte, least significant byte
+      *        first. The referenced carry is set to the carry (addition) or
+      *        borrow (subtraction) out of the most significant byte. The bytes
+      *        below first are taken from a, where b must be zero.
+      ********************************************************************************/
+      std::uint32_t chain(const std::uint8_t operation,
+                          const std::uint32_t a,
+                          const std::uint32_t b,
+                          bool& carry,
+                          const std::uint8_t first = 0)
+      {
+         auto result = a & ((std::uint32_t{ 1 } << (first * 8)) - 1);
+         carry = false;
+
+         for (auto i = first; i < 4; ++i)
+         {
+            std::uint8_t sr = 0x00;
+            auto byte = alu::calculate(operation, static_cast<std::uint8_t>(a >> (i * 8)),
+                                       static_cast<std::uint8_t>(b >> (i * 8)), sr);
+            auto next = operation == cpu::ADD ? cpu::read(sr, cpu::C) : !cpu::read(sr, cpu::C);
+
+            if (carry)
+            {
+               byte = alu::calculate(operation, byte, 1, sr);
+               next = next || (operation == cpu::ADD ? cpu::read(sr, cpu::C) : !cpu::read(sr, cpu::C));
+            }
+
+            carry = next;
+            result |= static_cast<std::uint32_t>(byte) << (i * 8);
+         }
+
+         account(cost_word - first);
+         return result;
+      }
+
+      /********************************************************************************
+      * shift: Shifts a one bit left, least significant byte first with LSL and
+      *        then ROL, or right, most significant byte first with LSR and then
+      *        ROR. The referenced carry is set to the bit shifted out.
+      ********************************************************************************/
+      std::uint32_t shift(const std::uint32_t a,
+                          const bool right,
+                          bool& carry)
+      {
+         std::uint32_t result = 0;
+         std::uint8_t sr = 0x00;
+
+         for (std::uint8_t i = 0; i < 4; ++i)
+         {
+            const auto index = right ? 3 - i : i;
+            const auto operation = right ? (i == 0 ? cpu::LSR : cpu::ROR) : (i == 0 ? cpu::LSL : cpu::ROL);
+            const auto byte = alu::calculate(operation, static_cast<std::uint8_t>(a >> (index * 8)), 1, sr);
+            result |= static_cast<std::uint32_t>(byte) << (index * 8);
+         }
+
+         carry = cpu::read(sr, cpu::C);
+         account(cost_shift);
+         return result;
+      }
+
+      /********************************************************************************
+      * logic: Performs specified logic operation on a and b byte by byte.
+      ********************************************************************************/
+      std::uint32_t logic(const std::uint8_t operation,
+                          const std::uint32_t a,
+                          const std::uint32_t b)
+      {
+         std::uint32_t result = 0;
+
+         for (std::uint8_t i = 0; i < 4; ++i)
+         {
+            std::uint8_t sr = 0x00;
+            const auto byte = alu::calculate(operation, static_cast<std::uint8_t>(a >> (i * 8)),
+                                             static_cast<std::uint8_t>(b >> (i * 8)), sr);
+            result |= static_cast<std::uint32_t>(byte) << (i * 8);
+         }
+
+         account(cost_word);
+         return result;
+      }
+
+      counter* counter_;
+   };
+
+   /********************************************************************************
+   * is_nan: Returns true if specified bits represent a NaN.
+   ********************************************************************************/
+   static bool is_nan(const std::uint32_t a)
+   {
+      return (a & ~sign_mask) > infinity;
+   }
+
+   /********************************************************************************
+   * propagate_nan: Returns the first NaN operand quieted.
+   ********************************************************************************/
+   static std::uint32_t propagate_nan(const std::uint32_t a,
+                                      const std::uint32_t b)
+   {
+      return (is_nan(a) ? a : b) | quiet_bit;
+   }
+
+   /********************************************************************************
+   * unpack: Splits specified bits into exponent and mantissa. The implicit bit
+   *         is added to the mantissa of normal numbers, while subnormal numbers
+   *         get exponent 1 without implicit bit.
+   ********************************************************************************/
+   template<class Machine>
+   static void unpack(Machine& machine,
+                      const std::uint32_t a,
+                      std::int32_t& exponent,
+                      std::uint32_t& mantissa)
+   {
+      machine.account(cost_unpack);
+      exponent = static_cast<std::int32_t>((a & exponent_mask) >> 23);
+      mantissa = a & fraction_mask;
+
+      if (exponent == 0)
+      {
+         exponent = 1;
+      }
+      else
+      {
+         mantissa |= 0x00800000;
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * normalize: Shifts the mantissa of a subnormal number left until the
+   *            implicit bit is set, adjusting the exponent accordingly.
+   ********************************************************************************/
+   template<class Machine>
+   static void normalize(Machine& machine,
+                         std::int32_t& exponent,
+                         std::uint32_t& mantissa)
+   {
+      while (machine.lower(mantissa, 0x00800000))
+      {
+         mantissa = machine.shift_left(mantissa, 1);
+         exponent--;
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * round_pack: Rounds a mantissa with three extra bits (guard, round and sticky)
+   *             to nearest, ties to even, and assembles the result. The
+   *             mantissa is either normalized (bit 26 set) or subnormal with
+   *             exponent 1. A carry out of the mantissa during rounding
+   *             increments the exponent through the addition.
+   ********************************************************************************/
+   template<class Machine>
+   static std::uint32_t round_pack(Machine& machine,
+                                   const std::uint32_t sign,
+                                   const std::int32_t exponent,
+                                   std::uint32_t mantissa)
+   {
+      machine.account(cost_pack);
+      if (exponent >= 255) return sign | infinity;
+
+      const auto round_bits = mantissa & 0x07;
+      mantissa = machine.shift_right(mantissa, 3);
+
+      if (round_bits > 4 || (round_bits == 4 && (mantissa & 1)))
+      {
+         mantissa = machine.add(mantissa, 1);
+      }
+
+      const auto bits = machine.add(static_cast<std::uint32_t>(exponent - 1) << 23, mantissa);
+      if (!machine.lower(bits, infinity)) return sign | infinity;
+      return sign | bits;
+   }
+
+   /********************************************************************************
+   * add: Returns the sum of a and b as executed by specified machine.
+   ********************************************************************************/
+   template<class Machine>
+   static std::uint32_t add(Machine& machine,
+                            std::uint32_t a,
+                            std::uint32_t b)
+   {
+      machine.account(cost_test * 3);
+      if (is_nan(a) || is_nan(b)) return propagate_nan(a, b);
+
+      if ((a & ~sign_mask) == infinity)
+      {
+         return ((b & ~sign_mask) == infinity && (a ^ b) & sign_mask) ? default_nan : a;
+      }
+      if ((b & ~sign_mask) == infinity) return b;
+
+      machine.account(cost_test * 2);
+      if (!(a & ~sign_mask) && !(b & ~sign_mask)) return a & b;
+      if (!(a & ~sign_mask)) return b;
+      if (!(b & ~sign_mask)) return a;
+
+      if (machine.lower(a & ~sign_mask, b & ~sign_mask))
+      {
+         const auto temp = a;
+         a = b;
+         b = temp;
+      }
+
+      std::int32_t ea, eb;
+      std::uint32_t ma, mb;
+      unpack(machine, a, ea, ma);
+      unpack(machine, b, eb, mb);
+      ma = machine.shift_left(ma, 3);
+      mb = machine.shift_left(mb, 3);
+      mb = machine.shift_right_sticky(mb, static_cast<std::uint32_t>(ea - eb));
+
+      const auto sign = a & sign_mask;
+      std::uint32_t m;
+
+      if (!((a ^ b) & sign_mask))
+      {
+         m = machine.add(ma, mb);
+
+         if (!machine.lower(m, 0x08000000))
+         {
+            m = machine.shift_right_sticky(m, 1);
+            ea++;
+         }
+      }
+      else
+      {
+         m = machine.sub(ma, mb);
+         if (m == 0) return 0;
+
+         while (ea > 1 && machine.lower(m, 0x04000000))
+         {
+            m = machine.shift_left(m, 1);
+            ea--;
+         }
+      }
+
+      return round_pack(machine, sign, ea, m);
+   }
+
+   /********************************************************************************
+   * sub: Returns the difference of a and b as executed by specified machine.
+   ********************************************************************************/
+   template<class Machine>
+   static std::uint32_t sub(Machine& machine,
+                            const std::uint32_t a,
+                            const std::uint32_t b)
+   {
+      return add(machine, a, is_nan(b) ? b : b ^ sign_mask);
+   }
+
+   /********************************************************************************
+   * denormalize: Shifts the mantissa of a result with an exponent below 1 to
+   *              the right, turning it into a subnormal mantissa with exponent 1.
+   ********************************************************************************/
+   template<class Machine>
+   static void denormalize(Machine& machine,
+                           std::int32_t& exponent,
+                           std::uint32_t& mantissa)
+   {
+      if (exponent < 1)
+      {
+         mantissa = machine.shift_right_sticky(mantissa, static_cast<std::uint32_t>(1 - exponent));
+         exponent = 1;
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * mul: Returns the product of a and b as executed by specified machine.
+   ********************************************************************************/
+   template<class Machine>
+   static std::uint32_t mul(Machine& machine,
+                            const std::uint32_t a,
+                            const std::uint32_t b)
+   {
+      const auto sign = (a ^ b) & sign_mask;
+      machine.account(cost_test * 4);
+      if (is_nan(a) || is_nan(b)) return propagate_nan(a, b);
+
+      const auto a_inf = (a & ~sign_mask) == infinity, b_inf = (b & ~sign_mask) == infinity;
+      const auto a_zero = (a & ~sign_mask) == 0, b_zero = (b & ~sign_mask) == 0;
+      if ((a_inf && b_zero) || (b_inf && a_zero)) return default_nan;
+      if (a_inf || b_inf) return sign | infinity;
+      if (a_zero || b_zero) return sign;
+
+      std::int32_t ea, eb;
+      std::uint32_t ma, mb;
+      unpack(machine, a, ea, ma);
+      unpack(machine, b, eb, mb);
+      normalize(machine, ea, ma);
+      normalize(machine, eb, mb);
+
+      auto product = machine.multiply(ma, mb);
+      auto exponent = ea + eb - 127;
+      machine.account(cost_word);
+
+      if (product & (std::uint64_t{ 1 } << 47))
+      {
+         exponent++;
+      }
+      else
+      {
+         product <<= 1;
+      }
+      machine.account(cost_shift * 2);
+
+      auto m = static_cast<std::uint32_t>(product >> 21) | ((product & 0x1FFFFF) ? 1 : 0);
+      machine.account(cost_shift * 3 + cost_word);
+      denormalize(machine, exponent, m);
+      return round_pack(machine, sign, exponent, m);
+   }
+
+   /********************************************************************************
+   * div: Returns the quotient of a and b as executed by specified machine.
+   *      The mantissas are divided by restoring division, one quotient bit
+   *      per iteration.
+   ********************************************************************************/
+   template<class Machine>
+   static std::uint32_t div(Machine& machine,
+                            const std::uint32_t a,
+                            const std::uint32_t b)
+   {
+      const auto sign = (a ^ b) & sign_mask;
+      machine.account(cost_test * 4);
+      if (is_nan(a) || is_nan(b)) return propagate_nan(a, b);
+
+      const auto a_inf = (a & ~sign_mask) == infinity, b_inf = (b & ~sign_mask) == infinity;
+      const auto a_zero = (a & ~sign_mask) == 0, b_zero = (b & ~sign_mask) == 0;
+      if ((a_inf && b_inf) || (a_zero && b_zero)) return default_nan;
+      if (a_inf || b_zero) return sign | infinity;
+      if (b_inf || a_zero) return sign;
+
+      std::int32_t ea, eb;
+      std::uint32_t ma, mb;
+      unpack(machine, a, ea, ma);
+      unpack(machine, b, eb, mb);
+      normalize(machine, ea, ma);
+      normalize(machine, eb, mb);
+
+      auto exponent = ea - eb + 127;
+
+      if (machine.lower(ma, mb))
+      {
+         ma = machine.shift_left(ma, 1);
+         exponent--;
+      }
+
+      std::uint32_t quotient = 0;
+
+      for (int i = 0; i < 27; ++i)
+      {
+         quotient = machine.shift_left(quotient, 1);
+
+         if (!machine.lower(ma, mb))
+         {
+            ma = machine.sub(ma, mb);
+            quotient = machine.bitwise_or(quotient, 1);
+         }
+         ma = machine.shift_left(ma, 1);
+      }
+
+      machine.account(cost_word);
+      if (ma != 0) quotient |= 1;
+
+      denormalize(machine, exponent, quotient);
+      return round_pack(machine, sign, exponent, quotient);
+   }
+
+   /********************************************************************************
+   * compare: Compares a with b as executed by specified machine and returns
+   *          less, equal, greater or unordered (if any operand is NaN).
+   *          Positive and negative zero are equal.
+   ********************************************************************************/
+   template<class Machine>
+   static int compare(Machine& machine,
+                      const std::uint32_t a,
+                      const std::uint32_t b)
+   {
+      machine.account(cost_test * 3);
+      if (is_nan(a) || is_nan(b)) return unordered;
+      if (!((a | b) & ~sign_mask)) return equal;
+      if (a == b) return equal;
+
+      const auto a_negative = (a & sign_mask) != 0, b_negative = (b & sign_mask) != 0;
+      if (a_negative != b_negative) return a_negative ? less : greater;
+
+      const auto magnitude_lower = machine.lower(a & ~sign_mask, b & ~sign_mask);
+      return magnitude_lower != a_negative ? less : greater;
+   }
+
+   /********************************************************************************
+   * from_int: Converts a signed 32-bit integer to float as executed by
+   *           specified machine. Integers beyond 2^24 are rounded.
+   ********************************************************************************/
+   template<class Machine>
+   static std::uint32_t from_int(Machine& machine,
+                                 const std::int32_t value)
+   {
+      machine.account(cost_test);
+      if (value == 0) return 0;
+
+      const std::uint32_t sign = value < 0 ? sign_mask : 0;
+      auto magnitude = static_cast<std::uint32_t>(value);
+      if (sign) magnitude = machine.sub(0, magnitude);
+
+      std::int32_t exponent = 127 + 26;
+
+      while (!machine.lower(magnitude, 0x08000000))
+      {
+         magnitude = machine.shift_right_sticky(magnitude, 1);
+         exponent++;
+      }
+
+      while (machine.lower(magnitude, 0x04000000))
+      {
+         magnitude = machine.shift_left(magnitude, 1);
+         exponent--;
+      }
+
+      return round_pack(machine, sign, exponent, magnitude);
+   }
+
+   /********************************************************************************
+   * to_int: Converts a float to a signed 32-bit integer as executed by
+   *         specified machine, rounding toward zero. NaN and values out of
+   *         range return 0x80000000 (the integer indefinite value of x86).
+   ********************************************************************************/
+   template<class Machine>
+   static std::int32_t to_int(Machine& machine,
+                              const std::uint32_t a)
+   {
+      static constexpr auto indefinite = static_cast<std::int32_t>(0x80000000);
+      std::int32_t exponent;
+      std::uint32_t mantissa;
+      unpack(machine, a, exponent, mantissa);
+
+      machine.account(cost_test * 2);
+      if (exponent < 127) return 0;
+      if (exponent >= 127 + 31) return indefinite;
+
+      const auto shift = exponent - 127;
+
+      if (shift >= 23)
+      {
+         mantissa = machine.shift_left(mantissa, static_cast<std::uint32_t>(shift - 23));
+      }
+      else
+      {
+         mantissa = machine.shift_right(mantissa, static_cast<std::uint32_t>(23 - shift));
+      }
+
+      return static_cast<std::int32_t>((a & sign_mask) ? machine.sub(0, mantissa) : mantissa);
+   }
+
+   /********************************************************************************
+   * Fast path: The operations below are executed on host words. The number
+   *            of 8-bit operations is added to the counter, if specified.
+   ********************************************************************************/
+   static std::uint32_t add(const std::uint32_t a, const std::uint32_t b, counter* counter = nullptr)
+   {
+      host_machine machine{ counter };
+      return add(machine, a, b);
+   }
+
+   static std::uint32_t sub(const std::uint32_t a, const std::uint32_t b, counter* counter = nullptr)
+   {
+      host_machine machine{ counter };
+      return sub(machine, a, b);
+   }
+
+   static std::uint32_t mul(const std::uint32_t a, const std::uint32_t b, counter* counter = nullptr)
+   {
+      host_machine machine{ counter };
+      return mul(machine, a, b);
+   }
+
+   static std::uint32_t div(const std::uint32_t a, const std::uint32_t b, counter* counter = nullptr)
+   {
+      host_machine machine{ counter };
+      return div(machine, a, b);
+   }
+
+   static int compare(const std::uint32_t a, const std::uint32_t b, counter* counter = nullptr)
+   {
+      host_machine machine{ counter };
+      return compare(machine, a, b);
+   }
+
+   static std::uint32_t from_int(const std::int32_t value, counter* counter = nullptr)
+   {
+      host_machine machine{ counter };
+      return from_int(machine, value);
+   }
+
+   static std::int32_t to_int(const std::uint32_t a, counter* counter = nullptr)
+   {
+      host_machine machine{ counter };
+      return to_int(machine, a);
+   }
+
+   /********************************************************************************
+   * to_bits: Returns the binary32 representation of specified float.
+   ********************************************************************************/
+   static std::uint32_t to_bits(const float f)
+   {
+      std::uint32_t bits;
+      std::memcpy(&bits, &f, sizeof(bits));
+      return bits;
+   }
+
+   /********************************************************************************
+   * from_bits: Returns the float represented by specified binary32 bits.
+   ********************************************************************************/
+   static float from_bits(const std::uint32_t bits)
+   {
+      float f;
+      std::memcpy(&f, &bits, sizeof(f));
+      return f;
+   }
+}
+
+#endif /* SOFTFLOAT_HPP_ */
\ No newline at end of file
@@ -0,0 +1,112 @@
+/********************************************************************************
+* table.hpp: Contains a lookup table backend of the ALU. A table holds the
+*            precomputed kernel output (see alu::kernel) of one operation for
+*            every combination of operands and incoming carry flag, so that a
+*            calculation is reduced to one memory access and a flag update.
+*            The generator is produced from CPU_ALU_INSTRUCTIONS, hence every
+*            ALU instruction gets a table without further changes.
+********************************************************************************/
+#ifndef TABLE_HPP_
+#define TABLE_HPP_
+
+/* Include directives: */
+#include <vector>
+#include "alu.hpp"
+
+/********************************************************************************
+* table: Namespace containing the lookup table backend.
+********************************************************************************/
+namespace table
+{
+   using namespace cpu; /* Brings all content of the cpu namespace into current scope. */
+
+   static constexpr std::size_t entries = 2 * 256 * 256; /* Carry x first x second operand. */
+
+   /********************************************************************************
+   * lookup_table: Precomputed kernel outputs of one operation.
+   *
+   *               - operation: OP code of the operation.
+   *               - outputs  : Kernel outputs indexed by index(a, b, carry).
+   ********************************************************************************/
+   struct lookup_table
+   {
+      std::uint8_t operation = NOP;
+      std::vector<std::uint16_t> outputs;
+   };
+
+   /********************************************************************************
+   * index: Returns the index of the kernel output for specified operands and
+   *        carry flag.
+   ********************************************************************************/
+   static std::size_t index(const std::uint8_t a,
+                            const std::uint8_t b,
+                            const std::uint16_t carry)
+   {
+      return (static_cast<std::size_t>(carry) << 16) | (static_cast<std::size_t>(a) << 8) | b;
+   }
+
+   /********************************************************************************
+   * fill: Stores the kernel output of specified operation for every
+   *       combination of operands and carry flag.
+   ********************************************************************************/
+   template<std::uint8_t operation>
+   static void fill(std::uint16_t* outputs)
+   {
+      for (std::uint16_t carry = 0; carry < 2; ++carry)
+      {
+         for (std::uint16_t a = 0; a < 256; ++a)
+         {
+            for (std::uint16_t b = 0; b < 256; ++b)
+            {
+               outputs[index(static_cast<std::uint8_t>(a), static_cast<std::uint8_t>(b), carry)] =
+                  alu::kernel<operation>(static_cast<std::uint8_t>(a), static_cast<std::uint8_t>(b), carry);
+            }
+         }
+      }
+      return;
+   }
+
+   /********************************************************************************
+   * generate: Returns the lookup table of specified operation. Operations that
+   *           aren't ALU instructions get a table of zeros, just as
+   *           alu::calculate returns zero for them.
+   *
+   *           - operation: OP code of the operation.
+   ********************************************************************************/
+   static lookup_table generate(const std::uint8_t operation)
+   {
+      lookup_table table;
+      table.operation = operation;
+      table.outputs.assign(entries, 0);
+
+      switch (operation)
+      {
+#define TABLE_FILL(name, code, symbol, form, comment) case name: fill<name>(table.outputs.data()); break;
+      CPU_ALU_INSTRUCTIONS(TABLE_FILL)
+#undef TABLE_FILL
+      default: break;
+      }
+      return table;
+   }
+
+   /********************************************************************************
+   * calculate: Performs the operation of specified table with specified
+   *            operands and returns the result. The status flags SNZVC of
+   *            the referenced status register are updated exactly as by
+   *            alu::calculate.
+   *
+   *            - table: Reference to the lookup table of the operation.
+   *            - a    : First operand.
+   *            - b    : Second operand.
+   *            - sr   : Reference to status register containing SNZVC flags.
+   ********************************************************************************/
+   static std::uint8_t calculate(const lookup_table& table,
+                                 const std::uint8_t a,
+                                 const std::uint8_t b,
+                                 std::uint8_t& sr)
+   {
+      return alu::finish(table.outputs[index(a, b, read(sr, C) ? 1 : 0)], sr);
+   }
+}
+
+#endif /* TABLE_HPP_ */
\ No newline at end of file
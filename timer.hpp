@@ -0,0 +1,273 @@
+/********************************************************************************
+* timer.hpp: Contains Timer/Counter0 of the CPU in emulator.hpp, modeled on the
+*            8-bit timer of the ATmega328P in Normal Mode. The counter TCNT0
+*            is incremented once per prescaled clock tick and wraps around
+*            from 255 to 0, which sets the overflow flag TOV0 (the unsigned
+*            overflow described in alu.hpp). The compare flags OCF0A and
+*            OCF0B are set when the counter reaches OCR0A and OCR0B. A flag is
+*            cleared by writing 1 to it.
+*
+*            The prescaler runs freely with the CPU clock, so that a tick
+*            occurs at every cycle that is a multiple of the prescaler value.
+*            The counter isn't incremented while the CPU runs. The state holds
+*            the counter and flags at the cycle of the last update, from
+*            which the counter and flags at a later cycle are computed in
+*            closed form when a register is accessed or an interrupt is
+*            accepted, see update. The tick-by-tick model is kept as
+*            reference in update_by_ticks.
+*
+*            The registers are listed in TIMER_REGISTERS and are mapped at
+*            their ATmega328P data addresses. A flag enabled in TIMSK0
+*            requests an interrupt, whose vector is at the ATmega328P program
+*            address (TIMER0_COMPA_vect, TIMER0_COMPB_vect, TIMER0_OVF_vect,
+*            in order of priority). The flag is cleared when the interrupt is
+*            accepted, see next_interrupt and acknowledge.
+********************************************************************************/
+#ifndef TIMER_HPP_
+#define TIMER_HPP_
+
+/* Include directives: */
+#include <cstdint>
+#include <algorithm>
+
+/********************************************************************************
+* TIMER_REGISTERS: Registers of Timer/Counter0. Each entry holds:
+*
+*                  - name   : Name of the register.
+*                  - address: Data address of the register.
+*                  - comment: Description of the register.
+********************************************************************************/
+#define TIMER_REGISTERS(X) \
+   X(TIFR0,  0x35, "Interrupt flag register, TOV0, OCF0A and OCF0B in bits 0 - 2.") \
+   X(TCCR0A, 0x44, "Control register A, only Normal Mode (0) is supported.") \
+   X(TCCR0B, 0x45, "Control register B, clock select CS02:0 in bits 2 - 0.") \
+   X(TCNT0,  0x46, "Counter value.") \
+   X(OCR0A,  0x47, "Output compare register A.") \
+   X(OCR0B,  0x48, "Output compare register B.") \
+   X(TIMSK0, 0x6E, "Interrupt mask register, TOIE0, OCIE0A and OCIE0B in bits 0 - 2.")
+
+/********************************************************************************
+* timer: Namespace containing Timer/Counter0.
+********************************************************************************/
+namespace timer
+{
+   /********************************************************************************
+   * Register addresses (generated from TIMER_REGISTERS):
+   ********************************************************************************/
+#define TIMER_ADDRESS(name, address, comment) static constexpr std::uint16_t name = address;
+   TIMER_REGISTERS(TIMER_ADDRESS)
+#undef TIMER_ADDRESS
+
+   static constexpr std::uint8_t TOV0 = 0;  /* Overflow flag (TIFR0) and interrupt enable TOIE0 (TIMSK0). */
+   static constexpr std::uint8_t OCF0A = 1; /* Compare match A flag (TIFR0) and enable OCIE0A (TIMSK0). */
+   static constexpr std::uint8_t OCF0B = 2; /* Compare match B flag (TIFR0) and enable OCIE0B (TIMSK0). */
+   static constexpr std::uint64_t never = ~0ULL; /* Cycle of an event that doesn't occur. */
+
+   static constexpr std::uint16_t TIMER0_COMPA_vect = 0x1C; /* Vector of compare match A. */
+   static constexpr std::uint16_t TIMER0_COMPB_vect = 0x1E; /* Vector of compare match B. */
+   static constexpr std::uint16_t TIMER0_OVF_vect = 0x20;   /* Vector of the overflow. */
+
+   /********************************************************************************
+   * is_register: Returns true if specified data address holds a timer register.
+   ********************************************************************************/
+   static constexpr bool is_register(const std::uint16_t address)
+   {
+      return address == TIFR0 || (address >= TCCR0A && address <= OCR0B) || address == TIMSK0;
+   }
+
+   /********************************************************************************
+   * prescaler: Returns the number of CPU cycles per tick for specified value of
+   *            TCCR0B, or 0 if the timer is stopped. The external clock
+   *            sources (CS02:0 = 6 and 7) aren't connected and stop the timer.
+   ********************************************************************************/
+   static constexpr std::uint64_t prescaler(const std::uint8_t tccr0b)
+   {
+      return (tccr0b & 0x07) == 1 ? 1 : (tccr0b & 0x07) == 2 ? 8 : (tccr0b & 0x07) == 3 ? 64 :
+             (tccr0b & 0x07) == 4 ? 256 : (tccr0b & 0x07) == 5 ? 1024 : 0;
+   }
+
+   /********************************************************************************
+   * timer0: State of Timer/Counter0.
+   ********************************************************************************/
+   struct timer0
+   {
+      std::uint8_t tifr = 0;    /* TIFR0. */
+      std::uint8_t tccra = 0;   /* TCCR0A. */
+      std::uint8_t tccrb = 0;   /* TCCR0B. */
+      std::uint8_t tcnt = 0;    /* TCNT0. */
+      std::uint8_t ocra = 0;    /* OCR0A. */
+      std::uint8_t ocrb = 0;    /* OCR0B. */
+      std::uint8_t timsk = 0;   /* TIMSK0. */
+      std::uint64_t updated = 0; /* Cycle up to which the counter is up to date. */
+
+      /********************************************************************************
+      * update: Brings the counter and flags up to date with specified cycle.
+      *         After n ticks the counter has advanced by n modulo 256, and a
+      *         flag is set if its target value (0 for TOV0) is reached within
+      *         the n ticks, i.e. if n is at least the distance from the counter
+      *         to the target (1 - 256 ticks).
+      ********************************************************************************/
+      void update(const std::uint64_t cycle)
+      {
+         const auto p = prescaler(tccrb);
+
+         if (p && cycle > updated)
+         {
+            const auto ticks = cycle / p - updated / p;
+            const auto reached = [&](const std::uint8_t target)
+            {
+               return ticks > static_cast<std::uint8_t>(target - tcnt - 1);
+            };
+
+            if (reached(0))    tifr |= 1 << TOV0;
+            if (reached(ocra)) tifr |= 1 << OCF0A;
+            if (reached(ocrb)) tifr |= 1 << OCF0B;
+            tcnt = static_cast<std::uint8_t>(tcnt + ticks);
+         }
+
+         updated = cycle;
+         return;
+      }
+
+      /********************************************************************************
+      * update_by_ticks: Brings the counter and flags up to date with specified
+      *                  cycle by performing each tick since the last update.
+      *                  Reference for update.
+      ********************************************************************************/
+      void update_by_ticks(const std::uint64_t cycle)
+      {
+         const auto p = prescaler(tccrb);
+
+         if (p)
+         {
+            for (auto tick = (updated / p + 1) * p; tick <= cycle; tick += p)
+            {
+               ++tcnt;
+               if (tcnt == 0)    tifr |= 1 << TOV0;
+               if (tcnt == ocra) tifr |= 1 << OCF0A;
+               if (tcnt == ocrb) tifr |= 1 << OCF0B;
+            }
+         }
+
+         updated = cycle;
+         return;
+      }
+
+      /********************************************************************************
+      * read: Returns the value of the register at specified address at
+      *       specified cycle.
+      ********************************************************************************/
+      std::uint8_t read(const std::uint16_t address,
+                        const std::uint64_t cycle)
+      {
+         update(cycle);
+
+         switch (address)
+         {
+         case TIFR0:  return tifr;
+         case TCCR0A: return tccra;
+         case TCCR0B: return tccrb;
+         case TCNT0:  return tcnt;
+         case OCR0A:  return ocra;
+         case OCR0B:  return ocrb;
+         case TIMSK0: return timsk;
+         default:     return 0;
+         }
+      }
+
+      /********************************************************************************
+      * write: Writes specified value to the register at specified address at
+      *        specified cycle.
+      ********************************************************************************/
+      void write(const std::uint16_t address,
+                 const std::uint8_t value,
+                 const std::uint64_t cycle)
+      {
+         update(cycle);
+
+         switch (address)
+         {
+         case TIFR0:  tifr &= static_cast<std::uint8_t>(~value & 0x07); break;
+         case TCCR0A: tccra = value; break;
+         case TCCR0B: tccrb = value; break;
+         case TCNT0:  tcnt = value; break;
+         case OCR0A:  ocra = value; break;
+         case OCR0B:  ocrb = value; break;
+         case TIMSK0: timsk = value & 0x07; break;
+         default:     break;
+         }
+         return;
+      }
+
+      /********************************************************************************
+      * next_change: Returns a cycle after specified cycle no later than the first
+      *              cycle at which reading the register at specified address
+      *              can return another value, provided that no register is
+      *              written in between. Returns never for constant registers.
+      ********************************************************************************/
+      std::uint64_t next_change(const std::uint16_t address,
+                                const std::uint64_t cycle) const
+      {
+         const auto p = prescaler(tccrb);
+         if (!p || (address != TCNT0 && address != TIFR0)) return never;
+         if (address == TCNT0) return (cycle / p + 1) * p;
+
+         const auto ticks = static_cast<std::int64_t>(cycle / p) - static_cast<std::int64_t>(updated / p);
+         const auto count = static_cast<std::uint8_t>(tcnt + ticks);
+         const auto distance = [&](const std::uint8_t target) { return static_cast<std::uint8_t>(target - count - 1) + 1ULL; };
+         const auto next = std::min(distance(0), std::min(distance(ocra), distance(ocrb)));
+         return (cycle / p + next) * p;
+      }
+
+      /********************************************************************************
+      * next_interrupt: Returns the first cycle from specified cycle on at which
+      *                 a flag enabled in TIMSK0 is set, provided that no
+      *                 register is written in between, or never if the timer
+      *                 is stopped or no interrupt is enabled.
+      ********************************************************************************/
+      std::uint64_t next_interrupt(const std::uint64_t cycle)
+      {
+         update(cycle);
+         if (tifr & timsk) return cycle;
+         const auto p = prescaler(tccrb);
+         if (!p || !timsk) return never;
+
+         const auto distance = [&](const std::uint8_t target) { return static_cast<std::uint64_t>(static_cast<std::uint8_t>(target - tcnt - 1)) + 1; };
+         auto next = never;
+         if (timsk & (1 << TOV0))  next = std::min(next, distance(0));
+         if (timsk & (1 << OCF0A)) next = std::min(next, distance(ocra));
+         if (timsk & (1 << OCF0B)) next = std::min(next, distance(ocrb));
+         return (cycle / p + next) * p;
+      }
+
+      /********************************************************************************
+      * acknowledge: Clears the enabled flag of highest priority that is set at
+      *              specified cycle and returns the address of its vector, or 0
+      *              if no interrupt is requested.
+      ********************************************************************************/
+      std::uint16_t acknowledge(const std::uint64_t cycle)
+      {
+         update(cycle);
+         const auto requested = tifr & timsk;
+
+         if (requested & (1 << OCF0A))
+         {
+            tifr &= ~(1 << OCF0A);
+            return TIMER0_COMPA_vect;
+         }
+         else if (requested & (1 << OCF0B))
+         {
+            tifr &= ~(1 << OCF0B);
+            return TIMER0_COMPB_vect;
+         }
+         else if (requested & (1 << TOV0))
+         {
+            tifr &= ~(1 << TOV0);
+            return TIMER0_OVF_vect;
+         }
+         return 0;
+      }
+   };
+}
+
+#endif /* TIMER_HPP_ */
\ No newline at end of file